@@ -1,9 +1,12 @@
+#include <fstream>
+
 #include <Fsa/AlphabetXml.hh>
 
 #include "Application.hh"
 #include "BeforeScorer.hh"
 #include "BleuScore.hh"
 #include "ChartFactory.hh"
+#include "FeaturePlan.hh"
 
 namespace Permute {
   Core::ParameterString Application::paramOutput ("output", "the output file", "-"),
@@ -19,7 +22,9 @@ namespace Permute {
 
   Core::ParameterBool Application::paramDebug ("debug", "application dependent behavior", false),
     Application::paramIterateSearch ("iterate-search", "perform iterated local search", true),
-    Application::paramDependency ("dependency", "use dependency features and streams", false);
+    Application::paramDependency ("dependency", "use dependency features and streams", false),
+    Application::paramBanded ("banded", "store only the LOP chart cells within the window", false),
+    Application::paramSignedHash ("signed-hash", "let hashed features subtract their weights at random", true);
 
   Core::ParameterInt Application::paramLearningIterations ("learning-iterations", "the number of iterations of learning to perform", 0, 0),
     Application::paramSentences ("sentences", "the number of sentences to train on", Core::Type<int>::max, 1),
@@ -29,7 +34,9 @@ namespace Permute {
     Application::paramQuadraticWidth ("quadratic-width", "the width of the quadratic parse controller", 1, 1),
     Application::paramQuadraticLeft ("quadratic-left", "the left anchor width", 0, 0),
     Application::paramQuadraticRight ("quadratic-right", "the right anchor width", 0, 0),
-    Application::paramWindow ("window", "the maximum allowed swap width", 0, 0);
+    Application::paramWindow ("window", "the maximum allowed swap width", 0, 0),
+    Application::paramThreads ("threads", "the number of threads used to fill each chart or to run restarts", 1, 1),
+    Application::paramHashBits ("hash-bits", "hash PV features into 2^hash-bits weights, or store them if 0", 0, 0, HashedWeights::MaxBits);
 
   Core::ParameterFloat Application::paramDistortionWeight ("weight-d", "the weight of the geometric distortion model", 0.6, 0.0),
     Application::paramLModelWeight ("weight-l", "the weight of the language model", 0.5),
@@ -41,6 +48,12 @@ namespace Permute {
   Core::Choice Application::ParseControllerChoice ("cubic", pc_cubic, "quadratic", pc_quadratic, CHOICE_END);
   Core::ParameterChoice Application::paramParseControllerType ("parse-controller", & Application::ParseControllerChoice, "the parse controller type", Application::pc_cubic);
 
+  Core::Choice Application::BeforeScorerChoice ("dense", bs_dense, "prefix", bs_prefix, "sparse", bs_sparse, CHOICE_END);
+  Core::ParameterChoice Application::paramBeforeScorerType ("before-scorer", & Application::BeforeScorerChoice, "the LOP scorer implementation", Application::bs_dense);
+
+  Core::Choice Application::LOPChartChoice ("default", lc_default, "fsa", lc_fsa, "lop", lc_lop, "normal", lc_normal, "backpointer", lc_backpointer, CHOICE_END);
+  Core::ParameterChoice Application::paramLOPChartType ("lop-chart", & Application::LOPChartChoice, "the one-best chart used for decoding", Application::lc_default);
+
   std::vector <int> Application::defaultParents_;
   Permutation Application::defaultLabels_;
 
@@ -82,6 +95,8 @@ namespace Permute {
     paramDebug.printShortHelp (out);
     paramIterateSearch.printShortHelp (out);
     paramDependency.printShortHelp (out);
+    paramBanded.printShortHelp (out);
+    paramSignedHash.printShortHelp (out);
 
     paramLearningIterations.printShortHelp (out);
     paramSentences.printShortHelp (out);
@@ -92,6 +107,8 @@ namespace Permute {
     paramQuadraticLeft.printShortHelp (out);
     paramQuadraticRight.printShortHelp (out);
     paramWindow.printShortHelp (out);
+    paramThreads.printShortHelp (out);
+    paramHashBits.printShortHelp (out);
 
     paramDistortionWeight.printShortHelp (out);
     paramLModelWeight.printShortHelp (out);
@@ -101,6 +118,8 @@ namespace Permute {
     paramTTableWeights.printShortHelp (out);
 
     paramParseControllerType.printShortHelp (out);
+    paramBeforeScorerType.printShortHelp (out);
+    paramLOPChartType.printShortHelp (out);
 
     out << "specific options" << std::endl;
     this -> printParameterDescription (out);
@@ -128,6 +147,8 @@ namespace Permute {
     DEBUG = paramDebug (config);
     ITERATE_SEARCH = paramIterateSearch (config);
     DEPENDENCY = paramDependency (config);
+    BANDED = paramBanded (config);
+    SIGNED_HASH = paramSignedHash (config);
     SENTENCES = paramSentences (config);
     LEARNING_ITERATIONS = paramLearningIterations (config);
     TTABLE_WEIGHT_COUNT = paramTTableWeightCount (config);
@@ -137,11 +158,20 @@ namespace Permute {
     QUADRATIC_LEFT = paramQuadraticLeft (config);
     QUADRATIC_RIGHT = paramQuadraticRight (config);
     WINDOW = paramWindow (config);
+    THREADS = paramThreads (config);
+    HASH_BITS = paramHashBits (config);
+    if (THREADS > 1) {
+      threadPool_ = ThreadPoolRef (new ThreadPool (THREADS));
+    } else {
+      threadPool_ = ThreadPoolRef ();
+    }
     DISTORTION_WEIGHT = paramDistortionWeight (config);
     LMODEL_WEIGHT = paramLModelWeight (config);
     WORD_WEIGHT = paramWordWeight (config);
     TOLERANCE = paramTolerance (config);
     PARSE_CONTROLLER_TYPE = ParseControllerType (paramParseControllerType (config));
+    BEFORE_SCORER_TYPE = BeforeScorerType (paramBeforeScorerType (config));
+    LOP_CHART_TYPE = LOPChartType (paramLOPChartType (config));
   }
 
   // Returns a new copy of the INPUT file, or std::cin if INPUT is "-".
@@ -205,6 +235,53 @@ namespace Permute {
     return controller;
   }
 
+  // Returns the thread pool for --threads, or a null reference if charts and
+  // scorers should run serially.
+  const ThreadPoolRef & Application::threadPool () const {
+    return threadPool_;
+  }
+
+  // Returns the LOP chart layout selected by --banded.  The banded layout
+  // scales with the window only if the scorer does too, so it pairs with
+  // --before-scorer=prefix.  The charts store every span under any controller
+  // but the cubic one.
+  LOPChart::Layout Application::chartLayout () const {
+    return BANDED ? LOPChart::BANDED : LOPChart::FULL;
+  }
+
+  namespace {
+    // Adapts a Chart from ChartFactory to the OneBestChart interface.
+    class FsaOneBestChart : public OneBestChart {
+    private:
+      ChartRef chart_;
+    public:
+      FsaOneBestChart (ChartRef chart) : chart_ (chart) {}
+      virtual void permute (const ParseControllerRef & controller, ScorerRef & scorer) {
+	Chart::permute (chart_, controller, scorer);
+      }
+      virtual ConstPathRef getBestPath () const {
+	return chart_ -> getBestPath ();
+      }
+    };
+  }
+
+  // Returns the one-best chart selected by --lop-chart for the given
+  // permutation, or the caller's usual chart if --lop-chart is default.  The
+  // LOP charts honor --window, --threads and --banded.
+  OneBestChartRef Application::oneBestChart (Permutation & pi, LOPChartType usual) const {
+    LOPChartType type = (LOP_CHART_TYPE == lc_default) ? usual : LOP_CHART_TYPE;
+    switch (type) {
+    case lc_fsa:
+      return OneBestChartRef (new FsaOneBestChart (ChartFactory::create () -> chart (pi, WINDOW)));
+    case lc_normal:
+      return OneBestChartRef (new NormalLOPChart (pi, WINDOW, threadPool (), chartLayout ()));
+    case lc_backpointer:
+      return OneBestChartRef (new BackpointerNormalLOPChart (pi, WINDOW, threadPool (), chartLayout ()));
+    default:
+      return OneBestChartRef (new LOPChart (pi, WINDOW, threadPool (), chartLayout ()));
+    }
+  }
+
   // Returns an empty scorer.
   ScorerRef Application::scorer () const {
     return ScorerRef (new Scorer);
@@ -268,6 +345,25 @@ namespace Permute {
 
   /**********************************************************************/
 
+  // Returns the BeforeScorer layout selected by --before-scorer.
+  BeforeScorer::Layout Application::scorerLayout () const {
+    return BEFORE_SCORER_TYPE == bs_sparse ? BeforeScorer::SPARSE : BeforeScorer::DENSE;
+  }
+
+  // Returns a Scorer for the given permutation and cost matrix, chosen by
+  // --before-scorer.  The dense scorer caches every (i,j,k) triple, the sparse
+  // scorer caches only the triples the parse controller allows, and the prefix
+  // scorer answers each query from an O(n^2) summed-area table.
+  ScorerRef Application::costScorer (const BeforeCostRef & bc, const Permutation & words) const {
+    if (BEFORE_SCORER_TYPE == bs_prefix) {
+      return ScorerRef (new PrefixBeforeScorer (bc, words));
+    } else {
+      BeforeScorer * scorer = new BeforeScorer (bc, words, scorerLayout ());
+      scorer -> setThreadPool (threadPool ());
+      return ScorerRef (scorer);
+    }
+  }
+
   // Returns a Scorer for the given permutation derived from a ParameterVector.
   ScorerRef Application::beforeScorer (const Permutation & words, const ParameterVector & pv, const Permutation & pos) const {
     BeforeCost * bc (new BeforeCost (pos.size (), "Application::beforeScorer"));
@@ -276,7 +372,7 @@ namespace Permute {
 	bc -> setCost (* i, * j, sum (pv, pos, * i, * j));
       }
     }
-    return ScorerRef (new BeforeScorer (BeforeCostRef (bc), words));
+    return costScorer (BeforeCostRef (bc), words);
   }
 
   // Returns a Scorer for the given permutation that measures loss relative to
@@ -286,29 +382,77 @@ namespace Permute {
   }
 
   // Returns the unnormalized LOP score matrix contained in the --lolib-file
-  // parameter.
-  BeforeCost * Application::lolib () const {
+  // parameter.  A file in the binary format written by lolib-binary is mapped
+  // into memory rather than parsed.
+  BeforeCostRef Application::lolib () const {
+    if (isBinaryLOLIB (LOLIB_FILE)) {
+      return BeforeCostRef (mapLOLIB (LOLIB_FILE));
+    }
     Core::CompressedInputStream input (LOLIB_FILE);
     if (! input) {
       std::cerr << "Could not read LOLIB matrix file: " << LOLIB_FILE << std::endl;
-      return 0;
+      return BeforeCostRef ();
     }
-    return readLOLIB (input);
+    return BeforeCostRef (readLOLIB (input));
   }
 
   /**********************************************************************/
 
-  // Reads a given PV from LOP_FILE and returns success.
-  bool Application::readPV (PV & pv) const {
-    bool rv = readFile (pv, LOP_FILE);
+  // Reads a given PV from LOP_FILE and returns success.  Indexes the PV by
+  // feature key, so that sumBeforeCost need not build feature strings, unless
+  // the keys collide or some template lacks a type.  If readOnly, a binary
+  // LOP_FILE is mapped into memory rather than read, for tools that only
+  // decode.  If HASH_BITS is set, hashes the features instead, so that the
+  // file need only hold templates.
+  bool Application::readPV (PV & pv, bool readOnly) const {
+    bool rv = readOnly && isBinaryPV (LOP_FILE) ? readBinary (pv, LOP_FILE, true) : readFile (pv, LOP_FILE);
     if (! rv) {
       std::cerr << "Could not read LOP parameter file: " << LOP_FILE << std::endl;
+    } else if (pv.hashed () || pv.mapped ()) {
+      return rv;
+    } else if (HASH_BITS > 0) {
+      rv = pv.hash (HASH_BITS, SIGNED_HASH);
+      if (! rv) {
+	std::cerr << "Could not hash features: some template in "
+		  << LOP_FILE << " lacks a type" << std::endl;
+      }
+    } else if (! pv.index () && pv.table ().collisions ()) {
+      std::cerr << pv.table ().collisions () << " feature key collisions in "
+		<< LOP_FILE << ": using feature strings" << std::endl;
     }
     return rv;
   }
 
-  // Writes the given PV to LOP_OUTPUT_FILE.
+  // Writes the given PV to LOP_OUTPUT_FILE, in the binary format if hashed,
+  // since the XML format has no place for hashed weights.
+  //
+  // A hashed PV goes to LOP_OUTPUT_FILE with any .xml.gz or .bin suffix
+  // replaced by .bin, or by .iter-N.bin for iteration N.
   void Application::writePV (const PV & pv, int iter) const {
+    if (pv.hashed ()) {
+      std::string stem (LOP_OUTPUT_FILE);
+      const char * suffixes [] = { ".xml.gz", ".bin" };
+      for (int s = 0; s < 2; ++ s) {
+	const std::string suffix (suffixes [s]);
+	if (stem.size () > suffix.size () &&
+	    stem.compare (stem.size () - suffix.size (), suffix.size (), suffix) == 0) {
+	  stem.erase (stem.size () - suffix.size ());
+	}
+      }
+      std::ostringstream file;
+      file << stem;
+      if (iter) {
+	file << ".iter-" << iter;
+      }
+      file << ".bin";
+      std::ofstream output (file.str ().c_str (), std::ios::binary);
+      const bool written = output && writeBinary (pv, output);
+      output.close ();
+      if (! written || ! output) {
+	std::cerr << "Could not write binary PV file: " << file.str () << std::endl;
+      }
+      return;
+    }
     Core::CompressedOutputStream output;
     if (iter) {
       std::ostringstream file;
@@ -321,17 +465,30 @@ namespace Permute {
     writeXml (pv, output);
   }
 
+  // Fills bc from the features of each pair.  An indexed, mapped or hashed
+  // PV lets a FeaturePlan compose the features from attributes of each
+  // token; otherwise, builds and looks up the feature strings of each pair.
   void Application::sumBeforeCost (SumBeforeCostRef bc, const PV & pv,
 				   const Permutation & words,
 				   const Permutation & pos,
 				   const std::vector <int> & parents,
 				   const Permutation & labels) const {
+    for (Permutation::const_iterator i = words.begin (); i != -- words.end (); ++ i) {
+      if ((* i) >= (* (i + 1))) {
+	std::cerr << "sumBeforeCost received non-identity permutation!" << std::endl;
+	return;
+      }
+    }
+    if (pv.indexed () || pv.mapped () || pv.hashed ()) {
+      if (DEPENDENCY) {
+	FeaturePlan (pv, words, pos, parents, labels).fill (* bc);
+      } else {
+	FeaturePlan (pv, words, pos).fill (* bc);
+      }
+      return;
+    }
     for (Permutation::const_iterator i = words.begin (); i != -- words.end (); ++ i) {
       for (Permutation::const_iterator j = i + 1; j != words.end (); ++ j) {
-	if ((* i) >= (* j)) {
-	  std::cerr << "sumBeforeCost received non-identity permutation!" << std::endl;
-	  return;
-	}
 	std::vector <std::string> features;
 	if (DEPENDENCY) {
 	  pv.features (features, words, pos, parents, labels, (* i), (* j));
@@ -362,13 +519,13 @@ namespace Permute {
 					  const std::vector <int> & parents,
 					  const Permutation & labels) const {
     sumBeforeCost (bc, pv, words, pos, parents, labels);
-    return ScorerRef (new BeforeScorer (BeforeCostRef (bc), words));
+    return costScorer (BeforeCostRef (bc), words);
   }
 
   ScorerRef Application::sumBeforeScorer (SumBeforeCostRef bc, const PV & pv,
 					  const InputData & data) const {
     sumBeforeCost (bc, pv, data.source (), data.pos (), data.parents (), data.labels ());
-    return ScorerRef (new BeforeScorer (BeforeCostRef (bc), data.source ()));
+    return costScorer (BeforeCostRef (bc), data.source ());
   }
 
   /**********************************************************************/
@@ -380,7 +537,6 @@ namespace Permute {
     ParameterVector pv (copy);
     Permute::set (pv, weights);
 
-    ChartFactoryRef factory = ChartFactory::create ();
     Permutation source, target,
       pos (pv.getPOS ());
     ParseControllerRef controller = this -> parseController (source);
@@ -395,11 +551,11 @@ namespace Permute {
       readAlignment (target, in);
 
       ScorerRef scorer = this -> beforeScorer (source, pv, pos);
-      ChartRef chart = factory -> chart (source, WINDOW);
+      OneBestChartRef chart = this -> oneBestChart (source, lc_fsa);
 
       double best_score = scorer -> score (source);
       do {
-	Chart::permute (chart, controller, scorer);
+	chart -> permute (controller, scorer);
 	ConstPathRef bestPath = chart -> getBestPath ();
 	source.changed (false);
 	if (bestPath -> getScore () > best_score) {
@@ -422,7 +578,6 @@ namespace Permute {
   // Decodes the dev set using the given PV.  Sends the output of each (source,
   // POS, alignment) to a pipe running DEV_COMMAND.
   void Application::decodeDev (const PV & pv) {
-    ChartFactoryRef factory = ChartFactory::create ();
     Permutation source, target, pos;
     ParseControllerRef controller = this -> parseController (source);
 
@@ -436,11 +591,11 @@ namespace Permute {
 
       SumBeforeCostRef bc (new SumBeforeCost (source.size (), "Application::decodeDev"));
       ScorerRef scorer = this -> sumBeforeScorer (bc, pv, source, pos);
-      ChartRef chart = factory -> chart (source, WINDOW);
+      OneBestChartRef chart = this -> oneBestChart (source, lc_fsa);
 
       double best_score = scorer -> score (source);
       do {
-	Chart::permute (chart, controller, scorer);
+	chart -> permute (controller, scorer);
 	ConstPathRef bestPath = chart -> getBestPath ();
 	source.changed (false);
 	if (bestPath -> getScore () > best_score) {
@@ -460,13 +615,7 @@ namespace Permute {
   void Application::perceptronUpdate (SumBeforeCostRef bc,
 				      const Permutation & pi,
 				      double amount) const {
-    for (Permutation::const_iterator i = pi.begin (); i != -- pi.end (); ++ i) {
-      for (Permutation::const_iterator j = i + 1; j != pi.end (); ++ j) {
-	if (* i < * j) {
-	  (* bc) (* i, * j).add (amount);
-	}
-      }
-    }
+    bc -> add (pi, amount);
   }
 
   bool Application::converged () {
@@ -7,12 +7,14 @@
 
 #include "Distortion.hh"
 #include "InputData.hh"
+#include "LOPChart.hh"
 #include "Parameter.hh"
 #include "ParseController.hh"
 #include "Permutation.hh"
 #include "PV.hh"
 #include "Scorer.hh"
 #include "SRILM.hh"
+#include "ThreadPool.hh"
 #include "TTable.hh"
 
 namespace Permute {
@@ -41,10 +43,14 @@ namespace Permute {
     static Core::ParameterBool
     paramDebug,
       paramIterateSearch,
-      paramDependency;
+      paramDependency,
+      paramBanded,
+      paramSignedHash;
     bool DEBUG,
       ITERATE_SEARCH,
-      DEPENDENCY;
+      DEPENDENCY,
+      BANDED,
+      SIGNED_HASH;
     static Core::ParameterInt
     paramSentences,
       paramLearningIterations,
@@ -54,9 +60,12 @@ namespace Permute {
       paramQuadraticWidth,
       paramQuadraticLeft,
       paramQuadraticRight,
-      paramWindow;
+      paramWindow,
+      paramThreads,
+      paramHashBits;
     int SENTENCES, LEARNING_ITERATIONS, TTABLE_WEIGHT_COUNT, TTABLE_LIMIT,
-      LMODEL_ORDER, QUADRATIC_WIDTH, QUADRATIC_LEFT, QUADRATIC_RIGHT, WINDOW;
+      LMODEL_ORDER, QUADRATIC_WIDTH, QUADRATIC_LEFT, QUADRATIC_RIGHT, WINDOW,
+      THREADS, HASH_BITS;
     static Core::ParameterFloat
     paramDistortionWeight,
       paramLModelWeight,
@@ -71,6 +80,24 @@ namespace Permute {
     static Core::Choice ParseControllerChoice;
     static Core::ParameterChoice paramParseControllerType;
     ParseControllerType PARSE_CONTROLLER_TYPE;
+    enum BeforeScorerType {
+      bs_dense,
+      bs_prefix,
+      bs_sparse
+    };
+    static Core::Choice BeforeScorerChoice;
+    static Core::ParameterChoice paramBeforeScorerType;
+    BeforeScorerType BEFORE_SCORER_TYPE;
+    enum LOPChartType {
+      lc_default,
+      lc_fsa,
+      lc_lop,
+      lc_normal,
+      lc_backpointer
+    };
+    static Core::Choice LOPChartChoice;
+    static Core::ParameterChoice paramLOPChartType;
+    LOPChartType LOP_CHART_TYPE;
 
     virtual void getParameters ();
     
@@ -81,6 +108,7 @@ namespace Permute {
     PhraseDictionaryTree * ttable_;
     WeightModel * ttableWeightModel_;
     int learning_iteration_;
+    ThreadPoolRef threadPool_;
     
   public:
     Application (const std::string &);
@@ -97,6 +125,9 @@ namespace Permute {
 
     ParseControllerRef parseController (const Permutation &) const;
     ScorerRef scorer () const;
+    const ThreadPoolRef & threadPool () const;
+    LOPChart::Layout chartLayout () const;
+    OneBestChartRef oneBestChart (Permutation &, LOPChartType = lc_lop) const;
 
     Fsa::ConstAutomatonRef distortion (const Permutation &) const;
     Fsa::ConstAutomatonRef ttable (const Permutation &,
@@ -106,14 +137,16 @@ namespace Permute {
     bool parameters (ParameterVector &) const;
     void outputParameters (const ParameterVector &) const;
 
+    BeforeScorer::Layout scorerLayout () const;
+    ScorerRef costScorer (const BeforeCostRef &, const Permutation &) const;
     ScorerRef beforeScorer (const Permutation &, const ParameterVector &, const Permutation &) const;
     ScorerRef lossScorer (const Permutation & words, const Permutation & target) const;
 
-    BeforeCost * lolib () const;
+    BeforeCostRef lolib () const;
 
     void decodeDev (const ParameterVector &, const std::vector <double> &);
 
-    bool readPV (PV &) const;
+    bool readPV (PV &, bool readOnly = false) const;
     void writePV (const PV &, int iter = 0) const;
     void sumBeforeCost (SumBeforeCostRef bc, const PV & pv,
 			const Permutation & words, const Permutation & pos,
@@ -0,0 +1,84 @@
+#include "Argmax.hh"
+
+#if defined (__AVX__)
+#include <immintrin.h>
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace Permute {
+  namespace {
+    // Folds the running maximum of each lane into best.  Lanes that never
+    // improved on best hold index -1.  Among equal sums, the lowest index wins,
+    // as it would in a scalar loop.
+    int reduce (const double * values, const double * indices, int lanes, double & best) {
+      int result = -1;
+      for (int lane = 0; lane < lanes; ++ lane) {
+	int index = int (indices [lane]);
+	if (index >= 0 &&
+	    (result < 0 || values [lane] > best || (values [lane] == best && index < result))) {
+	  best = values [lane];
+	  result = index;
+	}
+      }
+      return result;
+    }
+  }
+
+  // Each lane keeps the first maximum of its own subsequence, since it only
+  // moves on a strict improvement.  Indices are carried as doubles, which
+  // represent them exactly, to stay in one register type.
+  int argmax (const double * left, const double * right, const double * score,
+	      int size, double & best) {
+    int j = 0, result = -1;
+#if defined (__AVX__)
+    if (size >= 4) {
+      __m256d values = _mm256_set1_pd (best),
+	indices = _mm256_set1_pd (-1.0),
+	current = _mm256_set_pd (3.0, 2.0, 1.0, 0.0),
+	step = _mm256_set1_pd (4.0);
+      for (; j + 4 <= size; j += 4) {
+	__m256d sum = _mm256_add_pd (_mm256_add_pd (_mm256_loadu_pd (left + j),
+						     _mm256_loadu_pd (right + j)),
+				     _mm256_loadu_pd (score + j));
+	__m256d greater = _mm256_cmp_pd (sum, values, _CMP_GT_OQ);
+	values = _mm256_blendv_pd (values, sum, greater);
+	indices = _mm256_blendv_pd (indices, current, greater);
+	current = _mm256_add_pd (current, step);
+      }
+      double v [4], x [4];
+      _mm256_storeu_pd (v, values);
+      _mm256_storeu_pd (x, indices);
+      result = reduce (v, x, 4, best);
+    }
+#elif defined (__SSE2__)
+    if (size >= 2) {
+      __m128d values = _mm_set1_pd (best),
+	indices = _mm_set1_pd (-1.0),
+	current = _mm_set_pd (1.0, 0.0),
+	step = _mm_set1_pd (2.0);
+      for (; j + 2 <= size; j += 2) {
+	__m128d sum = _mm_add_pd (_mm_add_pd (_mm_loadu_pd (left + j),
+					      _mm_loadu_pd (right + j)),
+				  _mm_loadu_pd (score + j));
+	__m128d greater = _mm_cmpgt_pd (sum, values);
+	values = _mm_or_pd (_mm_and_pd (greater, sum), _mm_andnot_pd (greater, values));
+	indices = _mm_or_pd (_mm_and_pd (greater, current), _mm_andnot_pd (greater, indices));
+	current = _mm_add_pd (current, step);
+      }
+      double v [2], x [2];
+      _mm_storeu_pd (v, values);
+      _mm_storeu_pd (x, indices);
+      result = reduce (v, x, 2, best);
+    }
+#endif
+    for (; j < size; ++ j) {
+      double sum = left [j] + right [j] + score [j];
+      if (sum > best) {
+	best = sum;
+	result = j;
+      }
+    }
+    return result;
+  }
+}
@@ -0,0 +1,18 @@
+#ifndef _PERMUTE_ARGMAX_HH
+#define _PERMUTE_ARGMAX_HH
+
+namespace Permute {
+
+  // Returns the first j in [0, size) that maximizes left[j] + right[j] +
+  // score[j] among the sums strictly greater than best, and stores that sum
+  // in best.  Returns -1 and leaves best alone if there is no such j.  Each
+  // sum is computed as (left[j] + right[j]) + score[j], so the result is
+  // bitwise the same as a scalar loop over the midpoints of a span.
+  //
+  // Evaluates four sums per instruction when compiled with AVX, two with
+  // SSE2, and one otherwise.
+  int argmax (const double * left, const double * right, const double * score,
+	      int size, double & best);
+}
+
+#endif//_PERMUTE_ARGMAX_HH
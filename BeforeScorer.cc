@@ -1,6 +1,17 @@
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "BeforeScorer.hh"
+#include "Chart.hh"
 #include "ParseController.hh"
+#include "ParsePolicy.hh"
 #include <Core/Utility.hh>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 
 namespace Permute {
 
@@ -52,6 +63,127 @@ namespace Permute {
     return bc;
   }
 
+  /**********************************************************************
+   * The binary LOLIB format
+   **********************************************************************/
+
+  namespace {
+    const char LOLIB_MAGIC [8] = { 'L', 'O', 'L', 'I', 'B', 'b', 'i', 'n' };
+    const unsigned LOLIB_ORDER = 0x01020304;
+
+    struct BinaryLOLIBHeader {
+      char magic [8];
+      // LOLIB_ORDER in the byte order of the machine that wrote the file.
+      unsigned order;
+      unsigned size;
+      unsigned name_size;
+      // The position of the matrix from the start of the file.
+      unsigned offset;
+    };
+
+    unsigned matrixOffset (unsigned name_size) {
+      unsigned end = sizeof (BinaryLOLIBHeader) + name_size;
+      return (end + sizeof (double) - 1) / sizeof (double) * sizeof (double);
+    }
+  }
+
+  // Reads the matrix directly out of a read-only mapping of the file.  Pages
+  // are loaded on first use, and the mapping is shared with every other
+  // process that maps the same file.
+  class MappedBeforeCost : public BeforeCostInterface {
+  private:
+    void * map_;
+    size_t length_;
+    const double * matrix_;
+    std::string name_;
+  public:
+    MappedBeforeCost (size_t n, const std::string & name,
+		      void * map, size_t length, const double * matrix) :
+      BeforeCostInterface (n),
+      map_ (map),
+      length_ (length),
+      matrix_ (matrix),
+      name_ (name)
+    {}
+    virtual ~MappedBeforeCost () {
+      ::munmap (map_, length_);
+    }
+    virtual double cost (int i, int j) const {
+      return matrix_ [index (i, j)];
+    }
+    virtual const std::string & name () const {
+      return name_;
+    }
+  };
+
+  bool isBinaryLOLIB (const std::string & file) {
+    std::ifstream in (file.c_str (), std::ios::binary);
+    char magic [sizeof (LOLIB_MAGIC)];
+    return in.read (magic, sizeof (magic))
+      && std::memcmp (magic, LOLIB_MAGIC, sizeof (magic)) == 0;
+  }
+
+  BeforeCostInterface * mapLOLIB (const std::string & file) {
+    int fd = ::open (file.c_str (), O_RDONLY);
+    if (fd < 0) {
+      std::cerr << "Could not open binary LOLIB file: " << file << std::endl;
+      return 0;
+    }
+    struct stat status;
+    if (::fstat (fd, & status) != 0 || status.st_size < 0 ||
+	static_cast <size_t> (status.st_size) < sizeof (BinaryLOLIBHeader)) {
+      std::cerr << "Truncated binary LOLIB file: " << file << std::endl;
+      ::close (fd);
+      return 0;
+    }
+    size_t length = status.st_size;
+    void * map = ::mmap (0, length, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping holds its own reference to the file.
+    ::close (fd);
+    if (map == MAP_FAILED) {
+      std::cerr << "Could not map binary LOLIB file: " << file << std::endl;
+      return 0;
+    }
+    const char * bytes = static_cast <const char *> (map);
+    const BinaryLOLIBHeader & header = * reinterpret_cast <const BinaryLOLIBHeader *> (bytes);
+    size_t n = header.size;
+    // Compares by division so that a corrupt size cannot overflow the bound.
+    if (std::memcmp (header.magic, LOLIB_MAGIC, sizeof (LOLIB_MAGIC)) != 0 ||
+	header.order != LOLIB_ORDER ||
+	header.name_size > length - sizeof (BinaryLOLIBHeader) ||
+	header.offset != matrixOffset (header.name_size) ||
+	header.offset > length ||
+	(n != 0 && n > (length - header.offset) / sizeof (double) / n)) {
+      std::cerr << "Invalid binary LOLIB file: " << file << std::endl;
+      ::munmap (map, length);
+      return 0;
+    }
+    std::string name (bytes + sizeof (BinaryLOLIBHeader), header.name_size);
+    return new MappedBeforeCost (n, name, map, length,
+				 reinterpret_cast <const double *> (bytes + header.offset));
+  }
+
+  bool writeBinaryLOLIB (std::ostream & out, const BeforeCostInterface & bc) {
+    BinaryLOLIBHeader header;
+    std::memcpy (header.magic, LOLIB_MAGIC, sizeof (LOLIB_MAGIC));
+    header.order = LOLIB_ORDER;
+    header.size = bc.size ();
+    header.name_size = bc.name ().size ();
+    header.offset = matrixOffset (header.name_size);
+    out.write (reinterpret_cast <const char *> (& header), sizeof (header));
+    out.write (bc.name ().data (), header.name_size);
+    const char zeros [sizeof (double)] = { 0 };
+    out.write (zeros, header.offset - sizeof (header) - header.name_size);
+    std::vector <double> row (bc.size ());
+    for (int i = 0; i < bc.size (); ++ i) {
+      for (int j = 0; j < bc.size (); ++ j) {
+	row [j] = bc.cost (i, j);
+      }
+      out.write (reinterpret_cast <const char *> (& row [0]), row.size () * sizeof (double));
+    }
+    return out;
+  }
+
   /**********************************************************************/
   
   BeforeCost::BeforeCost (size_t n, const std::string & name) :
@@ -60,6 +192,18 @@ namespace Permute {
     name_ (name)
   {}
 
+  BeforeCost::BeforeCost (const BeforeCostInterface & bc) :
+    BeforeCostInterface (bc.size ()),
+    matrix_ (bc.size () * bc.size (), 0.0),
+    name_ (bc.name ())
+  {
+    for (int i = 0; i < bc.size (); ++ i) {
+      for (int j = 0; j < bc.size (); ++ j) {
+	matrix_ [index (i, j)] = bc.cost (i, j);
+      }
+    }
+  }
+
   double BeforeCost::cost (int i, int j) const {
     return matrix_ [index (i, j)];
   }
@@ -92,32 +236,124 @@ namespace Permute {
 
   /**********************************************************************/
 
-  BeforeScorer::BeforeScorer (const BeforeCostRef & cost, const Permutation & pi) :
+  PermutedCost::PermutedCost (const BeforeCostRef & cost) :
+    cost_ (cost.get ()),
+    n_ (0),
+    matrix_ ()
+  {}
+
+  PermutedCost::PermutedCost (const BeforeCostRef & cost, const Permutation & pi) :
+    cost_ (cost.get ()),
+    n_ (0),
+    matrix_ ()
+  {
+    this -> assign (pi);
+  }
+
+  // Fills the upper triangle from the cost matrix and mirrors it into the lower
+  // triangle, so each entry costs two virtual calls.
+  void PermutedCost::assign (const Permutation & pi) {
+    n_ = pi.size ();
+    matrix_.resize (n_ * n_);
+    for (int a = 0; a < n_; ++ a) {
+      Pair & diagonal = matrix_ [a * n_ + a];
+      diagonal.before = diagonal.after = cost_ -> cost (pi [a], pi [a]);
+      for (int b = a + 1; b < n_; ++ b) {
+	Pair & upper = matrix_ [a * n_ + b],
+	  & lower = matrix_ [b * n_ + a];
+	upper.before = lower.after = cost_ -> cost (pi [a], pi [b]);
+	upper.after = lower.before = cost_ -> cost (pi [b], pi [a]);
+      }
+    }
+  }
+
+  // Sums in the same order as BeforeCostInterface::score.
+  double PermutedCost::score () const {
+    double s = 0.0;
+    for (int a = 0; a < n_ - 1; ++ a) {
+      const Pair * r = row (a);
+      for (int b = a + 1; b < n_; ++ b) {
+	s += r [b].before;
+      }
+    }
+    return s;
+  }
+
+  // Mirrors insert(pi, i, j): moves position i to position j.
+  void PermutedCost::insert (int i, int j) {
+    if (i < j) {
+      rotate (i, i + 1, j + 1);
+    } else if (j < i) {
+      rotate (j, i, i + 1);
+    }
+  }
+
+  // Mirrors insert(pi, i, j, k): exchanges the blocks (i, j) and (j, k).
+  void PermutedCost::insert (int i, int j, int k) {
+    if (k < i) {
+      rotate (k, i, j);
+    } else {
+      rotate (i, j, k);
+    }
+  }
+
+  // Rotates positions [first, last) so that middle comes first, as std::rotate
+  // would on the permutation.  Rows are contiguous, so the rows rotate as one
+  // block; then each row rotates the same range of columns.
+  void PermutedCost::rotate (int first, int middle, int last) {
+    if (first == middle || middle == last) {
+      return;
+    }
+    std::rotate (matrix_.begin () + first * n_,
+		 matrix_.begin () + middle * n_,
+		 matrix_.begin () + last * n_);
+    for (int a = 0; a < n_; ++ a) {
+      std::vector <Pair>::iterator r = matrix_.begin () + a * n_;
+      std::rotate (r + first, r + middle, r + last);
+    }
+  }
+
+  /**********************************************************************/
+
+  BeforeScorer::BeforeScorer (const BeforeCostRef & cost, const Permutation & pi, Layout layout) :
     Scorer (),
     cost_ (cost),
     permutation_ (pi),
     n_ (pi.size ()),
-    index_ (n_, 0),
-    keep_ (n_ * (n_ * n_ - 1) / 6, -1e500),
-    swap_ (keep_)
+    layout_ (layout),
+    permuted_ (cost_),
+    index_ (n_, 0)
   {
     for (int i = 0; i < n_ - 1; ++ i) {
       index_ [i + 1] = index_ [i] + binomial (n_ - i);
     }
+    if (layout_ == DENSE) {
+      keep_.resize (n_ * (n_ * n_ - 1) / 6, -1e500);
+      swap_ = keep_;
+    }
   }
 
   double BeforeScorer::score (int i, int j, int k) const {
     if (i == j || j == k) {
       return 0.0;
     } else if (i < k) {
-      return keep_ [index (i, j, k)];
+      int s = slot (i, j, k);
+      return s < 0 ? -1e500 : keep_ [s];
     } else {
-      return swap_ [index (k, j, i)];
+      int s = slot (k, j, i);
+      return s < 0 ? -1e500 : swap_ [s];
     }
   }
 
-  double BeforeScorer::cost (int i, int k) const {
-    return cost_ -> cost (permutation_ [i], permutation_ [k]);
+  // Reads a run of midpoints of the span (i, k), i < k, without a virtual call
+  // per midpoint.
+  void BeforeScorer::scores (int i, int k, int first, int last,
+			     double * keep, double * swap) const {
+    for (int j = first; j < last; ++ j) {
+      int s = slot (i, j, k);
+      * keep ++ = s < 0 ? -1e500 : keep_ [s];
+      * swap ++ = s < 0 ? -1e500 : swap_ [s];
+    }
   }
 
   int BeforeScorer::index (int i, int j, int k) const {
@@ -126,6 +362,26 @@ namespace Permute {
       + (k - j - 1);
   }
 
+  // Returns the position of the triple (i,j,k), i < j < k, in keep_ and swap_,
+  // or -1 if the current layout has no slot for it.
+  int BeforeScorer::slot (int i, int j, int k) const {
+    if (layout_ == DENSE) {
+      return index (i, j, k);
+    } else if (offsets_.empty ()) {
+      return -1;
+    }
+    int span = Chart::index (i, k, n_);
+    std::vector <int>::const_iterator
+      begin = middles_.begin () + offsets_ [span],
+      end = middles_.begin () + offsets_ [span + 1],
+      it = std::lower_bound (begin, end, j);
+    if (it == end || * it != j) {
+      return -1;
+    } else {
+      return it - middles_.begin ();
+    }
+  }
+
   int BeforeScorer::binomial (int n) {
     return (n * (n - 1) / 2);
   }
@@ -134,29 +390,239 @@ namespace Permute {
     return cost_ -> score (pi);
   }
 
-  void BeforeScorer::compute (const ParseControllerRef & controller) {
+  // Binds fill to a BeforeScorer for use with dispatch.
+  class BeforeScorer::Fill {
+  private:
+    BeforeScorer & scorer_;
+  public:
+    Fill (BeforeScorer & scorer) : scorer_ (scorer) {}
+    template <class Policy>
+    void operator () (const Policy & policy) const {
+      scorer_.fill (policy);
+    }
+  };
+
+  // Rebuilds the SPARSE layout from the midpoints the given policy allows.
+  // Spans are enumerated in Chart::index order, so offsets_ can be filled
+  // front to back.  The recurrences in ParseController::grammar only refer to
+  // triples that the same controller allows, so no other slots are needed.
+  template <class Policy>
+  void BeforeScorer::allocate (const Policy & policy) {
+    offsets_.assign (1, 0);
+    middles_.clear ();
     for (int span = 2; span <= n_; ++ span) {
       for (int i = 0; i <= n_ - span; ++ i) {
 	int k = i + span;
-	for (ParseController::iterator j = controller -> begin (i, k);
-	     j != controller -> end (i, k); ++ j) {
-	  int index = this -> index (i, j, k);
- 	  keep_ [index] = controller -> grammar (* this, i, j, k);
- 	  swap_ [index] = controller -> grammar (* this, k, j, i);
+	for (typename Policy::iterator j = policy.begin (i, k), j_end = policy.end (i, k);
+	     j != j_end; ++ j) {
+	  middles_.push_back (j);
 	}
+	offsets_.push_back (middles_.size ());
       }
     }
+    keep_.assign (middles_.size (), -1e500);
+    swap_ = keep_;
+  }
+
+  // Binds fill to a BeforeScorer and one span width for use with parallelFor.
+  template <class Policy>
+  class BeforeScorer::Span {
+  private:
+    BeforeScorer & scorer_;
+    const Policy & policy_;
+    int span_;
+  public:
+    Span (BeforeScorer & scorer, const Policy & policy, int span) :
+      scorer_ (scorer),
+      policy_ (policy),
+      span_ (span)
+    {}
+    void operator () (int i) const {
+      scorer_.fill (policy_, i, i + span_);
+    }
+  };
+
+  // Fills the keep and swap scores of every allowed midpoint of (i, k).  The
+  // recurrences read only narrower spans and earlier midpoints of (i, k), so
+  // the spans of one width are independent.
+  template <class Policy>
+  void BeforeScorer::fill (const Policy & policy, int i, int k) {
+    for (typename Policy::iterator j = policy.begin (i, k), j_end = policy.end (i, k);
+	 j != j_end; ++ j) {
+      int index = this -> slot (i, j, k);
+      keep_ [index] = policy.grammar (* this, i, j, k);
+      swap_ [index] = policy.grammar (* this, k, j, i);
+    }
+  }
+
+  template <class Policy>
+  void BeforeScorer::fill (const Policy & policy) {
+    if (layout_ == SPARSE) {
+      allocate (policy);
+    }
+    for (int span = 2; span <= n_; ++ span) {
+      parallelFor (pool_, 0, n_ - span + 1, Span <Policy> (* this, policy, span));
+    }
+  }
+
+  void BeforeScorer::compute (const ParseControllerRef & controller) {
+    permuted_.assign (permutation_);
+    dispatch (controller, Fill (* this));
   }
 
   double BeforeScorer::compute (const ParseControllerRef & controller,
 				int i, int j, int k) {
     if (i < k) {
-      return keep_ [index (i, j, k)] = controller -> grammar (* this, i, j, k);
+      return keep_ [slot (i, j, k)] = controller -> grammar (* this, i, j, k);
+    } else {
+      return swap_ [slot (k, j, i)] = controller -> grammar (* this, i, j, k);
+    }
+  }
+
+  /**********************************************************************/
+
+  template <class Cost>
+  PrefixScorer <Cost>::PrefixScorer (const Cost & cost, const Permutation & pi) :
+    Scorer (),
+    cost_ (cost),
+    permutation_ (pi),
+    n_ (pi.size ()),
+    table_ ()
+  {}
+
+  // Everything in (i, j) precedes everything in (j, k) if i < k, and
+  // everything in (j, i) precedes everything in (k, j) otherwise.
+  template <class Cost>
+  double PrefixScorer <Cost>::score (int i, int j, int k) const {
+    if (i == j || j == k) {
+      return 0.0;
+    } else if (i < k) {
+      return rectangle (i, j, j, k);
     } else {
-      return swap_ [index (k, j, i)] = controller -> grammar (* this, i, j, k);
+      return rectangle (j, i, k, j);
+    }
+  }
+
+  template <class Cost>
+  double PrefixScorer <Cost>::score (const Permutation & pi) const {
+    return cost_.score (pi);
+  }
+
+  // Answers a run of midpoints of the span (i, k), i < k, from the table.
+  template <class Cost>
+  void PrefixScorer <Cost>::scores (int i, int k, int first, int last,
+				    double * keep, double * swap) const {
+    for (int j = first; j < last; ++ j) {
+      * keep ++ = rectangle (i, j, j, k);
+      * swap ++ = rectangle (j, k, i, j);
+    }
+  }
+
+  // Fills the table so that table(a, b) holds the sum of cost(pi[c], pi[d])
+  // over all c < a and d < b.  The first row and column stay zero.  Ignores
+  // the controller, since every rectangle is available once the table is
+  // built.
+  template <class Cost>
+  void PrefixScorer <Cost>::compute (const ParseControllerRef &) {
+    if (table_.empty ()) {
+      table_.resize ((n_ + 1) * (n_ + 1), Value ());
+    }
+    for (int a = 0; a < n_; ++ a) {
+      Value row = Value ();
+      for (int b = 0; b < n_; ++ b) {
+	row += cost_.cost (permutation_ [a], permutation_ [b]);
+	table (a + 1, b + 1) = table (a, b + 1) + row;
+      }
+    }
+  }
+
+  // Returns the sum of cost(pi[a], pi[b]) over a in [top, bottom) and b in
+  // [left, right).
+  template <class Cost>
+  typename PrefixScorer <Cost>::Value
+  PrefixScorer <Cost>::rectangle (int top, int bottom, int left, int right) const {
+    return table (bottom, right)
+      - table (top, right)
+      - table (bottom, left)
+      + table (top, left);
+  }
+
+  // Defined here, and so instantiated here for the costs that use them.
+  template class PrefixScorer <MatrixCost>;
+  template class PrefixScorer <TauCost>;
+
+  PrefixBeforeScorer::PrefixBeforeScorer (const BeforeCostRef & cost, const Permutation & pi) :
+    PrefixScorer <MatrixCost> (MatrixCost (cost), pi)
+  {}
+
+  /**********************************************************************/
+
+  namespace {
+    // Returns the position of each element of target.
+    std::vector <int> ranks (const Permutation & target) {
+      std::vector <int> rank (target.size ());
+      for (int p = 0; p < target.size (); ++ p) {
+	rank [target [p]] = p;
+      }
+      return rank;
+    }
+
+    // Sorts [first, last) by merge sort, using buffer as scratch space, and
+    // returns the number of inversions it removed.
+    long inversions (int * first, int * last, int * buffer) {
+      if (last - first < 2) {
+	return 0;
+      }
+      int * middle = first + (last - first) / 2;
+      long count = inversions (first, middle, buffer) + inversions (middle, last, buffer);
+      int * left = first, * right = middle, * out = buffer;
+      while (left != middle && right != last) {
+	if (* right < * left) {
+	  count += middle - left;
+	  * out ++ = * right ++;
+	} else {
+	  * out ++ = * left ++;
+	}
+      }
+      out = std::copy (left, middle, out);
+      std::copy (buffer, out, first);
+      return count;
+    }
+
+    // Returns the number of inversions of rank[pi[0]], ..., rank[pi[n-1]], or
+    // of rank itself if pi is null.
+    long inversions (const std::vector <int> & rank, const Permutation * pi) {
+      std::vector <int> sequence (rank.size ()), buffer (rank.size ());
+      for (int p = 0; p < rank.size (); ++ p) {
+	sequence [p] = pi ? rank [(* pi) [p]] : rank [p];
+      }
+      return sequence.empty () ? 0 : inversions (& sequence [0], & sequence [0] + sequence.size (), & buffer [0]);
+    }
+
+    // The pairs that pi puts in increasing order score +1 if target agrees
+    // and -1 if not.  Counting the pairs by whether pi, target, or both put
+    // them in increasing order, that is binomial(n) less the pairs on which
+    // pi and target disagree, less those on which target disagrees with the
+    // identity.
+    double agreement (const std::vector <int> & rank, const Permutation & pi) {
+      return BeforeScorer::binomial (rank.size ())
+	- inversions (rank, & pi)
+	- inversions (rank, 0);
     }
   }
 
+  TauCost::TauCost (const Permutation & target) :
+    rank_ (ranks (target))
+  {}
+
+  double TauCost::score (const Permutation & pi) const {
+    return agreement (rank_, pi);
+  }
+
+  TauScorer::TauScorer (const Permutation & target, const Permutation & pi) :
+    PrefixScorer <TauCost> (TauCost (target), pi)
+  {}
+
   /**********************************************************************/
 
   BeforeCostRef tauCost (const Permutation & target) {
@@ -174,6 +640,14 @@ namespace Permute {
   }
 
   ScorerRef tauScorer (const Permutation & target, const Permutation & pi) {
-    return ScorerRef (new BeforeScorer (tauCost (target), pi));
+    return ScorerRef (new TauScorer (target, pi));
+  }
+
+  long tauDistance (const Permutation & a, const Permutation & b) {
+    return inversions (ranks (b), & a);
+  }
+
+  double tauScore (const Permutation & target, const Permutation & pi) {
+    return agreement (ranks (target), pi);
   }
 }
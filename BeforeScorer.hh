@@ -5,6 +5,7 @@
 #include <Fsa/Vector.hh>
 #include "Permutation.hh"
 #include "Scorer.hh"
+#include "ThreadPool.hh"
 
 namespace Permute {
 
@@ -38,6 +39,7 @@ namespace Permute {
     std::string name_;
   public:
     BeforeCost (size_t, const std::string & name);
+    explicit BeforeCost (const BeforeCostInterface &);
     virtual double cost (int, int) const;
     virtual const std::string & name () const;
     void setCost (int, int, double);
@@ -46,38 +48,204 @@ namespace Permute {
 
   BeforeCost * readLOLIB (std::istream &);
 
+  // The binary LOLIB format holds the same name and matrix as the text format,
+  // laid out so that the matrix can be used in place: a BinaryLOLIBHeader, the
+  // name, zero padding to a multiple of eight bytes, and then the n x n matrix
+  // as row-major native doubles.  mapLOLIB maps such a file into memory and
+  // returns a read-only BeforeCostInterface over it, or 0 if the file is not
+  // a valid binary matrix for this machine.
+  bool isBinaryLOLIB (const std::string & file);
+  BeforeCostInterface * mapLOLIB (const std::string & file);
+  bool writeBinaryLOLIB (std::ostream &, const BeforeCostInterface &);
+
+  /**********************************************************************/
+
+  // PermutedCost is a dense copy of a BeforeCostInterface matrix in the order
+  // of a permutation.  Entry (a,b) pairs before = B[pi[a],pi[b]] with after =
+  // B[pi[b],pi[a]], so row(a) lists everything a local search needs to score
+  // moving pi[a] in one contiguous run, with no virtual calls.  The insert
+  // methods apply the moves of LinearOrdering.hh to the matrix, so that it
+  // stays in step with a permutation that is changed by those same moves.
+  // Any other change to the permutation requires assign.
+  //
+  // The view keeps a pointer to the matrix rather than a copy of the caller's
+  // BeforeCostRef, so that views of one matrix can be built on several
+  // threads.  The matrix must outlive the view.
+  class PermutedCost {
+  public:
+    struct Pair {
+      double before;
+      double after;
+    };
+  private:
+    const BeforeCostInterface * cost_;
+    int n_;
+    std::vector <Pair> matrix_;
+  public:
+    PermutedCost (const BeforeCostRef & cost);
+    PermutedCost (const BeforeCostRef & cost, const Permutation & pi);
+
+    void assign (const Permutation & pi);
+    int size () const { return n_; }
+    const Pair * row (int a) const { return & matrix_ [a * n_]; }
+    double before (int a, int b) const { return matrix_ [a * n_ + b].before; }
+    double after (int a, int b) const { return matrix_ [a * n_ + b].after; }
+    double score () const;
+
+    void insert (int i, int j);
+    void insert (int i, int j, int k);
+  private:
+    void rotate (int first, int middle, int last);
+  };
+
   /**********************************************************************/
   
   // BeforeScorer implements the Scorer interface with LOP costs.  The method
   // score(i,j,k) returns the total LOP cost of putting (i,j) before (j,k) if i
   // < k, or the opposite if k < i.  Caches results to achieve constant time
   // look-up.
+  //
+  // The DENSE layout allocates a slot for every (i,j,k) triple up front.  The
+  // SPARSE layout allocates slots only for the midpoints that the controller
+  // passed to compute allows, so that quadratic and anchored controllers use
+  // memory proportional to the triples they actually visit.  Lookups of
+  // triples outside the layout return -1e500 in either case.
+  //
+  // Given a thread pool, compute fills the spans of each width in parallel.
+  // It first copies the cost matrix into the order of the permutation, which
+  // cost(i,k) then reads, so compute must be called again whenever the
+  // permutation or the costs change.
   class BeforeScorer : public Scorer {
+  public:
+    typedef enum {
+      DENSE,
+      SPARSE
+    } Layout;
   private:
     BeforeCostRef cost_;
     const Permutation & permutation_;
     int n_;
+    Layout layout_;
+    PermutedCost permuted_;
+    ThreadPoolRef pool_;
     std::vector <int> index_;
+    // SPARSE only: middles_ [offsets_ [s], offsets_ [s + 1]) lists the allowed
+    // midpoints of the span with Chart::index s, in increasing order.
+    std::vector <int> offsets_;
+    std::vector <int> middles_;
     std::vector <double> keep_;
     std::vector <double> swap_;
   public:
-    BeforeScorer (const BeforeCostRef & cost, const Permutation & pi);
+    BeforeScorer (const BeforeCostRef & cost, const Permutation & pi, Layout = DENSE);
 
     virtual double score (int, int, int) const;
     virtual double score (const Permutation &) const;
+    virtual void scores (int, int, int, int, double *, double *) const;
     virtual void compute (const ParseControllerRef &);
     double compute (const ParseControllerRef &, int, int, int);
 
     int size () const { return n_; }
-    double cost (int, int) const;
+    Layout layout () const { return layout_; }
+    double cost (int i, int k) const { return permuted_.before (i, k); }
     int index (int, int, int) const;
+    int slot (int, int, int) const;
+    int slots () const { return keep_.size (); }
+    void setThreadPool (const ThreadPoolRef & pool) { pool_ = pool; }
     static int binomial (int);
+  private:
+    class Fill;
+    template <class Policy> class Span;
+    template <class Policy> void fill (const Policy &);
+    template <class Policy> void fill (const Policy &, int, int);
+    template <class Policy> void allocate (const Policy &);
   };
 
   /**********************************************************************/
 
+  // PrefixScorer implements the Scorer interface with the same scores as
+  // BeforeScorer over the costs given by Cost, but answers score(i,j,k) with a
+  // constant time rectangle query on a summed-area table of the permuted cost
+  // matrix instead of caching every (i,j,k) triple.  The compute method
+  // allocates the table on first use and rebuilds it in O(n^2) time, so it
+  // must be called again whenever the permutation changes; score(pi) needs
+  // no table.  Cost provides the type Value of its costs, cost(a,b), and
+  // score(pi).
+  template <class Cost>
+  class PrefixScorer : public Scorer {
+  private:
+    typedef typename Cost::Value Value;
+    Cost cost_;
+    const Permutation & permutation_;
+    int n_;
+    std::vector <Value> table_;
+  public:
+    PrefixScorer (const Cost & cost, const Permutation & pi);
+
+    virtual double score (int, int, int) const;
+    virtual double score (const Permutation &) const;
+    virtual void scores (int, int, int, int, double *, double *) const;
+    virtual void compute (const ParseControllerRef &);
+
+    int size () const { return n_; }
+    const Cost & costs () const { return cost_; }
+    Value rectangle (int, int, int, int) const;
+  private:
+    Value & table (int a, int b) { return table_ [a * (n_ + 1) + b]; }
+    const Value & table (int a, int b) const { return table_ [a * (n_ + 1) + b]; }
+  };
+
+  // The costs of a BeforeCost matrix.
+  class MatrixCost {
+  private:
+    BeforeCostRef cost_;
+  public:
+    typedef double Value;
+    MatrixCost (const BeforeCostRef & cost) : cost_ (cost) {}
+    double cost (int a, int b) const { return cost_ -> cost (a, b); }
+    double score (const Permutation & pi) const { return cost_ -> score (pi); }
+  };
+
+  // PrefixBeforeScorer is the PrefixScorer of a BeforeCost matrix.
+  class PrefixBeforeScorer : public PrefixScorer <MatrixCost> {
+  public:
+    PrefixBeforeScorer (const BeforeCostRef & cost, const Permutation & pi);
+  };
+
+  /**********************************************************************/
+
+  // The costs of tauCost(target), without building that matrix: the cost of
+  // a pair follows from the positions of its elements in the target, which
+  // is copied, so it may change after construction.  score(pi) counts
+  // discordant pairs by merge sort in O(n log n) time.
+  class TauCost {
+  private:
+    std::vector <int> rank_;
+  public:
+    typedef int Value;
+    TauCost (const Permutation & target);
+    int cost (int a, int b) const {
+      return a < b ? (rank_ [a] < rank_ [b] ? 1 : -1) : 0;
+    }
+    double score (const Permutation & pi) const;
+  };
+
+  // TauScorer is the PrefixScorer of tauCost(target), whose table holds
+  // integers.
+  class TauScorer : public PrefixScorer <TauCost> {
+  public:
+    TauScorer (const Permutation & target, const Permutation & pi);
+  };
+
+  // tauCost(target) scores pi by the number of pairs i < j that pi and target
+  // both put in the order (i, j), less the number that pi puts in that order
+  // and target does not.  tauScorer returns a TauScorer with those scores.
   BeforeCostRef tauCost (const Permutation & target);
   ScorerRef tauScorer (const Permutation & target, const Permutation & pi);
+  // Returns the number of pairs that a and b, two orders of the same
+  // elements, put in opposite orders (Kendall's tau distance), by merge sort.
+  long tauDistance (const Permutation & a, const Permutation & b);
+  // Returns tauCost(target) -> score(pi) in O(n log n) time.
+  double tauScore (const Permutation & target, const Permutation & pi);
 }
 
 #endif//_PERMUTE_BEFORE_SCORER_HH
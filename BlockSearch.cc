@@ -1,5 +1,3 @@
-#include <numeric>
-
 #include "BlockSearch.hh"
 #include "FullCell.hh"
 #include "StartEndCell.hh"
@@ -57,10 +55,6 @@ namespace Permute {
     Cell::build (cell_0n, cell_0j, cell_jn, score, false, Path::KEEP);
   }
 
-  typedef std::vector <double> V1D;
-  typedef std::vector <V1D> V2D;
-  typedef std::vector <V2D> V3D;
-
   void build (BlockInsertCell & cell, ChartRef chart, int i, int j, int k, double score) {
     if (i == 0) {
       if (k == chart -> getLength ()) {
@@ -93,7 +87,8 @@ namespace Permute {
 		      Fsa::ConstAutomatonRef fsa,
 		      CellMapRef cellMap,
 		      CellRef topCell,
-		      ConstCellRef epsilonClosure) {
+		      ConstCellRef epsilonClosure,
+		      BlockWorkspace & workspace) {
     ChartRef chart (new ChartImpl (pi, cellMap, topCell, 0));
     // Builds the chart without swaps.
     for (int i = 0; i < pi.size (); ++ i) {
@@ -115,40 +110,12 @@ namespace Permute {
 
     max_width = std::min (max_width ? max_width : static_cast <int> (pi.size ()),
 			  static_cast <int> (pi.size ()) / 2);
-    V3D delta (max_width);
+    PermutedCost cost (bc, pi);
+    workspace.resize (pi.size ());
     for (int w = 0; w < max_width; ++ w) {
-      V2D & dw = delta [w];
-      dw.resize (pi.size () - w - 1);
-      for (int i = 0; i < dw.size (); ++ i) {
-	V1D & dwi = dw [i];
-	dwi.resize (pi.size () + 1, 0.0);
+      for (int i = 0; i + w + 1 < pi.size (); ++ i) {
+	const double * dwi = workspace.fill (cost, w, i);
 	int j = i + w + 1;
-	for (int k = 0; k < i; ++ k) { // (k, i, j)
-	  dwi [k] =
-	    bc -> cost (pi [j - 1], pi [k]) -
-	    bc -> cost (pi [k], pi [j - 1]);
-	}
-	std::partial_sum (dwi.rend () - i, dwi.rend (),
-			  dwi.rend () - i);
-	if (w > 0) {
-	  std::transform (dwi.begin (), dwi.begin () + i,
-			  delta [w - 1] [i].begin (),
-			  dwi.begin (),
-			  std::plus <double> ());
-	}
-	for (int k = j + 1; k <= pi.size (); ++ k) { // (i, j, k)
-	  dwi [k] =
-	    bc -> cost (pi [k - 1], pi [i]) -
-	    bc -> cost (pi [i], pi [k - 1]);
-	}
-	std::partial_sum (dwi.begin () + j + 1, dwi.end (),
-			  dwi.begin () + j + 1);
-	if (w > 0) {
-	  std::transform (dwi.begin () + j + 1, dwi.end (),
-			  delta [w - 1] [i + 1].begin () + j + 1,
-			  dwi.begin () + j + 1,
-			  std::plus <double> ());
-	}
 //  	V1D::const_iterator max_it = std::max_element (dwi.begin (), dwi.end ());
 //  	if (* max_it > 0.0) {
 // 	  insert (pi, i, j, max_it - dwi.begin ());
@@ -169,8 +136,20 @@ namespace Permute {
 	  return newBestPath -> getScore () - bestScore;
 	}
       }
+      workspace.next ();
     }
 
     return 0.0;
   }
+
+  double blockSearch (Permutation & pi,
+		      const BeforeCostRef & bc,
+		      int max_width,
+		      Fsa::ConstAutomatonRef fsa,
+		      CellMapRef cellMap,
+		      CellRef topCell,
+		      ConstCellRef epsilonClosure) {
+    BlockWorkspace workspace;
+    return blockSearch (pi, bc, max_width, fsa, cellMap, topCell, epsilonClosure, workspace);
+  }
 }
@@ -0,0 +1,440 @@
+#include <algorithm>
+#include <cmath>
+
+#include "BranchAndBound.hh"
+#include "LinearOrdering.hh"
+
+namespace Permute {
+
+  namespace {
+    // A 3-cycle among the pairwise maxima, and the least cost of breaking it.
+    class Cycle {
+    public:
+      int a, b, c;
+      double penalty;
+      Cycle (int a, int b, int c, double penalty) :
+	a (a), b (b), c (c), penalty (penalty)
+      {}
+    };
+
+    class MorePenalty {
+    public:
+      bool operator () (const Cycle & x, const Cycle & y) const {
+	return x.penalty > y.penalty;
+      }
+    };
+
+    // A child of the current node, with Becker's priority.
+    class Candidate {
+    public:
+      int x;
+      double priority;
+      Candidate (int x, double priority) :
+	x (x), priority (priority)
+      {}
+    };
+
+    class BeforeCandidate {
+    public:
+      bool operator () (const Candidate & a, const Candidate & b) const {
+	return a.priority > b.priority;
+      }
+    };
+
+    // Binds explore to the solver for use with parallelFor.
+    class Explore {
+    private:
+      BranchAndBound & solver_;
+    public:
+      Explore (BranchAndBound & solver) : solver_ (solver) {}
+      void operator () (int index) const {
+	solver_.explore (index);
+      }
+    };
+
+    // The sums that the bound needs at one depth of the tree.  For each
+    // unplaced element v, out[v] and in[v] sum B[v,u] and B[u,v] over the
+    // other unplaced u, and spread[v] sums max(B[u,v], B[v,u]).
+    class Level {
+    public:
+      std::vector <double> out, in, spread;
+      double score, pairs, penalty;
+      Level (int n) :
+	out (n, 0.0), in (n, 0.0), spread (n, 0.0),
+	score (0.0), pairs (0.0), penalty (0.0)
+      {}
+    };
+  }
+
+  // Depth-first search below one prefix.  Keeps one Level per depth, so that
+  // backtracking restores the sums exactly.
+  class BranchAndBound::Search {
+  private:
+    // Nodes between synchronizations with the shared incumbent.
+    static const size_t SYNC = 4096;
+    BranchAndBound & solver_;
+    const int n_;
+    std::vector <int> prefix_;
+    std::vector <char> placed_;
+    uint64_t set_;
+    Table * table_;
+    // The number of placed elements of each cycle; a cycle counts toward the
+    // bound only while none are placed.
+    std::vector <int> cycles_;
+    std::vector <Level> levels_;
+    double incumbent_;
+    size_t pending_;
+    bool stop_;
+  public:
+    Search (BranchAndBound & solver, Table * table = 0);
+
+    void place (int x);
+    void unplace ();
+    void children (std::vector <int> & result) const;
+    void dfs ();
+    void sync ();
+  private:
+    double bound (int x) const;
+    bool dominated (int x) const;
+    bool repeated ();
+    void leaf ();
+  };
+
+  BranchAndBound::Search::Search (BranchAndBound & solver, Table * table) :
+    solver_ (solver),
+    n_ (solver.n_),
+    prefix_ (),
+    placed_ (solver.n_, 0),
+    set_ (0),
+    table_ (table),
+    cycles_ (solver.penalties_.size (), 0),
+    levels_ (solver.n_ + 1, Level (solver.n_)),
+    incumbent_ (0.0),
+    pending_ (0),
+    stop_ (false)
+  {
+    Level & top = levels_ [0];
+    for (int u = 0; u < n_; ++ u) {
+      for (int v = 0; v < n_; ++ v) {
+	if (u != v) {
+	  top.out [u] += solver_.cost (u, v);
+	  top.in [u] += solver_.cost (v, u);
+	  top.spread [u] += solver_.max (u, v);
+	  if (u < v) {
+	    top.pairs += solver_.max (u, v);
+	  }
+	}
+      }
+    }
+    for (std::vector <double>::const_iterator it = solver_.penalties_.begin (); it != solver_.penalties_.end (); ++ it) {
+      top.penalty += * it;
+    }
+    sync ();
+  }
+
+  void BranchAndBound::Search::place (int x) {
+    const Level & from = levels_ [prefix_.size ()];
+    Level & to = levels_ [prefix_.size () + 1];
+    to.score = from.score + from.out [x];
+    to.pairs = from.pairs - from.spread [x];
+    to.penalty = from.penalty;
+    const std::vector <int> & incident = solver_.incident_ [x];
+    for (std::vector <int>::const_iterator it = incident.begin (); it != incident.end (); ++ it) {
+      if (cycles_ [* it] ++ == 0) {
+	to.penalty -= solver_.penalties_ [* it];
+      }
+    }
+    placed_ [x] = 1;
+    set_ |= uint64_t (1) << (x & 63);
+    for (int v = 0; v < n_; ++ v) {
+      if (! placed_ [v]) {
+	to.out [v] = from.out [v] - solver_.cost (v, x);
+	to.in [v] = from.in [v] - solver_.cost (x, v);
+	to.spread [v] = from.spread [v] - solver_.max (v, x);
+      }
+    }
+    prefix_.push_back (x);
+  }
+
+  void BranchAndBound::Search::unplace () {
+    int x = prefix_.back ();
+    prefix_.pop_back ();
+    placed_ [x] = 0;
+    set_ &= ~ (uint64_t (1) << (x & 63));
+    const std::vector <int> & incident = solver_.incident_ [x];
+    for (std::vector <int>::const_iterator it = incident.begin (); it != incident.end (); ++ it) {
+      -- cycles_ [* it];
+    }
+  }
+
+  // Bounds every permutation that begins with the prefix followed by x.
+  double BranchAndBound::Search::bound (int x) const {
+    const Level & level = levels_ [prefix_.size ()];
+    double penalty = level.penalty;
+    const std::vector <int> & incident = solver_.incident_ [x];
+    for (std::vector <int>::const_iterator it = incident.begin (); it != incident.end (); ++ it) {
+      if (cycles_ [* it] == 0) {
+	penalty -= solver_.penalties_ [* it];
+      }
+    }
+    return level.score + level.out [x] + level.pairs - level.spread [x] - penalty;
+  }
+
+  // Returns whether moving x from the end of the prefix to some earlier
+  // position would gain.
+  bool BranchAndBound::Search::dominated (int x) const {
+    double delta = 0.0;
+    for (std::vector <int>::const_reverse_iterator it = prefix_.rbegin (); it != prefix_.rend (); ++ it) {
+      delta += solver_.cost (x, * it) - solver_.cost (* it, x);
+      if (delta > 0.0) {
+	return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns whether another prefix over the same set scored at least as well,
+  // and otherwise records this one.
+  bool BranchAndBound::Search::repeated () {
+    if (! table_ || prefix_.empty ()) {
+      return false;
+    }
+    const int bits = __builtin_ctzll (table_ -> size ());
+    Entry & entry = (* table_) [(set_ * 0x9E3779B97F4A7C15ull) >> (64 - bits)];
+    double score = levels_ [prefix_.size ()].score;
+    if (entry.set == set_ && entry.score >= score) {
+      return true;
+    }
+    entry.set = set_;
+    entry.score = score;
+    return false;
+  }
+
+  // Stores the children that survive pruning, best first.
+  void BranchAndBound::Search::children (std::vector <int> & result) const {
+    const Level & level = levels_ [prefix_.size ()];
+    std::vector <Candidate> candidates;
+    for (int x = 0; x < n_; ++ x) {
+      if (! placed_ [x] && ! dominated (x) && bound (x) > incumbent_) {
+	candidates.push_back (Candidate (x, level.out [x] - level.in [x]));
+      }
+    }
+    std::stable_sort (candidates.begin (), candidates.end (), BeforeCandidate ());
+    result.clear ();
+    for (std::vector <Candidate>::const_iterator it = candidates.begin (); it != candidates.end (); ++ it) {
+      result.push_back (it -> x);
+    }
+  }
+
+  void BranchAndBound::Search::dfs () {
+    if (++ pending_ >= SYNC) {
+      sync ();
+    }
+    if (stop_ || repeated ()) {
+      return;
+    }
+    if (prefix_.size () == n_) {
+      leaf ();
+      return;
+    }
+    std::vector <int> next;
+    children (next);
+    for (std::vector <int>::const_iterator it = next.begin (); it != next.end () && ! stop_; ++ it) {
+      // The incumbent may have improved since the children were chosen.
+      if (bound (* it) > incumbent_) {
+	place (* it);
+	dfs ();
+	unplace ();
+      }
+    }
+  }
+
+  void BranchAndBound::Search::leaf () {
+    double score = levels_ [n_].score;
+    if (score > incumbent_) {
+      pthread_mutex_lock (& solver_.mutex_);
+      if (score > solver_.incumbent_) {
+	solver_.incumbent_ = score;
+	solver_.best_ = prefix_;
+      }
+      incumbent_ = solver_.incumbent_;
+      pthread_mutex_unlock (& solver_.mutex_);
+    }
+  }
+
+  // Adds the nodes searched since the last call to the shared count, and
+  // reads the shared incumbent.
+  void BranchAndBound::Search::sync () {
+    pthread_mutex_lock (& solver_.mutex_);
+    solver_.nodes_ += pending_;
+    pending_ = 0;
+    if (solver_.nodeLimit_ > 0 && solver_.nodes_ >= solver_.nodeLimit_) {
+      solver_.aborted_ = true;
+    }
+    stop_ = solver_.aborted_;
+    incumbent_ = solver_.incumbent_;
+    pthread_mutex_unlock (& solver_.mutex_);
+  }
+
+  /**********************************************************************/
+
+  BranchAndBound::BranchAndBound (const BeforeCostRef & bc, const ThreadPoolRef & pool,
+				  size_t nodeLimit) :
+    bc_ (bc),
+    n_ (bc -> size ()),
+    cost_ (n_ * n_, 0.0),
+    max_ (n_ * n_, 0.0),
+    penalties_ (),
+    incident_ (n_),
+    pool_ (pool),
+    nodeLimit_ (nodeLimit),
+    frontier_ (),
+    incumbent_ (0.0),
+    best_ (),
+    nodes_ (0),
+    aborted_ (false)
+  {
+    pthread_mutex_init (& mutex_, 0);
+    for (int a = 0; a < n_; ++ a) {
+      for (int b = 0; b < n_; ++ b) {
+	if (a != b) {
+	  cost_ [a * n_ + b] = bc -> cost (a, b);
+	}
+      }
+    }
+    for (int a = 0; a < n_; ++ a) {
+      for (int b = 0; b < n_; ++ b) {
+	max_ [a * n_ + b] = std::max (cost (a, b), cost (b, a));
+      }
+    }
+    cycles ();
+  }
+
+  BranchAndBound::~BranchAndBound () {
+    pthread_mutex_destroy (& mutex_);
+  }
+
+  // Chooses 3-cycles among the pairwise maxima greedily by penalty, such that
+  // no two share a pair.
+  void BranchAndBound::cycles () {
+    std::vector <Cycle> found;
+    for (int a = 0; a < n_; ++ a) {
+      for (int b = a + 1; b < n_; ++ b) {
+	double ab = cost (a, b) - cost (b, a);
+	for (int c = b + 1; c < n_; ++ c) {
+	  double bc = cost (b, c) - cost (c, b),
+	    ca = cost (c, a) - cost (a, c);
+	  if ((ab > 0.0 && bc > 0.0 && ca > 0.0) ||
+	      (ab < 0.0 && bc < 0.0 && ca < 0.0)) {
+	    found.push_back (Cycle (a, b, c, std::min (std::fabs (ab), std::min (std::fabs (bc), std::fabs (ca)))));
+	  }
+	}
+      }
+    }
+    std::stable_sort (found.begin (), found.end (), MorePenalty ());
+    std::vector <char> used (n_ * n_, 0);
+    for (std::vector <Cycle>::const_iterator it = found.begin (); it != found.end (); ++ it) {
+      if (used [it -> a * n_ + it -> b] || used [it -> b * n_ + it -> c] || used [it -> a * n_ + it -> c]) {
+	continue;
+      }
+      used [it -> a * n_ + it -> b] = used [it -> b * n_ + it -> c] = used [it -> a * n_ + it -> c] = 1;
+      int t = penalties_.size ();
+      penalties_.push_back (it -> penalty);
+      incident_ [it -> a].push_back (t);
+      incident_ [it -> b].push_back (t);
+      incident_ [it -> c].push_back (t);
+    }
+  }
+
+  // Expands the top of the tree breadth first until it holds at least size
+  // prefixes, or until they are complete.
+  void BranchAndBound::expand (int size) {
+    frontier_.assign (1, std::vector <int> ());
+    Search search (* this);
+    std::vector <int> next;
+    while (frontier_.size () < size && frontier_.front ().size () < n_) {
+      std::vector <std::vector <int> > deeper;
+      for (std::vector <std::vector <int> >::const_iterator it = frontier_.begin (); it != frontier_.end (); ++ it) {
+	for (std::vector <int>::const_iterator x = it -> begin (); x != it -> end (); ++ x) {
+	  search.place (* x);
+	}
+	search.children (next);
+	for (std::vector <int>::const_iterator x = next.begin (); x != next.end (); ++ x) {
+	  deeper.push_back (* it);
+	  deeper.back ().push_back (* x);
+	}
+	for (int i = 0; i < it -> size (); ++ i) {
+	  search.unplace ();
+	}
+      }
+      frontier_.swap (deeper);
+      if (frontier_.empty ()) {
+	break;
+      }
+    }
+    search.sync ();
+  }
+
+  void BranchAndBound::explore (int index) {
+    Table * table = acquire ();
+    Search search (* this, table);
+    const std::vector <int> & prefix = frontier_ [index];
+    for (std::vector <int>::const_iterator it = prefix.begin (); it != prefix.end (); ++ it) {
+      search.place (* it);
+    }
+    search.dfs ();
+    search.sync ();
+    release (table);
+  }
+
+  // Returns a free table, or a new one, sized to the problem.  Returns 0 for
+  // more than 64 elements.
+  BranchAndBound::Table * BranchAndBound::acquire () {
+    if (n_ > 64) {
+      return 0;
+    }
+    pthread_mutex_lock (& mutex_);
+    Table * table = 0;
+    if (! tables_.empty ()) {
+      table = tables_.back ();
+      tables_.pop_back ();
+    }
+    pthread_mutex_unlock (& mutex_);
+    if (! table) {
+      table = new Table (size_t (1) << std::min (n_ + 2, 20));
+    }
+    return table;
+  }
+
+  void BranchAndBound::release (Table * table) {
+    if (table) {
+      pthread_mutex_lock (& mutex_);
+      tables_.push_back (table);
+      pthread_mutex_unlock (& mutex_);
+    }
+  }
+
+  double BranchAndBound::solve (Permutation & pi) {
+    nodes_ = 0;
+    aborted_ = false;
+
+    // Starts from Becker's greedy order improved by LS_f.
+    Permutation start = pi;
+    becker_greedy (start, bc_);
+    PermutedCost cost (bc_, start);
+    while (visit (start, cost) > 0.0);
+    incumbent_ = cost.score ();
+    best_.assign (start.begin (), start.end ());
+
+    expand (pool_ ? 64 * pool_ -> size () : 1);
+    parallelFor (pool_, 0, frontier_.size (), Explore (* this), 1);
+    frontier_.clear ();
+    for (std::vector <Table *>::const_iterator it = tables_.begin (); it != tables_.end (); ++ it) {
+      delete * it;
+    }
+    tables_.clear ();
+
+    std::copy (best_.begin (), best_.end (), pi.begin ());
+    return incumbent_;
+  }
+}
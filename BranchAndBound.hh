@@ -0,0 +1,100 @@
+#ifndef _PERMUTE_BRANCH_AND_BOUND_HH
+#define _PERMUTE_BRANCH_AND_BOUND_HH
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "BeforeScorer.hh"
+#include "Permutation.hh"
+#include "ThreadPool.hh"
+
+namespace Permute {
+
+  // Solves the linear ordering problem exactly, for instances of up to about
+  // 40 to 60 elements, by branch and bound over prefixes: each node of the
+  // tree fixes the first few elements of the permutation, and its children
+  // append one more.  Appending x earns B[x,v] for every v still unplaced, so
+  // the score of a prefix is exact.
+  //
+  // The rest of the permutation is bounded by relaxing transitivity: each
+  // pair of unplaced elements contributes max(B[u,v], B[v,u]), as in
+  // BeforeCost::normalize, less the penalties of a fixed set of 3-cycles
+  // among those maxima that share no pair.  Some pair of each such cycle must
+  // be reversed, at a cost of at least its smallest difference.  A node is
+  // also pruned if moving its last element earlier within the prefix would
+  // gain, since no optimum has an improving insert move.  Children are tried
+  // in Becker's (1967) order, by the difference between what each element
+  // earns before and after the other unplaced elements, and the first
+  // incumbent comes from becker_greedy followed by LS_f.
+  //
+  // For up to 64 elements, a table keyed by the set of placed elements prunes a
+  // prefix whenever another prefix over the same set scored at least as well,
+  // since both have the same completions.  Entries from finished subtrees stay
+  // valid, so each thread keeps its table from one subtree to the next.
+  //
+  // The top of the tree is expanded on the calling thread, and the subtrees
+  // below it are searched on the thread pool.  Threads share the incumbent
+  // through a mutex, reading it every few thousand nodes.  The score of the
+  // result is the same for any number of threads, though among several
+  // optima the one found may differ.  With non-integer costs the bounds are
+  // subject to rounding, so the result is optimal up to rounding error.
+  class BranchAndBound {
+  public:
+    class Search;
+  private:
+    friend class Search;
+    class Entry {
+    public:
+      uint64_t set;
+      double score;
+      Entry () : set (0), score (0.0) {}
+    };
+    typedef std::vector <Entry> Table;
+    // The costs are copied into plain matrices, so that threads never touch
+    // the reference count of the cost, which is copied on the calling thread.
+    BeforeCostRef bc_;
+    int n_;
+    std::vector <double> cost_;
+    std::vector <double> max_;
+    // The penalty of each chosen 3-cycle, and the cycles of each element.
+    std::vector <double> penalties_;
+    std::vector <std::vector <int> > incident_;
+    ThreadPoolRef pool_;
+    size_t nodeLimit_;
+    std::vector <std::vector <int> > frontier_;
+    pthread_mutex_t mutex_;
+    double incumbent_;
+    std::vector <int> best_;
+    // Tables not in use by any thread.
+    std::vector <Table *> tables_;
+    size_t nodes_;
+    bool aborted_;
+  public:
+    // A positive node limit stops the search after about that many nodes.
+    BranchAndBound (const BeforeCostRef & bc, const ThreadPoolRef & pool,
+		    size_t nodeLimit = 0);
+    ~BranchAndBound ();
+
+    // Finds an optimal permutation, leaves it in pi, and returns its score.
+    double solve (Permutation & pi);
+    // Returns whether the last solve finished within the node limit, which
+    // certifies its result as optimal.
+    bool optimal () const { return ! aborted_; }
+    size_t nodes () const { return nodes_; }
+
+    // Searches the subtree below prefix index of the frontier.  Public for
+    // the thread pool.
+    void explore (int index);
+  private:
+    BranchAndBound (const BranchAndBound &);
+    BranchAndBound & operator = (const BranchAndBound &);
+    double cost (int a, int b) const { return cost_ [a * n_ + b]; }
+    double max (int a, int b) const { return max_ [a * n_ + b]; }
+    void cycles ();
+    void expand (int size);
+    Table * acquire ();
+    void release (Table * table);
+  };
+}
+
+#endif//_PERMUTE_BRANCH_AND_BOUND_HH
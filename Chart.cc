@@ -1,7 +1,53 @@
 #include "Chart.hh"
 #include "FullCell.hh"
+#include "ParsePolicy.hh"
 
 namespace Permute {
+  namespace {
+    // Populates the cells of the chart for every split that the policy
+    // allows.  See Chart::permute.
+    template <class Policy>
+    void permuteSpans (const Policy & policy, Chart & chart, Scorer & scorer) {
+      int length = chart.getLength ();
+      for (int span = 2; span <= length; ++span) {
+	for (int begin = 0; begin <= length - span; ++begin) {
+	  int end = begin + span;
+	  CellRef parent = chart.getCell (begin, end);
+	  parent -> clear ();
+	  for (typename Policy::iterator middle = policy.begin (begin, end),
+		 middle_end = policy.end (begin, end);
+	       middle != middle_end; ++middle) {
+	    ConstCellRef
+	      left = chart.getConstCell (begin, middle),
+	      right = chart.getConstCell (middle, end);
+	    Cell::build (parent, left, right, scorer.score (begin, middle, end), false,
+			 (end - middle == 1) ? Path::NEITHER : Path::SWAP);
+	    if (! chart.getWindow () || chart.getWindow () >= span) {
+	      Cell::build (parent, right, left, scorer.score (end, middle, begin), true,
+			   (middle - begin == 1) ? Path::NEITHER : Path::KEEP);
+	    }
+	  }
+	}
+      }
+    }
+
+    // Binds permuteSpans to a chart and scorer for use with dispatch.
+    class PermuteSpans {
+    private:
+      Chart & chart_;
+      Scorer & scorer_;
+    public:
+      PermuteSpans (Chart & chart, Scorer & scorer) :
+	chart_ (chart),
+	scorer_ (scorer)
+      {}
+      template <class Policy>
+      void operator () (const Policy & policy) const {
+	permuteSpans (policy, chart_, scorer_);
+      }
+    };
+  }
+
   // Clears the scorer and calls the Chart's beforePermute method.  Iterates
   // over the spans in order by width.  At each span, populates the
   // corresponding cell with a call to Cell::build for every split of the span
@@ -10,26 +56,7 @@ namespace Permute {
   void Chart::permute (ChartRef chart, ParseControllerRef controller, ScorerRef scorer) {
     scorer -> compute (controller);
     chart -> beforePermute (controller, scorer);
-    int length = chart -> getLength ();
-    for (int span = 2; span <= length; ++span) {
-      for (int begin = 0; begin <= length - span; ++begin) {
-	int end = begin + span;
-	CellRef parent = chart -> getCell (begin, end);
-	parent -> clear ();
-	for (ParseController::iterator middle = controller -> begin (begin, end);
-	     middle != controller -> end (begin, end); ++middle) {
-	  ConstCellRef
-	    left = chart -> getConstCell (begin, middle),
-	    right = chart -> getConstCell (middle, end);
-	  Cell::build (parent, left, right, scorer -> score (begin, middle, end), false,
-		       (end - middle == 1) ? Path::NEITHER : Path::SWAP);
-	  if (! chart -> getWindow () || chart -> getWindow () >= span) {
-	    Cell::build (parent, right, left, scorer -> score (end, middle, begin), true,
-			 (middle - begin == 1) ? Path::NEITHER : Path::KEEP);
-	  }
-	}
-      }
-    }
+    dispatch (controller, PermuteSpans (* chart, * scorer));
     chart -> afterPermute (controller, scorer);
   }
 
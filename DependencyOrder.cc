@@ -94,6 +94,8 @@ namespace Permute {
   }
 
   void greedy (BeforeCostRef bc, Permutation & pi) {
-    while (block_lsf (pi, bc, pi.size ()) > 0);
+    PermutedCost cost (bc, pi);
+    BlockWorkspace workspace;
+    while (block_lsf (pi, cost, pi.size (), workspace) > 0);
   }
 }
@@ -0,0 +1,339 @@
+#include <map>
+
+#include "FeaturePlan.hh"
+
+namespace Permute {
+
+  namespace {
+    // The symbol at position x, read the way PV::features reads it.
+    std::string symbol (const Permutation & pi, size_t x, bool dependency) {
+      if (dependency) {
+	return pi.symbol (x);
+      } else {
+	return pi.alphabet () -> symbol (pi.label (pi [x]));
+      }
+    }
+
+    // Adapt each store of weights to fill: find returns a Lookup of the
+    // weight of a key, which add adds to a Sum if there is one.
+    class KeyLookup {
+    private:
+      const KeyTable & table_;
+    public:
+      typedef const WRef * Lookup;
+      KeyLookup (const KeyTable & table) : table_ (table) {}
+      Lookup find (FeatureKey key) const { return table_.find (key); }
+      static void add (Sum & sum, Lookup w) {
+	if (w) {
+	  sum += * w;
+	}
+      }
+    };
+
+    class MappedLookup {
+    private:
+      const MappedPV & mapping_;
+    public:
+      typedef const double * Lookup;
+      MappedLookup (const MappedPV & mapping) : mapping_ (mapping) {}
+      Lookup find (FeatureKey key) const { return mapping_.find (key); }
+      static void add (Sum & sum, Lookup w) {
+	if (w) {
+	  sum += * w;
+	}
+      }
+    };
+
+    // Every key has a weight, but signed hashing may subtract it.
+    class HashLookup {
+    private:
+      const HashedWeights & weights_;
+    public:
+      typedef std::pair <WRef, int> Lookup;
+      HashLookup (const HashedWeights & weights) : weights_ (weights) {}
+      Lookup find (FeatureKey key) const {
+	return Lookup (weights_.find (key), weights_.sign (key));
+      }
+      static void add (Sum & sum, const Lookup & w) {
+	if (w.second < 0) {
+	  sum -= w.first;
+	} else {
+	  sum += w.first;
+	}
+      }
+    };
+  }
+
+  FeaturePlan::FeaturePlan (const PV & pv, const Permutation & words, const Permutation & pos) :
+    pv_ (pv),
+    n_ (words.size ()),
+    parents_ (0),
+    tags_ (),
+    tagCount_ (0),
+    pair_ (),
+    between_ ()
+  {
+    plan ();
+    build (words, pos, 0);
+  }
+
+  FeaturePlan::FeaturePlan (const PV & pv,
+			    const Permutation & words,
+			    const Permutation & pos,
+			    const std::vector <int> & parents,
+			    const Permutation & labels) :
+    pv_ (pv),
+    n_ (words.size ()),
+    parents_ (& parents),
+    tags_ (),
+    tagCount_ (0),
+    pair_ (),
+    between_ ()
+  {
+    plan ();
+    build (words, pos, & labels);
+  }
+
+  FeaturePlan::Source FeaturePlan::source (FeatureName f) {
+    switch (f) {
+    case lPOSm1:
+    case lPOS:
+    case lWord:
+    case lPOSp1:
+    case lParent:
+    case lSibling:
+    case lPrefix:
+    case lSuffix:
+      return LEFT;
+    case rPOSm1:
+    case rPOS:
+    case rWord:
+    case rPOSp1:
+    case rParent:
+    case rSibling:
+    case rPrefix:
+    case rSuffix:
+      return RIGHT;
+    case bPOS:
+      return BETWEEN;
+    case Dist:
+      return DISTANCE;
+    default:
+      return NONE;
+    }
+  }
+
+  // Sorts the templates into those that fire once per pair and those that
+  // fire once per position between, and finds what each needs.  Without
+  // dependency parses, templates over parent or sibling labels never fire.
+  void FeaturePlan::plan () {
+    const TemplateList & tl = pv_.templates ();
+    for (TemplateList::const_iterator it = tl.begin (); it != tl.end (); ++ it) {
+      Template t;
+      t.it = it;
+      t.relations = (it -> first [lParent] ? LEFT_PARENT : 0)
+	| (it -> first [rParent] ? RIGHT_PARENT : 0)
+	| (it -> first [lSibling] || it -> first [rSibling] ? SIBLINGS : 0);
+      t.right = t.relations != 0;
+      for (int f = 0; f < NoFeatureName; ++ f) {
+	if (it -> first [f] && (source (FeatureName (f)) == RIGHT || source (FeatureName (f)) == DISTANCE)) {
+	  t.right = true;
+	}
+      }
+      if (t.relations && ! parents_) {
+	continue;
+      } else if (it -> first [bPOS]) {
+	between_.push_back (t);
+      } else {
+	pair_.push_back (t);
+      }
+    }
+  }
+
+  // Interns the value of every feature that some template reads, at every
+  // token or distance where a pair can read it.
+  void FeaturePlan::build (const Permutation & words, const Permutation & pos, const Permutation * labels) {
+    const TemplateList & tl = pv_.templates ();
+    const bool dependency = parents_ != 0;
+    std::vector <bool> used (NoFeatureName, false);
+    for (std::vector <Template>::const_iterator t = pair_.begin (); t != pair_.end (); ++ t) {
+      for (int f = 0; f < NoFeatureName; ++ f) {
+	used [f] = used [f] || t -> it -> first [f];
+      }
+    }
+    for (std::vector <Template>::const_iterator t = between_.begin (); t != between_.end (); ++ t) {
+      for (int f = 0; f < NoFeatureName; ++ f) {
+	used [f] = used [f] || t -> it -> first [f];
+      }
+    }
+
+    for (int f = 0; f < NoFeatureName; ++ f) {
+      if (! used [f]) {
+	continue;
+      }
+      const FeatureName name = FeatureName (f);
+      std::vector <int> & ids = ids_ [f];
+      ids.assign (n_, -1);
+      for (int x = 0; x < n_; ++ x) {
+	// Skips the values no pair reads, so as not to intern them.
+	const bool read = source (name) == LEFT ? x + 1 < n_
+	  : source (name) == BETWEEN ? x > 0 && x + 1 < n_
+	  : x > 0;
+	if (! read) {
+	  continue;
+	}
+	std::string value;
+	switch (name) {
+	case lPOSm1:
+	  value = x == 0 ? "<s>" : symbol (pos, x - 1, dependency);
+	  break;
+	case lPOS:
+	case rPOS:
+	case bPOS:
+	  value = symbol (pos, x, dependency);
+	  break;
+	case lWord:
+	case rWord:
+	  value = symbol (words, x, dependency);
+	  break;
+	case lPOSp1:
+	  value = symbol (pos, x + 1, dependency);
+	  break;
+	case rPOSm1:
+	  value = symbol (pos, x - 1, dependency);
+	  break;
+	case rPOSp1:
+	  value = x + 1 == pos.size () ? "</s>" : symbol (pos, x + 1, dependency);
+	  break;
+	case Dist:
+	  value = pv_.distance (x);
+	  break;
+	case lParent:
+	case rParent:
+	case lSibling:
+	case rSibling:
+	  value = labels -> symbol (x);
+	  break;
+	case lPrefix:
+	case rPrefix:
+	  value = PV::prefix (words.symbol (x));
+	  break;
+	case lSuffix:
+	case rSuffix:
+	  value = PV::suffix (words.symbol (x));
+	  break;
+	default:
+	  break;
+	}
+	ids [x] = tl.id (name, value);
+      }
+    }
+
+    // Numbers the tags within the sentence, for fill's lookup cache.
+    if (used [bPOS]) {
+      std::map <int, int> numbers;
+      tags_.assign (n_, 0);
+      for (int x = 0; x < n_; ++ x) {
+	std::map <int, int>::const_iterator it = numbers.find (ids_ [bPOS] [x]);
+	if (it == numbers.end ()) {
+	  it = numbers.insert (std::make_pair (ids_ [bPOS] [x], tagCount_ ++)).first;
+	}
+	tags_ [x] = it -> second;
+      }
+    }
+  }
+
+  int FeaturePlan::relations (int i, int j) const {
+    if (! parents_) {
+      return 0;
+    }
+    const std::vector <int> & parents = * parents_;
+    return (parents [i] == j ? LEFT_PARENT : 0)
+      | (parents [j] == i ? RIGHT_PARENT : 0)
+      | (parents [i] == parents [j] ? SIBLINGS : 0);
+  }
+
+  // Appends the weights of each pair in the order of PV::features: the pair
+  // templates, then the bPOS templates at each b in turn.  The weight of
+  // bPOS template t with the tag numbered g is cached in slot t * tagCount_
+  // + g, and stamped with the pair, or only with i if t reads nothing about
+  // j, for which it is valid.
+  void FeaturePlan::fill (SumBeforeCost & bc) const {
+    if (pv_.mapped ()) {
+      fill (bc, MappedLookup (pv_.mapping ()));
+    } else if (pv_.hashed ()) {
+      bc.reserve (bound ());
+      fill (bc, HashLookup (pv_.hashing ()));
+    } else {
+      fill (bc, KeyLookup (pv_.table ()));
+    }
+  }
+
+  // Every pair template fires at most once for each pair, and every bPOS
+  // template once for each b between them, of which there are n choose 3.
+  // Only a hashed PV finds a weight for every key, so that the bound is
+  // close; a keyed PV may store a small fraction of them, and leaves the
+  // array to grow.
+  size_t FeaturePlan::bound () const {
+    const size_t n = n_;
+    const size_t pairs = n * (n - 1) / 2;
+    const size_t triples = n < 3 ? 0 : n * (n - 1) * (n - 2) / 6;
+    return pair_.size () * pairs + between_.size () * triples;
+  }
+
+  template <class Table>
+  void FeaturePlan::fill (SumBeforeCost & bc, const Table & table) const {
+    typedef typename Table::Lookup Lookup;
+    const TemplateList & tl = pv_.templates ();
+    std::vector <int> ids (NoFeatureName, -1);
+    std::vector <Lookup> cache (between_.size () * tagCount_, Lookup ());
+    std::vector <long> stamps (cache.size (), -1);
+    std::vector <bool> fires (between_.size (), false);
+
+    for (int i = 0; i + 1 < n_; ++ i) {
+      for (int f = 0; f < NoFeatureName; ++ f) {
+	if (source (FeatureName (f)) == LEFT && ! ids_ [f].empty ()) {
+	  ids [f] = ids_ [f] [i];
+	}
+      }
+      for (int j = i + 1; j < n_; ++ j) {
+	for (int f = 0; f < NoFeatureName; ++ f) {
+	  if (ids_ [f].empty ()) {
+	    continue;
+	  } else if (source (FeatureName (f)) == RIGHT) {
+	    ids [f] = ids_ [f] [j];
+	  } else if (source (FeatureName (f)) == DISTANCE) {
+	    ids [f] = ids_ [f] [j - i];
+	  }
+	}
+	const int holds = relations (i, j);
+	Sum sum = bc (i, j);
+
+	for (std::vector <Template>::const_iterator t = pair_.begin (); t != pair_.end (); ++ t) {
+	  if ((t -> relations & holds) == t -> relations) {
+	    Table::add (sum, table.find (tl.keyFromIterator (ids, t -> it)));
+	  }
+	}
+
+	for (int t = 0; t < between_.size (); ++ t) {
+	  fires [t] = (between_ [t].relations & holds) == between_ [t].relations;
+	}
+	for (int b = i + 1; b < j; ++ b) {
+	  ids [bPOS] = ids_ [bPOS] [b];
+	  for (int t = 0; t < between_.size (); ++ t) {
+	    if (! fires [t]) {
+	      continue;
+	    }
+	    const int slot = t * tagCount_ + tags_ [b];
+	    const long stamp = between_ [t].right ? long (i) * n_ + j : i;
+	    if (stamps [slot] != stamp) {
+	      stamps [slot] = stamp;
+	      cache [slot] = table.find (tl.keyFromIterator (ids, between_ [t].it));
+	    }
+	    Table::add (sum, cache [slot]);
+	  }
+	}
+      }
+    }
+  }
+}
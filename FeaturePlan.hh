@@ -0,0 +1,84 @@
+#ifndef _PERMUTE_FEATURE_PLAN_HH
+#define _PERMUTE_FEATURE_PLAN_HH
+
+#include "PV.hh"
+
+namespace Permute {
+
+  // A FeaturePlan fills a SumBeforeCost with the same features that
+  // PV::features finds for each pair (i,j) of a sentence, in the same order,
+  // but composes them from attributes computed once per sentence.  The
+  // constructor interns the value of each feature of each token, and of each
+  // distance, so that filling the matrix never touches a string: each
+  // feature is a key built from those ids and looked up in the PV's
+  // KeyTable.
+  //
+  // The bPOS templates fire once for each position b between i and j.  Their
+  // weights depend only on the tag at b, so fill looks each one up once per
+  // distinct tag between i and j, or, for templates that depend on nothing
+  // else about j, once per tag as j advances from i.  The number of lookups
+  // is then O(n^2) per template for a fixed tag set, rather than O(n^3);
+  // only appending the weights to each Sum still visits every b.
+  //
+  // The PV must be indexed, mapped or hashed, and the words must be the
+  // identity permutation.  The weights of a mapped PV are added to each Sum as
+  // constants.
+  class FeaturePlan {
+  private:
+    // Where a feature takes its value from: token i, token j, the token b
+    // between them, or the distance j - i.
+    typedef enum {
+      LEFT,
+      RIGHT,
+      BETWEEN,
+      DISTANCE,
+      NONE
+    } Source;
+    // The dependency relations that a template needs to fire.
+    typedef enum {
+      LEFT_PARENT = 1,
+      RIGHT_PARENT = 2,
+      SIBLINGS = 4
+    } Relation;
+    class Template {
+    public:
+      TemplateList::const_iterator it;
+      int relations;
+      // Whether the template reads anything about j, including a relation.
+      bool right;
+    };
+    const PV & pv_;
+    int n_;
+    const std::vector <int> * parents_;
+    // ids_ [f] [x] holds the id of feature f at token or distance x.
+    std::vector <int> ids_ [NoFeatureName];
+    // The tag at each position, numbered within the sentence.
+    std::vector <int> tags_;
+    int tagCount_;
+    std::vector <Template> pair_;
+    std::vector <Template> between_;
+  public:
+    FeaturePlan (const PV & pv, const Permutation & words, const Permutation & pos);
+    FeaturePlan (const PV & pv,
+		 const Permutation & words,
+		 const Permutation & pos,
+		 const std::vector <int> & parents,
+		 const Permutation & labels);
+
+    // Adds the weights of the features of each pair (i,j), i < j, to bc(i,j).
+    void fill (SumBeforeCost & bc) const;
+  private:
+    FeaturePlan (const FeaturePlan &);
+    FeaturePlan & operator = (const FeaturePlan &);
+    template <class Table>
+    void fill (SumBeforeCost & bc, const Table & table) const;
+    // An upper bound on the number of weights that fill adds to bc.
+    size_t bound () const;
+    static Source source (FeatureName);
+    void build (const Permutation & words, const Permutation & pos, const Permutation * labels);
+    void plan ();
+    int relations (int i, int j) const;
+  };
+}
+
+#endif//_PERMUTE_FEATURE_PLAN_HH
@@ -1,6 +1,7 @@
 #include "Chart.hh"
 #include "GradientChart.hh"
 #include "Log.hh"
+#include "ParsePolicy.hh"
 
 namespace Permute {
 
@@ -11,10 +12,24 @@ namespace Permute {
     outside_ (inside_)
   {}
 
-  void GradientChart::parse (const ParseControllerRef & controller,
-			     GradientScorer & scorer,
-			     PV & pv) {
-    scorer.compute (controller);
+  // Binds insideOutside to a GradientChart and scorer for use with dispatch.
+  class GradientChart::InsideOutside {
+  private:
+    GradientChart & chart_;
+    GradientScorer & scorer_;
+  public:
+    InsideOutside (GradientChart & chart, GradientScorer & scorer) :
+      chart_ (chart),
+      scorer_ (scorer)
+    {}
+    template <class Policy>
+    void operator () (const Policy & policy) const {
+      chart_.insideOutside (policy, scorer_);
+    }
+  };
+
+  template <class Policy>
+  void GradientChart::insideOutside (const Policy & policy, GradientScorer & scorer) {
     // Computes insides.
     for (int i = 0; i < n_; ++ i) {
       inside (i, i + 1, Path::KEEP) = 0.0;
@@ -24,8 +39,8 @@ namespace Permute {
       for (int begin = 0, end = begin + span; end <= n_; ++ begin, ++ end) {
 	double & keep_inside (inside (begin, end, Path::KEEP));
 	double & swap_inside (inside (begin, end, Path::SWAP));
-	for (ParseController::iterator middle = controller -> begin (begin, end),
-	       middle_end = controller -> end (begin, end);
+	for (typename Policy::iterator middle = policy.begin (begin, end),
+	       middle_end = policy.end (begin, end);
 	     middle != middle_end;
 	     ++ middle) {
 	  Log::increase (keep_inside,
@@ -46,8 +61,8 @@ namespace Permute {
       for (int begin = 0, end = begin + span; end <= n_; ++ begin, ++ end) {
 	double keep_outside = outside (begin, end, Path::KEEP);
 	double swap_outside = outside (begin, end, Path::SWAP);
-	for (ParseController::iterator middle = controller -> begin (begin, end),
-	       middle_end = controller -> end (begin, end);
+	for (typename Policy::iterator middle = policy.begin (begin, end),
+	       middle_end = policy.end (begin, end);
 	     middle != middle_end;
 	     ++ middle) {
 	  // Increases the gradient of (i,j) before (j,k) by outside(i,k,KEEP) *
@@ -95,6 +110,13 @@ namespace Permute {
 	}
       }
     }
+  }
+
+  void GradientChart::parse (const ParseControllerRef & controller,
+			     GradientScorer & scorer,
+			     PV & pv) {
+    scorer.compute (controller);
+    dispatch (controller, InsideOutside (* this, scorer));
     // Zeroes out the parameters.
     for (PV::iterator it = pv.begin (); it != pv.end (); ++ it) {
       it -> second = 0.0;
@@ -138,13 +160,21 @@ namespace Permute {
   /**********************************************************************/
 
   GradientScorer::GradientScorer (const SumBeforeCostRef & cost,
-				  const Permutation & pi) :
-    BeforeScorer (cost, pi),
+				  const Permutation & pi,
+				  Layout layout) :
+    BeforeScorer (cost, pi, layout),
     cost_ (cost),
     permutation_ (pi),
-    gradient_ (2 * BeforeScorer::index (size () - 2, size () - 1, size ()) + 2)
+    gradient_ (2 * slots ())
   {}
 
+  // Sizes the gradients to match the slots of the scores, which in the SPARSE
+  // layout are only known once the controller has been seen.
+  void GradientScorer::compute (const ParseControllerRef & controller) {
+    BeforeScorer::compute (controller);
+    gradient_.assign (2 * slots (), 0.0);
+  }
+
   // Only adds the gradient if i < j.  The other entries in the matrix are zero,
   // so they don't have gradients.
   void GradientScorer::addGradient (int left, int right, double gradient) {
@@ -155,13 +185,25 @@ namespace Permute {
     }
   }
 
+  // Binds propagate to a GradientScorer for use with dispatch.
+  class GradientScorer::Propagate {
+  private:
+    GradientScorer & scorer_;
+  public:
+    Propagate (GradientScorer & scorer) : scorer_ (scorer) {}
+    template <class Policy>
+    void operator () (const Policy & policy) const {
+      scorer_.propagate (policy);
+    }
+  };
+
   // Propagates gradients from internal nodes down to individual LOP costs.
-  void GradientScorer::finish (const ParseControllerRef & controller,
-			       bool numerator) {
+  template <class Policy>
+  void GradientScorer::propagate (const Policy & policy) {
     for (int span = size (); span >= 2; -- span) {
       for (int begin = 0, end = begin + span; end <= size (); ++ begin, ++ end) {
-	for (ParseController::iterator middle = controller -> begin (begin, end),
-	       middle_end = controller -> end (begin, end);
+	for (typename Policy::iterator middle = policy.begin (begin, end),
+	       middle_end = policy.end (begin, end);
 	     middle != middle_end;
 	     ++ middle) {
 	  double g = gradient (begin, middle, end);
@@ -179,6 +221,11 @@ namespace Permute {
 	}
       }
     }
+  }
+
+  void GradientScorer::finish (const ParseControllerRef & controller,
+			       bool numerator) {
+    dispatch (controller, Propagate (* this));
     if (numerator) {
       // Computes the gradient of the numerator using the current permutation.
       for (Permutation::const_iterator i = permutation_.begin ();
@@ -196,9 +243,11 @@ namespace Permute {
     if (i == j || j == k) {
       return dummy;
     } else if (i < k) {
-      return gradient_ [2 * BeforeScorer::index (i, j, k)];
+      int s = slot (i, j, k);
+      return s < 0 ? dummy : gradient_ [2 * s];
     } else {
-      return gradient_ [2 * BeforeScorer::index (k, j, i) + 1];
+      int s = slot (k, j, i);
+      return s < 0 ? dummy : gradient_ [2 * s + 1];
     }
   }
 
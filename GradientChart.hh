@@ -23,6 +23,8 @@ namespace Permute {
     void parse (const ParseControllerRef &, GradientScorer &, PV &);
 
   private:
+    class InsideOutside;
+    template <class Policy> void insideOutside (const Policy &, GradientScorer &);
     int index (int i, int j, Path::Type type) const;
     const double & inside (int i, int j, Path::Type type) const;
     double & inside (int i, int j, Path::Type type);
@@ -39,11 +41,16 @@ namespace Permute {
     const Permutation & permutation_;
     std::vector <double> gradient_;
   public:
-    GradientScorer (const SumBeforeCostRef & cost, const Permutation & pi);
+    GradientScorer (const SumBeforeCostRef & cost, const Permutation & pi,
+		    Layout = DENSE);
+    virtual void compute (const ParseControllerRef &);
     const double & gradient (int i, int j, int k) const;
     double & gradient (int i, int j, int k);
     void addGradient (int left, int right, double gradient);
     void finish (const ParseControllerRef & controller, bool numerator = true);
+  private:
+    class Propagate;
+    template <class Policy> void propagate (const Policy &);
   };
 }
 
@@ -0,0 +1,256 @@
+#include "InsertScan.hh"
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define PERMUTE_INSERT_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace Permute {
+  namespace {
+    // The scan of one row: the running gain, the best gain so far and its
+    // target.
+    struct Lane {
+      double d;
+      double best;
+      int target;
+    };
+
+    // Continues the leftward scan of row y over r = from down to to.
+    void left (const PermutedCost & cost, int y, int from, int to, Lane & lane) {
+      const PermutedCost::Pair * row = cost.row (y);
+      for (int r = from; r >= to; -- r) {
+	lane.d -= row [r].after;
+	lane.d += row [r].before;
+	if (lane.d > lane.best) {
+	  lane.best = lane.d;
+	  lane.target = r;
+	}
+      }
+    }
+
+    // Continues the rightward scan of row y over r = from up to to.
+    void right (const PermutedCost & cost, int y, int from, int to, Lane & lane) {
+      const PermutedCost::Pair * row = cost.row (y);
+      for (int r = from; r <= to; ++ r) {
+	lane.d -= row [r].before;
+	lane.d += row [r].after;
+	if (lane.d > lane.best) {
+	  lane.best = lane.d;
+	  lane.target = r;
+	}
+      }
+    }
+
+    Lane start (int y) {
+      Lane lane = { 0.0, 0.0, y };
+      return lane;
+    }
+
+    void scan1 (const PermutedCost & cost, int y, Lane & lane) {
+      lane = start (y);
+      left (cost, y, y - 1, 0, lane);
+      lane.d = 0.0;
+      right (cost, y, y + 1, cost.size () - 1, lane);
+    }
+
+#ifdef PERMUTE_INSERT_SCAN_X86
+    // Scans rows x and x + 1 side by side, one per lane.  Each lane first covers
+    // the targets inside the block on its own, so that the vector loops only
+    // see targets outside every row of the block.
+    __attribute__ ((target ("sse2")))
+    void scan2 (const PermutedCost & cost, int x, Lane * lanes) {
+      const int n = cost.size ();
+      const PermutedCost::Pair * r0 = cost.row (x), * r1 = cost.row (x + 1);
+      for (int k = 0; k < 2; ++ k) {
+	lanes [k] = start (x + k);
+	left (cost, x + k, x + k - 1, x, lanes [k]);
+      }
+      __m128d d = _mm_set_pd (lanes [1].d, lanes [0].d),
+	best = _mm_set_pd (lanes [1].best, lanes [0].best),
+	target = _mm_set_pd (lanes [1].target, lanes [0].target);
+      for (int r = x - 1; r >= 0; -- r) {
+	__m128d p0 = _mm_loadu_pd (& r0 [r].before), p1 = _mm_loadu_pd (& r1 [r].before);
+	d = _mm_sub_pd (d, _mm_unpackhi_pd (p0, p1));
+	d = _mm_add_pd (d, _mm_unpacklo_pd (p0, p1));
+	__m128d greater = _mm_cmpgt_pd (d, best);
+	best = _mm_or_pd (_mm_and_pd (greater, d), _mm_andnot_pd (greater, best));
+	target = _mm_or_pd (_mm_and_pd (greater, _mm_set1_pd (r)), _mm_andnot_pd (greater, target));
+      }
+      double v [2], t [2];
+      _mm_storeu_pd (v, best);
+      _mm_storeu_pd (t, target);
+      for (int k = 0; k < 2; ++ k) {
+	lanes [k].best = v [k];
+	lanes [k].target = int (t [k]);
+	lanes [k].d = 0.0;
+	right (cost, x + k, x + k + 1, x + 1, lanes [k]);
+      }
+      d = _mm_set_pd (lanes [1].d, lanes [0].d);
+      best = _mm_set_pd (lanes [1].best, lanes [0].best);
+      target = _mm_set_pd (lanes [1].target, lanes [0].target);
+      for (int r = x + 2; r < n; ++ r) {
+	__m128d p0 = _mm_loadu_pd (& r0 [r].before), p1 = _mm_loadu_pd (& r1 [r].before);
+	d = _mm_sub_pd (d, _mm_unpacklo_pd (p0, p1));
+	d = _mm_add_pd (d, _mm_unpackhi_pd (p0, p1));
+	__m128d greater = _mm_cmpgt_pd (d, best);
+	best = _mm_or_pd (_mm_and_pd (greater, d), _mm_andnot_pd (greater, best));
+	target = _mm_or_pd (_mm_and_pd (greater, _mm_set1_pd (r)), _mm_andnot_pd (greater, target));
+      }
+      _mm_storeu_pd (v, best);
+      _mm_storeu_pd (t, target);
+      for (int k = 0; k < 2; ++ k) {
+	lanes [k].best = v [k];
+	lanes [k].target = int (t [k]);
+      }
+    }
+
+    // Loads the pairs at p and q into one register.
+    __attribute__ ((target ("avx2")))
+    inline __m256d load (const PermutedCost::Pair * p, const PermutedCost::Pair * q) {
+      return _mm256_insertf128_pd (_mm256_castpd128_pd256 (_mm_loadu_pd (& p -> before)),
+				   _mm_loadu_pd (& q -> before), 1);
+    }
+
+    // Scans rows x through x + 3 as scan2 does.  Unpacking the pairs of rows
+    // x, x + 1 and x + 2, x + 3 leaves the lanes in the order x, x + 2, x + 1,
+    // x + 3.
+    __attribute__ ((target ("avx2")))
+    void scan4 (const PermutedCost & cost, int x, Lane * lanes) {
+      const int n = cost.size ();
+      const PermutedCost::Pair * r0 = cost.row (x), * r1 = cost.row (x + 1),
+	* r2 = cost.row (x + 2), * r3 = cost.row (x + 3);
+      for (int k = 0; k < 4; ++ k) {
+	lanes [k] = start (x + k);
+	left (cost, x + k, x + k - 1, x, lanes [k]);
+      }
+      __m256d d = _mm256_set_pd (lanes [3].d, lanes [1].d, lanes [2].d, lanes [0].d),
+	best = _mm256_set_pd (lanes [3].best, lanes [1].best, lanes [2].best, lanes [0].best),
+	target = _mm256_set_pd (lanes [3].target, lanes [1].target, lanes [2].target, lanes [0].target);
+      for (int r = x - 1; r >= 0; -- r) {
+	__m256d p0 = load (r0 + r, r1 + r), p1 = load (r2 + r, r3 + r);
+	d = _mm256_sub_pd (d, _mm256_unpackhi_pd (p0, p1));
+	d = _mm256_add_pd (d, _mm256_unpacklo_pd (p0, p1));
+	__m256d greater = _mm256_cmp_pd (d, best, _CMP_GT_OQ);
+	best = _mm256_blendv_pd (best, d, greater);
+	target = _mm256_blendv_pd (target, _mm256_set1_pd (r), greater);
+      }
+      static const int order [4] = { 0, 2, 1, 3 };
+      double v [4], t [4];
+      _mm256_storeu_pd (v, best);
+      _mm256_storeu_pd (t, target);
+      for (int k = 0; k < 4; ++ k) {
+	Lane & lane = lanes [order [k]];
+	lane.best = v [k];
+	lane.target = int (t [k]);
+	lane.d = 0.0;
+	right (cost, x + order [k], x + order [k] + 1, x + 3, lane);
+      }
+      d = _mm256_set_pd (lanes [3].d, lanes [1].d, lanes [2].d, lanes [0].d);
+      best = _mm256_set_pd (lanes [3].best, lanes [1].best, lanes [2].best, lanes [0].best);
+      target = _mm256_set_pd (lanes [3].target, lanes [1].target, lanes [2].target, lanes [0].target);
+      for (int r = x + 4; r < n; ++ r) {
+	__m256d p0 = load (r0 + r, r1 + r), p1 = load (r2 + r, r3 + r);
+	d = _mm256_sub_pd (d, _mm256_unpacklo_pd (p0, p1));
+	d = _mm256_add_pd (d, _mm256_unpackhi_pd (p0, p1));
+	__m256d greater = _mm256_cmp_pd (d, best, _CMP_GT_OQ);
+	best = _mm256_blendv_pd (best, d, greater);
+	target = _mm256_blendv_pd (target, _mm256_set1_pd (r), greater);
+      }
+      _mm256_storeu_pd (v, best);
+      _mm256_storeu_pd (t, target);
+      for (int k = 0; k < 4; ++ k) {
+	lanes [order [k]].best = v [k];
+	lanes [order [k]].target = int (t [k]);
+      }
+    }
+
+    __attribute__ ((target ("avx2")))
+    int differences4 (const PermutedCost::Pair * pairs, int size, bool after, double * out) {
+      int j = 0;
+      for (; j + 4 <= size; j += 4) {
+	const double * p = & pairs [j].before;
+	__m256d p0 = _mm256_loadu_pd (p), p1 = _mm256_loadu_pd (p + 4),
+	  b = _mm256_unpacklo_pd (p0, p1),
+	  a = _mm256_unpackhi_pd (p0, p1),
+	  diff = after ? _mm256_sub_pd (a, b) : _mm256_sub_pd (b, a);
+	_mm256_storeu_pd (out + j, _mm256_permute4x64_pd (diff, _MM_SHUFFLE (3, 1, 2, 0)));
+      }
+      return j;
+    }
+
+    __attribute__ ((target ("sse2")))
+    int differences2 (const PermutedCost::Pair * pairs, int size, bool after, double * out) {
+      int j = 0;
+      for (; j + 2 <= size; j += 2) {
+	const double * p = & pairs [j].before;
+	__m128d p0 = _mm_loadu_pd (p), p1 = _mm_loadu_pd (p + 2),
+	  b = _mm_unpacklo_pd (p0, p1),
+	  a = _mm_unpackhi_pd (p0, p1);
+	_mm_storeu_pd (out + j, after ? _mm_sub_pd (a, b) : _mm_sub_pd (b, a));
+      }
+      return j;
+    }
+#endif
+
+    typedef enum {
+      SCALAR,
+      SSE2,
+      AVX2
+    } Level;
+
+    Level supported () {
+#ifdef PERMUTE_INSERT_SCAN_X86
+      __builtin_cpu_init ();
+      if (__builtin_cpu_supports ("avx2")) {
+	return AVX2;
+      } else if (__builtin_cpu_supports ("sse2")) {
+	return SSE2;
+      }
+#endif
+      return SCALAR;
+    }
+
+    const Level LEVEL = supported ();
+  }
+
+  void scanInserts (const PermutedCost & cost, int x, int count,
+		    double * gain, int * target) {
+    Lane lanes [INSERT_SCAN_ROWS];
+    int k = 0;
+#ifdef PERMUTE_INSERT_SCAN_X86
+    if (LEVEL == AVX2 && count == 4) {
+      scan4 (cost, x, lanes);
+      k = 4;
+    }
+    if (LEVEL >= SSE2) {
+      for (; k + 2 <= count; k += 2) {
+	scan2 (cost, x + k, lanes + k);
+      }
+    }
+#endif
+    for (; k < count; ++ k) {
+      scan1 (cost, x + k, lanes [k]);
+    }
+    for (k = 0; k < count; ++ k) {
+      gain [k] = lanes [k].best;
+      target [k] = lanes [k].target;
+    }
+  }
+
+  void differences (const PermutedCost::Pair * pairs, int size,
+		    bool after, double * out) {
+    int j = 0;
+#ifdef PERMUTE_INSERT_SCAN_X86
+    if (LEVEL == AVX2) {
+      j = differences4 (pairs, size, after, out);
+    } else if (LEVEL == SSE2) {
+      j = differences2 (pairs, size, after, out);
+    }
+#endif
+    for (; j < size; ++ j) {
+      out [j] = after
+	? pairs [j].after - pairs [j].before
+	: pairs [j].before - pairs [j].after;
+    }
+  }
+}
@@ -0,0 +1,32 @@
+#ifndef _PERMUTE_INSERT_SCAN_HH
+#define _PERMUTE_INSERT_SCAN_HH
+
+#include "BeforeScorer.hh"
+
+namespace Permute {
+
+  // The number of rows that scanInserts handles at once.
+  const int INSERT_SCAN_ROWS = 4;
+
+  // For each of the count <= INSERT_SCAN_ROWS positions x + k, finds the best
+  // insert move exactly as the inner loops of visit do: the running gain of
+  // moving pi[x + k] to each r, leftward from x + k - 1 and then rightward from
+  // x + k + 1, keeping the first gain strictly greater than the best so far,
+  // which starts at zero.  Stores the best gain in gain[k] and its target in
+  // target[k], or 0.0 and x + k if no move gains.
+  //
+  // Scans four rows per instruction with AVX2 and two with SSE2, one row per
+  // lane, so that each row is still read in order.  Each lane performs the same
+  // operations in the same order as the scalar loop, so the results are
+  // bitwise the same.  The instruction set is chosen at run time from what the
+  // processor supports.
+  void scanInserts (const PermutedCost & cost, int x, int count,
+		    double * gain, int * target);
+
+  // Stores before - after, or after - before if after is set, for each of the
+  // given pairs.
+  void differences (const PermutedCost::Pair * pairs, int size,
+		    bool after, double * out);
+}
+
+#endif//_PERMUTE_INSERT_SCAN_HH
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "IteratedLocalSearch.hh"
+
+namespace Permute {
+
+  IteratedLocalSearch::IteratedLocalSearch (const BeforeCostRef & bc,
+					    Perturbation perturbation,
+					    Acceptance acceptance,
+					    int kickWidth,
+					    int blockWidth,
+					    unsigned seed) :
+    cost_ (bc),
+    perturbation_ (perturbation),
+    acceptance_ (acceptance),
+    kickWidth_ (std::max (kickWidth, 1)),
+    blockWidth_ (blockWidth),
+    state_ (seed),
+    iterations_ (0),
+    seconds_ (0.0),
+    timer_ (),
+    workspace_ ()
+  {}
+
+  // Keeps the current local optimum and the best one as plain vectors, so
+  // that restoring either touches only the indices of pi.
+  double IteratedLocalSearch::run (Permutation & pi, double seconds) {
+    seconds_ = seconds;
+    iterations_ = 1;
+    timer_.start ();
+
+    PermutedCost & cost = cost_;
+    cost.assign (pi);
+    descend (pi, cost);
+    double current = cost.score ();
+    std::vector <size_t> saved (pi.begin (), pi.end ()), best (saved);
+    double bestScore = current;
+    checkpoint (elapsed (), bestScore);
+
+    while (pi.size () > 1 && ! expired ()) {
+      perturb (pi, cost);
+      descend (pi, cost);
+      ++ iterations_;
+      double score = cost.score ();
+      if (score > bestScore) {
+	bestScore = score;
+	best.assign (pi.begin (), pi.end ());
+	checkpoint (elapsed (), bestScore);
+      }
+      if (accept (score, current)) {
+	current = score;
+	saved.assign (pi.begin (), pi.end ());
+      } else {
+	std::copy (saved.begin (), saved.end (), pi.begin ());
+	cost.assign (pi);
+      }
+    }
+
+    std::copy (best.begin (), best.end (), pi.begin ());
+    return bestScore;
+  }
+
+  // Core::Timer measures up to the last call to stop.
+  double IteratedLocalSearch::elapsed () {
+    timer_.stop ();
+    return timer_.elapsed ();
+  }
+
+  bool IteratedLocalSearch::expired () {
+    return elapsed () >= seconds_;
+  }
+
+  int IteratedLocalSearch::random (int n) {
+    return rand_r (& state_) % n;
+  }
+
+  void IteratedLocalSearch::descend (Permutation & pi, PermutedCost & cost) {
+    while (! expired () && visit (pi, cost) > 0.0);
+    if (blockWidth_ > 0) {
+      while (! expired () && block_lsf (pi, cost, blockWidth_, workspace_) > 0.0);
+    }
+  }
+
+  // Requires at least two positions.
+  void IteratedLocalSearch::perturb (Permutation & pi, PermutedCost & cost) {
+    const int n = pi.size ();
+    switch (perturbation_) {
+    case PERTURB_BLOCK: {
+      // Exchanges (i, j) and (j, k).
+      int j = 1 + random (n - 1);
+      int i = j - 1 - random (std::min (kickWidth_, j));
+      int k = j + 1 + random (std::min (kickWidth_, n - j));
+      insert (pi, i, j, k);
+      cost.insert (i, j, k);
+      break;
+    }
+    case PERTURB_DOUBLE_INSERT:
+      for (int m = 0; m < 2; ++ m) {
+	int a = random (n);
+	int lo = std::max (0, a - kickWidth_), hi = std::min (n - 1, a + kickWidth_);
+	int b = lo + random (hi - lo);
+	if (b >= a) {
+	  ++ b;
+	}
+	insert (pi, a, b);
+	cost.insert (a, b);
+      }
+      break;
+    }
+  }
+
+  bool IteratedLocalSearch::accept (double candidate, double current) const {
+    switch (acceptance_) {
+    case ACCEPT_BETTER:
+      return candidate > current;
+    case ACCEPT_EQUAL:
+      return candidate >= current;
+    case ACCEPT_ALWAYS:
+    default:
+      return true;
+    }
+  }
+}
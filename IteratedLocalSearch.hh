@@ -0,0 +1,82 @@
+#ifndef _PERMUTE_ITERATED_LOCAL_SEARCH_HH
+#define _PERMUTE_ITERATED_LOCAL_SEARCH_HH
+
+#include <Core/Statistics.hh>
+
+#include "BeforeScorer.hh"
+#include "LinearOrdering.hh"
+#include "Permutation.hh"
+
+namespace Permute {
+
+  // Implements iterated local search (Lourenço, Martin & Stützle, 2003) for
+  // the linear ordering problem under a wall-clock budget.  Each iteration
+  // perturbs the current local optimum with a kick, climbs to a new local
+  // optimum with LS_f (visit), and then with block_lsf if a block width is
+  // given, and decides whether to continue from the new optimum or the old.
+  //
+  // The search is anytime: the deadline is checked between moves, so run
+  // returns soon after the budget expires even during the first descent, and
+  // checkpoint reports each improvement of the best score as it happens.
+  //
+  // Reads the cost matrix only through a PermutedCost view, so that several
+  // searches may share it from different threads.
+  class IteratedLocalSearch {
+  public:
+    typedef enum {
+      // Moves a random block of at most kickWidth positions past a random
+      // neighboring block.
+      PERTURB_BLOCK,
+      // Makes two random insert moves, each over at most kickWidth positions.
+      PERTURB_DOUBLE_INSERT
+    } Perturbation;
+
+    typedef enum {
+      // Continues from the new optimum only if it scores higher.
+      ACCEPT_BETTER,
+      // Also continues from a new optimum that ties, to cross plateaus.
+      ACCEPT_EQUAL,
+      // Always continues from the new optimum, as a random walk.
+      ACCEPT_ALWAYS
+    } Acceptance;
+  private:
+    PermutedCost cost_;
+    Perturbation perturbation_;
+    Acceptance acceptance_;
+    int kickWidth_;
+    int blockWidth_;
+    unsigned state_;
+    int iterations_;
+    double seconds_;
+    Core::Timer timer_;
+    BlockWorkspace workspace_;
+  public:
+    IteratedLocalSearch (const BeforeCostRef & bc,
+			 Perturbation perturbation,
+			 Acceptance acceptance,
+			 int kickWidth,
+			 int blockWidth,
+			 unsigned seed);
+    virtual ~IteratedLocalSearch () {}
+
+    // Searches from pi until seconds of wall-clock time have passed, leaves
+    // the best permutation found in pi, and returns its score.
+    double run (Permutation & pi, double seconds);
+    // Returns the number of local searches of the last run, including the
+    // first descent.
+    int iterations () const { return iterations_; }
+  protected:
+    // Called with the elapsed time whenever the best score improves,
+    // starting with the score of the first local optimum.
+    virtual void checkpoint (double time, double score) {}
+  private:
+    double elapsed ();
+    bool expired ();
+    int random (int n);
+    void descend (Permutation & pi, PermutedCost & cost);
+    void perturb (Permutation & pi, PermutedCost & cost);
+    bool accept (double candidate, double current) const;
+  };
+}
+
+#endif//_PERMUTE_ITERATED_LOCAL_SEARCH_HH
@@ -74,7 +74,12 @@ public:
     int index = 0;
     for (std::vector <std::string>::const_iterator it = args.begin (); it != args.end (); ++ it) {
       this -> LOLIB_FILE = * it;
-      BeforeCost * bc = this -> lolib ();
+      // Application::lolib reports why the matrix could not be read.
+      BeforeCostRef source (this -> lolib ());
+      if (! source) {
+	return EXIT_FAILURE;
+      }
+      BeforeCost * bc = new BeforeCost (* source);
       double excess = bc -> normalize ();
       BeforeCostRef bcr (bc);
 
@@ -87,9 +92,9 @@ public:
 
       ParseControllerRef pc = this -> parseController (p);
 
-      LOPChart chart (p, WINDOW);
+      OneBestChartRef chart = this -> oneBestChart (p);
 
-      ScorerRef gamma (new BeforeScorer (bcr, p));
+      ScorerRef gamma = this -> costScorer (bcr, p);
 
       double best_score = Core::Type <double>::min;
 
@@ -103,8 +108,8 @@ public:
 	int iterations = 0;
 	do {
 	  ++ iterations;
-	  chart.permute (pc, gamma);
-	  const ConstPathRef & bestPath = chart.getBestPath ();
+	  chart -> permute (pc, gamma);
+	  const ConstPathRef & bestPath = chart -> getBestPath ();
 	  p.changed (false);
 	  if (bestPath -> getScore () > best_score) {
 	    best_score = bestPath -> getScore ();
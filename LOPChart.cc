@@ -1,14 +1,42 @@
+#include "Argmax.hh"
 #include "Chart.hh"
 #include "LOPChart.hh"
 #include "Log.hh"
+#include "ParsePolicy.hh"
 
 namespace Permute {
+  namespace {
+    // Returns the width of the widest span that a chart stores explicitly.
+    int band (int n, int window, LOPChart::Layout layout) {
+      if (layout == LOPChart::BANDED && window > 1 && window < n) {
+	return window;
+      } else {
+	return n;
+      }
+    }
+
+    // Returns true if the controller allows every midpoint.  Otherwise a wider
+    // span need not be a concatenation of narrower blocks that the controller
+    // allows, and a banded chart would explore splits that a full one rejects.
+    bool bandable (const ParseControllerRef & controller) {
+      ParsePolicy policy;
+      return controller -> policy (policy) && policy.type == ParsePolicy::CUBIC;
+    }
+  }
 
-  LOPChart::LOPChart (Permutation & pi, int window) :
+  LOPChart::LOPChart (Permutation & pi, int window, const ThreadPoolRef & pool, Layout layout) :
     pi_ (pi),
     n_ (pi.size ()),
     window_ (window),
-    cells_ (n_ + Chart::index (0, n_, n_) + 1)
+    band_ (band (n_, window, layout)),
+    pool_ (pool),
+    layout_ (layout),
+    cells_ (n_ + Chart::index (n_ - band_, n_, n_) + 1),
+    prefixes_ (band_ < n_ ? n_ + 1 : 0),
+    rows_ ((n_ + 1) * (band_ + 1), 0.0),
+    columns_ (rows_),
+    keep_ (n_ * band_),
+    swap_ (n_ * band_)
   {}
 
   int LOPChart::index (int i, int j) const {
@@ -20,38 +48,146 @@ namespace Permute {
       (static_cast <const LOPChart *> (this) -> cell (i, j));
   }
 
+  // Spans wider than the band are always prefixes (0, j).
   const LOPCell & LOPChart::cell (int i, int j) const {
-    return cells_ [index (i, j)];
+    if (j - i > band_) {
+      return prefixes_ [j];
+    } else {
+      return cells_ [index (i, j)];
+    }
   }
 
-  void LOPChart::permute (const ParseControllerRef & controller, ScorerRef & scorer) {
-    // Initializes the scorer.
-    scorer -> compute (controller);
-    
-    for (int span = 2; span <= n_; ++ span) {
-      for (int begin = 0; begin <= n_ - span; ++ begin) {
-	int end = begin + span;
-	// Initializes the (begin, end) cell.
-	LOPCell & cell = this -> cell (begin, end);
-	cell.score = Core::Type <double>::min;
-	// Iterates over middle positions.
-	ParseController::iterator end_it = controller -> end (begin, end);
-	for (ParseController::iterator middle = controller -> begin (begin, end);
-	     middle != end_it;
-	     ++ middle) {
-	  const LOPCell & left = this -> cell (begin, middle);
-	  const LOPCell & right = this -> cell (middle, end);
-	  cell.max_equals (middle,
-			   false,
-			   left.score + right.score + scorer -> score (begin, middle, end));
-	  if (! getWindow () || getWindow () >= span) {
-	    cell.max_equals (middle,
-			     true,
-			     left.score + right.score + scorer -> score (end, middle, begin));
-	  }
+  // Returns the position of the score of (i, j) in rows_.  Successive ends j
+  // are adjacent.
+  int LOPChart::row (int i, int j) const {
+    return i * (band_ + 1) + j - i;
+  }
+
+  // Returns the position of the score of (i, j) in columns_.  Successive begins
+  // i are adjacent.
+  int LOPChart::column (int i, int j) const {
+    return j * (band_ + 1) + band_ - (j - i);
+  }
+
+  // Binds parse to a LOPChart and scorer for use with dispatch.
+  class LOPChart::Parse {
+  private:
+    LOPChart & chart_;
+    const Scorer & scorer_;
+  public:
+    Parse (LOPChart & chart, const Scorer & scorer) :
+      chart_ (chart),
+      scorer_ (scorer)
+    {}
+    template <class Policy>
+    void operator () (const Policy & policy) const {
+      chart_.parse (policy, scorer_);
+    }
+  };
+
+  // Binds fill to a LOPChart and one span width for use with parallelFor.
+  template <class Policy>
+  class LOPChart::Span {
+  private:
+    LOPChart & chart_;
+    const Policy & policy_;
+    const Scorer & scorer_;
+    int span_;
+  public:
+    Span (LOPChart & chart, const Policy & policy, const Scorer & scorer, int span) :
+      chart_ (chart),
+      policy_ (policy),
+      scorer_ (scorer),
+      span_ (span)
+    {}
+    void operator () (int begin) const {
+      chart_.fill (policy_, scorer_, begin, begin + span_);
+    }
+  };
+
+  // Fills the (begin, end) cell from the narrower cells beneath it.  Fetches
+  // the scores of each run of consecutive midpoints in one call to the scorer
+  // and finds the best keep and swap midpoints of the run with argmax.
+  template <class Policy>
+  void LOPChart::fill (const Policy & policy, const Scorer & scorer, int begin, int end) {
+    int span = end - begin;
+    bool swaps = ! getWindow () || getWindow () >= span;
+    double * keep = & keep_ [begin * band_], * swap = & swap_ [begin * band_];
+    double keep_score = Core::Type <double>::min, swap_score = Core::Type <double>::min;
+    int keep_middle = -1, swap_middle = -1;
+    typename Policy::iterator middle = policy.begin (begin, end), end_it = policy.end (begin, end);
+    while (middle != end_it) {
+      int first = middle, last = first + 1;
+      while (++ middle != end_it && int (middle) == last) {
+	++ last;
+      }
+      scorer.scores (begin, end, first, last, keep, swap);
+      const double * left = & rows_ [row (begin, first)], * right = & columns_ [column (first, end)];
+      int j = argmax (left, right, keep, last - first, keep_score);
+      if (j >= 0) {
+	keep_middle = first + j;
+      }
+      if (swaps) {
+	j = argmax (left, right, swap, last - first, swap_score);
+	if (j >= 0) {
+	  swap_middle = first + j;
 	}
       }
     }
+    // Resolves ties as a single pass over the midpoints would, trying keep
+    // before swap at each one: the lower midpoint wins, then keep.
+    LOPCell & cell = this -> cell (begin, end);
+    cell.score = Core::Type <double>::min;
+    if (swap_middle >= 0 &&
+	(keep_middle < 0 || swap_score > keep_score ||
+	 (swap_score == keep_score && swap_middle < keep_middle))) {
+      cell.max_equals (swap_middle, true, swap_score);
+    } else if (keep_middle >= 0) {
+      cell.max_equals (keep_middle, false, keep_score);
+    }
+    rows_ [row (begin, end)] = columns_ [column (begin, end)] = cell.score;
+  }
+
+  // The cells of one width depend only on narrower cells, so each width is a
+  // batch of independent work.
+  template <class Policy>
+  void LOPChart::parse (const Policy & policy, const Scorer & scorer) {
+    for (int span = 2; span <= band_; ++ span) {
+      parallelFor (pool_, 0, n_ - span + 1, Span <Policy> (* this, policy, scorer, span));
+    }
+    concatenate (scorer);
+  }
+
+  // Computes the best monotone concatenation of each prefix wider than the
+  // band, where the last block is a stored cell.
+  void LOPChart::concatenate (const Scorer & scorer) {
+    for (int end = band_ + 1; end <= n_; ++ end) {
+      LOPCell & prefix = prefixes_ [end];
+      prefix.score = Core::Type <double>::min;
+      for (int middle = end - band_; middle < end; ++ middle) {
+	prefix.max_equals (middle,
+			   false,
+			   cell (0, middle).score + cell (middle, end).score + scorer.score (0, middle, end));
+      }
+    }
+  }
+
+  // Stores the cells of the band that the controller admits.
+  void LOPChart::resize (const ParseControllerRef & controller) {
+    band_ = bandable (controller) ? band (n_, window_, layout_) : n_;
+    cells_.resize (n_ + Chart::index (n_ - band_, n_, n_) + 1);
+    prefixes_.resize (band_ < n_ ? n_ + 1 : 0);
+    rows_.assign ((n_ + 1) * (band_ + 1), 0.0);
+    columns_ = rows_;
+    keep_.resize (n_ * band_);
+    swap_.resize (n_ * band_);
+  }
+
+  void LOPChart::permute (const ParseControllerRef & controller, ScorerRef & scorer) {
+    resize (controller);
+    // Initializes the scorer.
+    scorer -> compute (controller);
+    dispatch (controller, Parse (* this, * scorer));
   }
 
   ConstPathRef LOPChart::getBestPath () const {
@@ -84,19 +220,31 @@ namespace Permute {
 
   ////////////////////////////////////////////////////////////////////////////////
 
-  NormalLOPChart::NormalLOPChart (Permutation & pi, int window) :
+  NormalLOPChart::NormalLOPChart (Permutation & pi, int window, const ThreadPoolRef & pool,
+				  LOPChart::Layout layout) :
     pi_ (pi),
     n_ (pi.size ()),
     window_ (window),
-    cells_ (2 * (n_ + Chart::index (0, n_, n_) + 1))
+    band_ (band (n_, window, layout)),
+    pool_ (pool),
+    layout_ (layout),
+    cells_ (2 * (n_ + Chart::index (n_ - band_, n_, n_) + 1)),
+    prefixes_ (band_ < n_ ? n_ + 1 : 0),
+    keep_ (n_),
+    swap_ (n_)
   {}
 
   int NormalLOPChart::index (int i, int j, Path::Type type) const {
     return 2 * (n_ + Chart::index (i, j, n_)) + type - 1;
   }
 
+  // A prefix wider than the band is always a keep, so it serves as both types.
   const ConstPathRef & NormalLOPChart::cell (int i, int j, Path::Type type) const {
-    return cells_ [index (i, j, type)];
+    if (j - i > band_) {
+      return prefixes_ [j];
+    } else {
+      return cells_ [index (i, j, type)];
+    }
   }
 
   ConstPathRef & NormalLOPChart::cell (int i, int j, Path::Type type) {
@@ -110,52 +258,125 @@ namespace Permute {
     return (swap -> getScore () > keep -> getScore ()) ? swap : keep;
   }
 
+  // Binds choose to a NormalLOPChart and one span width for use with
+  // parallelFor.
+  class NormalLOPChart::Span {
+  private:
+    NormalLOPChart & chart_;
+    const ParseControllerRef & controller_;
+    const Scorer & scorer_;
+    int span_;
+  public:
+    Span (NormalLOPChart & chart, const ParseControllerRef & controller,
+	  const Scorer & scorer, int span) :
+      chart_ (chart),
+      controller_ (controller),
+      scorer_ (scorer),
+      span_ (span)
+    {}
+    void operator () (int begin) const {
+      chart_.choose (controller_, scorer_, begin, begin + span_);
+    }
+  };
+
+  // Records in keep_ [begin] and swap_ [begin] the midpoints of the best keep
+  // and swap paths over (begin, end).  Computes each candidate score exactly as
+  // Path::connect would, without building the path.
+  void NormalLOPChart::choose (const ParseControllerRef & controller,
+			       const Scorer & scorer, int begin, int end) {
+    int span = end - begin;
+    double keep_path_score = Core::Type <double>::min;
+    double swap_path_score = Core::Type <double>::min;
+    keep_ [begin] = swap_ [begin] = -1;
+    // Iterates over middle positions.
+    for (ParseController::iterator middle = controller -> begin (begin, end);
+	 middle != controller -> end (begin, end);
+	 ++ middle) {
+      // Uses the better left child.
+      double keep = this -> betterPath (begin, middle) -> getScore ()
+	+ this -> cell (middle, end, Path::SWAP) -> getScore ()
+	+ scorer.score (begin, middle, end);
+      if (keep > keep_path_score) {
+	keep_ [begin] = middle;
+	keep_path_score = keep;
+      }
+      if (! getWindow () || getWindow () >= span) {
+	// Uses the better right child.
+	double swap = this -> betterPath (middle, end) -> getScore ()
+	  + this -> cell (begin, middle, Path::KEEP) -> getScore ()
+	  + scorer.score (end, middle, begin);
+	if (swap > swap_path_score) {
+	  swap_ [begin] = middle;
+	  swap_path_score = swap;
+	}
+      }
+    }
+  }
+
   // @bug Does not produce the same results as Chart::permute, which also
   // performs normal-form parsing.  This may simply be due to ties and ordering,
   // or it may be due to a logical error. 
   void NormalLOPChart::permute (const ParseControllerRef & controller, ScorerRef & scorer) {
+    resize (controller);
     // Initializes the scorer.
     scorer -> compute (controller);
     // Initializes the width-1 paths.
     for (int i = 0; i < n_; ++ i) {
       cell (i, i + 1, Path::SWAP) = cell (i, i + 1, Path::KEEP) = Path::arc (pi_ [i], 0, 0, 0.0);
     }
-    for (int span = 2; span <= n_; ++ span) {
+    for (int span = 2; span <= band_; ++ span) {
+      parallelFor (pool_, 0, n_ - span + 1, Span (* this, controller, * scorer, span));
       for (int begin = 0; begin <= n_ - span; ++ begin) {
 	int end = begin + span;
-	// Initializes the (begin, end) cell.
-	ConstPathRef & keep_path = this -> cell (begin, end, Path::KEEP);
-	double keep_path_score = Core::Type <double>::min;
-	ConstPathRef & swap_path = this -> cell (begin, end, Path::SWAP);
-	double swap_path_score = Core::Type <double>::min;
-	// Iterates over middle positions.
-	for (ParseController::iterator middle = controller -> begin (begin, end);
-	     middle != controller -> end (begin, end);
-	     ++ middle) {
-	  // Uses the better left child.
-	  ConstPathRef left = this -> betterPath (begin, middle);
-	  ConstPathRef right = this -> cell (middle, end, Path::SWAP);
-	  ConstPathRef keep = Path::connect (left, right, scorer -> score (begin, middle, end), false);
-	  if (keep -> getScore () >  keep_path_score) {
-	    keep_path = keep;
-	    keep_path_score = keep_path -> getScore ();
-	  }
-	  if (! getWindow () || getWindow () >= span) {
-	    // Uses the better right child.
-	    right = this -> betterPath (middle, end);
-	    left = this -> cell (begin, middle, Path::KEEP);
-	    ConstPathRef swap = Path::connect (right, left, scorer -> score (end, middle, begin), true);
-	    if (swap -> getScore () > swap_path_score) {
-	      swap_path = swap;
-	      swap_path_score = swap_path -> getScore ();
-	    }
-	  }
+	int middle = keep_ [begin];
+	if (middle >= 0) {
+	  cell (begin, end, Path::KEEP) =
+	    Path::connect (betterPath (begin, middle), cell (middle, end, Path::SWAP),
+			   scorer -> score (begin, middle, end), false);
+	}
+	middle = swap_ [begin];
+	if (middle >= 0) {
+	  cell (begin, end, Path::SWAP) =
+	    Path::connect (betterPath (middle, end), cell (begin, middle, Path::KEEP),
+			   scorer -> score (end, middle, begin), true);
+	} else {
+	  // Spans wider than the window have no swap.
+	  cell (begin, end, Path::SWAP) = Path::nullPath ();
 	}
       }
     }
+    concatenate (* scorer);
+  }
+
+  // Stores the cells of the band that the controller admits, as LOPChart does.
+  void NormalLOPChart::resize (const ParseControllerRef & controller) {
+    band_ = bandable (controller) ? band (n_, window_, layout_) : n_;
+    cells_.resize (2 * (n_ + Chart::index (n_ - band_, n_, n_) + 1));
+    prefixes_.resize (band_ < n_ ? n_ + 1 : 0);
+  }
+
+  // Computes the best monotone concatenation of each prefix wider than the
+  // band.  In normal form the last block is a swap or a single word.
+  void NormalLOPChart::concatenate (const Scorer & scorer) {
+    for (int end = band_ + 1; end <= n_; ++ end) {
+      double best = Core::Type <double>::min;
+      int best_middle = end - 1;
+      for (int middle = end - band_; middle < end; ++ middle) {
+	double score = betterPath (0, middle) -> getScore ()
+	  + cell (middle, end, Path::SWAP) -> getScore ()
+	  + scorer.score (0, middle, end);
+	if (score > best) {
+	  best_middle = middle;
+	  best = score;
+	}
+      }
+      prefixes_ [end] =
+	Path::connect (betterPath (0, best_middle), cell (best_middle, end, Path::SWAP),
+		       scorer.score (0, best_middle, end), false);
+    }
   }
     
-  const ConstPathRef & NormalLOPChart::getBestPath () const {
+  ConstPathRef NormalLOPChart::getBestPath () const {
     return betterPath (0, n_);
   }
 
@@ -169,11 +390,193 @@ namespace Permute {
 
   ////////////////////////////////////////////////////////////////////////////////
 
-  QuadraticNormalLOPChart::QuadraticNormalLOPChart (Permutation & pi, int width, bool left) :
+  BackpointerNormalLOPChart::BackpointerNormalLOPChart (Permutation & pi, int window,
+							const ThreadPoolRef & pool,
+							LOPChart::Layout layout) :
+    pi_ (pi),
+    n_ (pi.size ()),
+    window_ (window),
+    band_ (band (n_, window, layout)),
+    pool_ (pool),
+    layout_ (layout),
+    scorer_ (),
+    cells_ (2 * (n_ + Chart::index (n_ - band_, n_, n_) + 1)),
+    prefixes_ (band_ < n_ ? n_ + 1 : 0)
+  {}
+
+  int BackpointerNormalLOPChart::index (int i, int j, Path::Type type) const {
+    return 2 * (n_ + Chart::index (i, j, n_)) + type - 1;
+  }
+
+  // A prefix wider than the band is always a keep, so it serves as both types.
+  const LOPCell & BackpointerNormalLOPChart::cell (int i, int j, Path::Type type) const {
+    if (j - i > band_) {
+      return prefixes_ [j];
+    } else {
+      return cells_ [index (i, j, type)];
+    }
+  }
+
+  LOPCell & BackpointerNormalLOPChart::cell (int i, int j, Path::Type type) {
+    return const_cast <LOPCell &>
+      (static_cast <const BackpointerNormalLOPChart *> (this) -> cell (i, j, type));
+  }
+
+  // Returns the type of the better derivation of (i, j), preferring keep on
+  // ties as NormalLOPChart::betterPath does.
+  Path::Type BackpointerNormalLOPChart::better (int i, int j) const {
+    return (cell (i, j, Path::SWAP).score > cell (i, j, Path::KEEP).score) ? Path::SWAP : Path::KEEP;
+  }
+
+  // Binds parse to a BackpointerNormalLOPChart and scorer for use with
+  // dispatch.
+  class BackpointerNormalLOPChart::Parse {
+  private:
+    BackpointerNormalLOPChart & chart_;
+    const Scorer & scorer_;
+  public:
+    Parse (BackpointerNormalLOPChart & chart, const Scorer & scorer) :
+      chart_ (chart),
+      scorer_ (scorer)
+    {}
+    template <class Policy>
+    void operator () (const Policy & policy) const {
+      chart_.parse (policy, scorer_);
+    }
+  };
+
+  // Binds fill to a BackpointerNormalLOPChart and one span width for use with
+  // parallelFor.
+  template <class Policy>
+  class BackpointerNormalLOPChart::Span {
+  private:
+    BackpointerNormalLOPChart & chart_;
+    const Policy & policy_;
+    const Scorer & scorer_;
+    int span_;
+  public:
+    Span (BackpointerNormalLOPChart & chart, const Policy & policy,
+	  const Scorer & scorer, int span) :
+      chart_ (chart),
+      policy_ (policy),
+      scorer_ (scorer),
+      span_ (span)
+    {}
+    void operator () (int begin) const {
+      chart_.fill (policy_, scorer_, begin, begin + span_);
+    }
+  };
+
+  // Computes the scores of the best keep and swap derivations of (begin, end)
+  // in the same order and with the same sums as NormalLOPChart::choose.
+  template <class Policy>
+  void BackpointerNormalLOPChart::fill (const Policy & policy, const Scorer & scorer,
+					int begin, int end) {
+    int span = end - begin;
+    LOPCell & keep = cell (begin, end, Path::KEEP);
+    LOPCell & swap = cell (begin, end, Path::SWAP);
+    keep = LOPCell (-1, false, Core::Type <double>::min);
+    swap = LOPCell (-1, true, Core::Type <double>::min);
+    for (typename Policy::iterator middle = policy.begin (begin, end), end_it = policy.end (begin, end);
+	 middle != end_it;
+	 ++ middle) {
+      // Uses the better left child.
+      keep.max_equals (middle, false,
+		       cell (begin, middle, better (begin, middle)).score
+		       + cell (middle, end, Path::SWAP).score
+		       + scorer.score (begin, middle, end));
+      if (! getWindow () || getWindow () >= span) {
+	// Uses the better right child.
+	swap.max_equals (middle, true,
+			 cell (middle, end, better (middle, end)).score
+			 + cell (begin, middle, Path::KEEP).score
+			 + scorer.score (end, middle, begin));
+      }
+    }
+  }
+
+  template <class Policy>
+  void BackpointerNormalLOPChart::parse (const Policy & policy, const Scorer & scorer) {
+    for (int span = 2; span <= band_; ++ span) {
+      parallelFor (pool_, 0, n_ - span + 1, Span <Policy> (* this, policy, scorer, span));
+    }
+    concatenate (scorer);
+  }
+
+  // Computes the best monotone concatenation of each prefix wider than the
+  // band, as NormalLOPChart::concatenate does.
+  void BackpointerNormalLOPChart::concatenate (const Scorer & scorer) {
+    for (int end = band_ + 1; end <= n_; ++ end) {
+      LOPCell & prefix = prefixes_ [end];
+      prefix = LOPCell (end - 1, false, Core::Type <double>::min);
+      for (int middle = end - band_; middle < end; ++ middle) {
+	prefix.max_equals (middle, false,
+			   cell (0, middle, better (0, middle)).score
+			   + cell (middle, end, Path::SWAP).score
+			   + scorer.score (0, middle, end));
+      }
+    }
+  }
+
+  // Stores the cells of the band that the controller admits, as LOPChart does.
+  void BackpointerNormalLOPChart::resize (const ParseControllerRef & controller) {
+    band_ = bandable (controller) ? band (n_, window_, layout_) : n_;
+    cells_.resize (2 * (n_ + Chart::index (n_ - band_, n_, n_) + 1));
+    prefixes_.resize (band_ < n_ ? n_ + 1 : 0);
+  }
+
+  // Keeps the scorer so that getBestPath can rebuild each node with the same
+  // score that NormalLOPChart gives it.
+  void BackpointerNormalLOPChart::permute (const ParseControllerRef & controller, ScorerRef & scorer) {
+    resize (controller);
+    // Initializes the scorer.
+    scorer -> compute (controller);
+    scorer_ = scorer;
+    // Initializes the width-1 cells.
+    for (int i = 0; i < n_; ++ i) {
+      cell (i, i + 1, Path::KEEP) = LOPCell (i, false, 0.0);
+      cell (i, i + 1, Path::SWAP) = LOPCell (i, true, 0.0);
+    }
+    dispatch (controller, Parse (* this, * scorer));
+  }
+
+  ConstPathRef BackpointerNormalLOPChart::getBestPath () const {
+    return path (0, n_, better (0, n_));
+  }
+
+  // A keep joins the better left child with a swap (or single word) on the
+  // right, and a swap joins the better right child with a keep on the left.
+  ConstPathRef BackpointerNormalLOPChart::path (int i, int j, Path::Type type) const {
+    if (j - i == 1) {
+      return Path::arc (pi_ [i], 0, 0, 0.0);
+    }
+    int middle = cell (i, j, type).midpoint;
+    if (type == Path::KEEP) {
+      return Path::connect (path (i, middle, better (i, middle)), path (middle, j, Path::SWAP),
+			    scorer_ -> score (i, middle, j), false);
+    } else {
+      return Path::connect (path (middle, j, better (middle, j)), path (i, middle, Path::KEEP),
+			    scorer_ -> score (j, middle, i), true);
+    }
+  }
+
+  int BackpointerNormalLOPChart::getWindow () const {
+    return window_;
+  }
+
+  int BackpointerNormalLOPChart::getLength () const {
+    return n_;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  QuadraticNormalLOPChart::QuadraticNormalLOPChart (Permutation & pi, int width, bool left,
+						    const ThreadPoolRef & pool) :
     pi_ (pi),
     n_ (pi.size ()),
     w_ (width),
     left_ (left),
+    pool_ (pool),
     cells_ (n_ + Chart::index (0, n_, n_) + 1)
   {}
 
@@ -194,6 +597,69 @@ namespace Permute {
     return cells_ [index (i, j)];
   }
 
+  // Binds fill to a QuadraticNormalLOPChart and one span width for use with
+  // parallelFor.
+  class QuadraticNormalLOPChart::Span {
+  private:
+    QuadraticNormalLOPChart & chart_;
+    const ParseControllerRef & controller_;
+    const Scorer & scorer_;
+    int span_;
+  public:
+    Span (QuadraticNormalLOPChart & chart, const ParseControllerRef & controller,
+	  const Scorer & scorer, int span) :
+      chart_ (chart),
+      controller_ (controller),
+      scorer_ (scorer),
+      span_ (span)
+    {}
+    void operator () (int begin) const {
+      chart_.fill (controller_, scorer_, begin, begin + span_);
+    }
+  };
+
+  void QuadraticNormalLOPChart::fill (const ParseControllerRef & controller,
+				      const Scorer & scorer, int begin, int end) {
+    // Initializes the (begin, end) cell.
+    QuadraticNormalLOPCell & cell = this -> cell (begin, end);
+    cell.white ().score = cell.black ().score = cell.red ().score = Core::Type <double>::min;
+    // Iterates over middle positions.
+    ParseController::iterator end_it = controller -> end (begin, end);
+    for (ParseController::iterator middle = controller -> begin (begin, end);
+	 middle != end_it;
+	 ++ middle) {
+      const QuadraticNormalLOPCell & left = this -> cell (begin, middle);
+      const QuadraticNormalLOPCell & right = this -> cell (middle, end);
+      if (end - middle <= w_) {
+	// (middle, end) is narrow:
+	cell.white ().max_equals (middle, false,
+				  left.any ().score
+				  + right.non_white ().score
+				  + scorer.score (begin, middle, end));
+	cell.black ().max_equals (middle, true,
+				  left.any ().score
+				  + right.non_black ().score
+				  + scorer.score (end, middle, begin));
+      } else if (middle - begin <= w_ || (left_ && begin == 0)) {
+	// @bug The above condition is redundant.  If the ParseController
+	// allows this midpoint, it must be close to begin or begin must be
+	// zero.
+
+	// (begin, middle) is narrow or begin == 0
+	cell.red ().max_equals (middle, false,
+				left.non_white ().score
+				+ right.non_white ().score
+				+ scorer.score (begin, middle, end));
+	cell.red ().max_equals (middle, true,
+				left.non_black ().score
+				+ right.non_black ().score
+				+ scorer.score (end, middle, begin));
+      }
+    }
+    // Changes cell from {white, black, red} to {non_black, non_white, any}.
+    cell.finish ();
+  }
+
   void QuadraticNormalLOPChart::permute (const ParseControllerRef & controller, ScorerRef & scorer) {
     // Initializes the scorer.
     scorer -> compute (controller);
@@ -202,47 +668,7 @@ namespace Permute {
 
     // Compute the rest of the cells.
     for (int span = 2; span <= n_; ++ span) {
-      for (int begin = 0; begin <= n_ - span; ++ begin) {
-	int end = begin + span;
-	// Initializes the (begin, end) cell.
-	QuadraticNormalLOPCell & cell = this -> cell (begin, end);
-	cell.white ().score = cell.black ().score = cell.red ().score = Core::Type <double>::min;
-	// Iterates over middle positions.
-	ParseController::iterator end_it = controller -> end (begin, end);
-	for (ParseController::iterator middle = controller -> begin (begin, end);
-	     middle != end_it;
-	     ++ middle) {
-	  const QuadraticNormalLOPCell & left = this -> cell (begin, middle);
-	  const QuadraticNormalLOPCell & right = this -> cell (middle, end);
-	  if (end - middle <= w_) {
-	    // (middle, end) is narrow:
-	    cell.white ().max_equals (middle, false,
-				      left.any ().score
-				      + right.non_white ().score
-				      + scorer -> score (begin, middle, end));
-	    cell.black ().max_equals (middle, true,
-				      left.any ().score
-				      + right.non_black ().score
-				      + scorer -> score (end, middle, begin));
-	  } else if (middle - begin <= w_ || (left_ && begin == 0)) {
-	    // @bug The above condition is redundant.  If the ParseController
-	    // allows this midpoint, it must be close to begin or begin must be
-	    // zero.
-
-	    // (begin, middle) is narrow or begin == 0
-	    cell.red ().max_equals (middle, false,
-				    left.non_white ().score
-				    + right.non_white ().score
-				    + scorer -> score (begin, middle, end));
-	    cell.red ().max_equals (middle, true,
-				    left.non_black ().score
-				    + right.non_black ().score
-				    + scorer -> score (end, middle, begin));
-	  }
-	}
-	// Changes cell from {white, black, red} to {non_black, non_white, any}.
-	cell.finish ();
-      }
+      parallelFor (pool_, 0, n_ - span + 1, Span (* this, controller, * scorer, span));
     }
   }
 
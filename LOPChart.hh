@@ -2,8 +2,11 @@
 #define _PERMUTE_LOP_CHART_HH
 
 #include "Path.hh"
+#include "ParseController.hh"
 #include "Permutation.hh"
 #include "LOPkBest.hh"
+#include "Scorer.hh"
+#include "ThreadPool.hh"
 
 namespace Permute {
 
@@ -39,41 +42,103 @@ namespace Permute {
 
   ////////////////////////////////////////////////////////////////////////////////
 
-  class LOPChart {
+  // The interface that the one-best LOP charts share, so that an application
+  // can choose among them at run time.
+  class OneBestChart : public Core::ReferenceCounted {
+  public:
+    virtual ~OneBestChart () {}
+    virtual void permute (const ParseControllerRef &, ScorerRef &) = 0;
+    virtual ConstPathRef getBestPath () const = 0;
+  };
+
+  typedef Core::Ref <OneBestChart> OneBestChartRef;
+
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // Given a thread pool, fills the cells of each span width in parallel.  The
+  // scorer must then be safe to call concurrently, as BeforeScorer is.
+  //
+  // The BANDED layout stores only the cells no wider than the window, which
+  // come first in index order.  Beyond the window only keeps are allowed, so a
+  // wider span is a monotone concatenation of narrower blocks, and the chart
+  // keeps just the best such concatenation of each prefix (0, j).  For scorers
+  // whose keep scores are additive, like the LOP scorers, this finds the same
+  // best score as the FULL layout in O(n w) cells.  Only the cubic controller
+  // allows every such concatenation, so under any other the chart stores every
+  // span as the FULL layout does.
+  //
+  // Cell scores are also kept in rows by begin and columns by end, so that the
+  // left and right children of a run of midpoints are contiguous, and the best
+  // midpoint of each run is found with the vectorized argmax.
+  class LOPChart : public OneBestChart {
+  public:
+    typedef enum { FULL, BANDED } Layout;
   private:
     Permutation & pi_;
     int n_;
     int window_;
+    int band_;
+    ThreadPoolRef pool_;
+    Layout layout_;
     std::vector <LOPCell> cells_;
+    std::vector <LOPCell> prefixes_;
+    std::vector <double> rows_, columns_;
+    // Scorer output for one run of midpoints, with a region per begin so that
+    // the spans of one width can be filled concurrently.
+    std::vector <double> keep_, swap_;
   public:
-    LOPChart (Permutation &, int = 0);
+    LOPChart (Permutation &, int = 0, const ThreadPoolRef & = ThreadPoolRef (),
+	      Layout = FULL);
     int index (int i, int j) const;
     void permute (const ParseControllerRef &, ScorerRef &);
     ConstPathRef getBestPath () const;
     int getWindow () const;
     int getLength () const;
   private:
+    class Parse;
+    template <class Policy> class Span;
+    template <class Policy> void parse (const Policy &, const Scorer &);
+    template <class Policy> void fill (const Policy &, const Scorer &, int, int);
+    void resize (const ParseControllerRef &);
+    void concatenate (const Scorer &);
     LOPCell & cell (int i, int j);
     const LOPCell & cell (int i, int j) const;
+    int row (int i, int j) const;
+    int column (int i, int j) const;
     ConstPathRef path (int i, int j) const;
   };
 
   ////////////////////////////////////////////////////////////////////////////////
 
-  class NormalLOPChart {
+  // Given a thread pool, chooses the best midpoints of each span width in
+  // parallel, then builds the winning paths serially, since Path reference
+  // counts are not thread-safe.  Supports the same layouts as LOPChart.
+  class NormalLOPChart : public OneBestChart {
   private:
     Permutation & pi_;
     int n_;
     int window_;
+    int band_;
+    ThreadPoolRef pool_;
+    LOPChart::Layout layout_;
     std::vector <ConstPathRef> cells_;
+    std::vector <ConstPathRef> prefixes_;
+    // The best keep and swap midpoints of each span in the current width, or
+    // -1 if none improves on the initial score.
+    std::vector <int> keep_, swap_;
   public:
-    NormalLOPChart (Permutation &, int = 0);
+    NormalLOPChart (Permutation &, int = 0, const ThreadPoolRef & = ThreadPoolRef (),
+		    LOPChart::Layout = LOPChart::FULL);
     int index (int i, int j, Path::Type type) const;
     void permute (const ParseControllerRef &, ScorerRef &);
-    const ConstPathRef & getBestPath () const;
+    ConstPathRef getBestPath () const;
     int getWindow () const;
     int getLength () const;
   private:
+    class Span;
+    void choose (const ParseControllerRef &, const Scorer &, int, int);
+    void resize (const ParseControllerRef &);
+    void concatenate (const Scorer &);
     const ConstPathRef & cell (int i, int j, Path::Type type) const;
     ConstPathRef & cell (int i, int j, Path::Type type);
     const ConstPathRef & betterPath (int i, int j) const;
@@ -81,6 +146,45 @@ namespace Permute {
 
   ////////////////////////////////////////////////////////////////////////////////
 
+  // Performs the same normal-form parse as NormalLOPChart, but stores only the
+  // score and midpoint of the best keep and swap derivation of each span, as
+  // LOPChart does, and builds the best path once, in getBestPath.  Since no
+  // paths are built while parsing, every width is filled in parallel given a
+  // thread pool.  Supports the same layouts as LOPChart.
+  class BackpointerNormalLOPChart : public OneBestChart {
+  private:
+    Permutation & pi_;
+    int n_;
+    int window_;
+    int band_;
+    ThreadPoolRef pool_;
+    LOPChart::Layout layout_;
+    ScorerRef scorer_;
+    std::vector <LOPCell> cells_;
+    std::vector <LOPCell> prefixes_;
+  public:
+    BackpointerNormalLOPChart (Permutation &, int = 0, const ThreadPoolRef & = ThreadPoolRef (),
+			       LOPChart::Layout = LOPChart::FULL);
+    int index (int i, int j, Path::Type type) const;
+    void permute (const ParseControllerRef &, ScorerRef &);
+    ConstPathRef getBestPath () const;
+    int getWindow () const;
+    int getLength () const;
+  private:
+    class Parse;
+    template <class Policy> class Span;
+    template <class Policy> void parse (const Policy &, const Scorer &);
+    template <class Policy> void fill (const Policy &, const Scorer &, int, int);
+    void resize (const ParseControllerRef &);
+    void concatenate (const Scorer &);
+    const LOPCell & cell (int i, int j, Path::Type type) const;
+    LOPCell & cell (int i, int j, Path::Type type);
+    Path::Type better (int i, int j) const;
+    ConstPathRef path (int i, int j, Path::Type type) const;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+
   class QuadraticNormalLOPCell {
   private:
     std::vector <LOPCell> cells_;
@@ -109,14 +213,18 @@ namespace Permute {
     int n_;
     int w_;
     bool left_;
+    ThreadPoolRef pool_;
     std::vector <QuadraticNormalLOPCell> cells_;
   public:
-    QuadraticNormalLOPChart (Permutation &, int = 1, bool = true);
+    QuadraticNormalLOPChart (Permutation &, int = 1, bool = true,
+			     const ThreadPoolRef & = ThreadPoolRef ());
     int index (int i, int j) const;
     void permute (const ParseControllerRef &, ScorerRef &);
     int getLength () const;
     ConstPathRef getBestPath () const;
   private:
+    class Span;
+    void fill (const ParseControllerRef &, const Scorer &, int, int);
     QuadraticNormalLOPCell & cell (int i, int j);
     const QuadraticNormalLOPCell & cell (int i, int j) const;
     ConstPathRef path (int i, int j, int color) const;
@@ -1,48 +1,46 @@
 #include <algorithm>
+#include <functional>
+#include <iterator>
 #include <numeric>
 
+#include "InsertScan.hh"
 #include "LinearOrdering.hh"
 #include "Log.hh"
 #include "ParseController.hh"
 
 namespace Permute {
 
-  // Implements greedy search of the insert neighborhood.
-  double search_insert (Permutation & pi, const BeforeCostRef & bc) {
+  // Implements greedy search of the insert neighborhood.  The first of the
+  // rows with the greatest gain wins, as does the first target within it.
+  double search_insert (Permutation & pi, PermutedCost & cost) {
     int max_i;
     int max_r;
     double max_delta = 0.0;
-    for (int i = 0; i < pi.size (); ++ i) {
-      double delta = 0.0;
-      // Looks to the left of i.
-      for (int r = i - 1; r >= 0; -- r) {
-	delta -= bc -> cost (pi [r], pi [i]);
-	delta += bc -> cost (pi [i], pi [r]);
-	if (delta > max_delta) {
-	  max_i = i;
-	  max_r = r;
-	  max_delta = delta;
-	}
-      }
-      delta = 0.0;
-      // Looks to the right of i.
-      for (int r = i + 1; r < pi.size (); ++ r) {
-	delta -= bc -> cost (pi [i], pi [r]);
-	delta += bc -> cost (pi [r], pi [i]);
-	if (delta > max_delta) {
-	  max_i = i;
-	  max_r = r;
-	  max_delta = delta;
+    double gain [INSERT_SCAN_ROWS];
+    int target [INSERT_SCAN_ROWS];
+    for (int x = 0; x < pi.size (); x += INSERT_SCAN_ROWS) {
+      int count = std::min (INSERT_SCAN_ROWS, static_cast <int> (pi.size ()) - x);
+      scanInserts (cost, x, count, gain, target);
+      for (int k = 0; k < count; ++ k) {
+	if (gain [k] > max_delta) {
+	  max_i = x + k;
+	  max_r = target [k];
+	  max_delta = gain [k];
 	}
       }
     }
     // Returns the new permutation if it is better.
     if (max_delta > 0.0) {
       insert (pi, max_i, max_r);
+      cost.insert (max_i, max_r);
     }
     return max_delta;
   }
-      
+
+  double search_insert (Permutation & pi, const BeforeCostRef & bc) {
+    PermutedCost cost (bc, pi);
+    return search_insert (pi, cost);
+  }
 
   // Implements the LS_f search described in Schiavinotto & Stützle (2004).  This
   // search efficiently computes the best permutation in the neighborhood of
@@ -61,39 +59,29 @@ namespace Permute {
   //   return \pi
   //
   // Returns whether a better permutation was found.
-  double visit (Permutation & pi, const BeforeCostRef & bc) {
-    for (int i = 0; i < pi.size (); ++ i) {
-      int max_r = i;
-      double max_delta = 0.0;
-      double delta = 0.0;
-      // Looks to the left of i.
-      for (int r = i - 1; r >= 0; -- r) {
-	delta -= bc -> cost (pi [r], pi [i]);
-	delta += bc -> cost (pi [i], pi [r]);
-	if (delta > max_delta) {
-	  max_r = r;
-	  max_delta = delta;
-	}
-      }
-      delta = 0.0;
-      // Looks to the right of i.
-      for (int r = i + 1; r < pi.size (); ++ r) {
-	delta -= bc -> cost (pi [i], pi [r]);
-	delta += bc -> cost (pi [r], pi [i]);
-	if (delta > max_delta) {
-	  max_r = r;
-	  max_delta = delta;
+  double visit (Permutation & pi, PermutedCost & cost) {
+    double gain [INSERT_SCAN_ROWS];
+    int target [INSERT_SCAN_ROWS];
+    for (int x = 0; x < pi.size (); x += INSERT_SCAN_ROWS) {
+      int count = std::min (INSERT_SCAN_ROWS, static_cast <int> (pi.size ()) - x);
+      scanInserts (cost, x, count, gain, target);
+      for (int k = 0; k < count; ++ k) {
+	// Returns the new permutation if it is better.
+	if (gain [k] > 0.0) {
+	  insert (pi, x + k, target [k]);
+	  cost.insert (x + k, target [k]);
+	  return gain [k];
 	}
       }
-      // Returns the new permutation if it is better.
-      if (max_delta > 0.0) {
-	insert (pi, i, max_r);
-	return max_delta;
-      }
     }
     return 0.0;
   }
 
+  double visit (Permutation & pi, const BeforeCostRef & bc) {
+    PermutedCost cost (bc, pi);
+    return visit (pi, cost);
+  }
+
   // Moves pi[i] to position j and shifts everything between.
   void insert (Permutation & pi, int i, int j) {
     for (int d = (i < j) ? 1 : -1; i != j; i += d) {
@@ -101,14 +89,224 @@ namespace Permute {
     }
   }
 
+  ////////////////////////////////////////////////////////////////////////////////
+
+  namespace {
+    Permutation identity (int n) {
+      Permutation pi;
+      integerPermutation (pi, n);
+      return pi;
+    }
+  }
+
+  InsertEngine::InsertEngine (Permutation & pi, const BeforeCostRef & bc) :
+    pi_ (pi),
+    cost_ (bc, identity (bc -> size ())),
+    n_ (0),
+    delta_ (),
+    best_ (),
+    stale_ (),
+    exact_ ()
+  {
+    this -> assign ();
+  }
+
+  void InsertEngine::assign () {
+    n_ = pi_.size ();
+    delta_.assign (n_ * n_, 0.0);
+    best_.resize (n_);
+    stale_.assign (n_, std::make_pair (0, n_ - 1));
+    exact_.assign (n_, false);
+  }
+
+  // Makes the first improving move in the order of visit.
+  double InsertEngine::visit () {
+    for (int x = 0; x < n_; ++ x) {
+      refresh (x);
+      if (delta (x, best_ [x]) > 0.0) {
+	settle (x);
+	double gain = delta (x, best_ [x]);
+	if (gain > 0.0) {
+	  insert (x, best_ [x]);
+	  return gain;
+	}
+      }
+    }
+    return 0.0;
+  }
+
+  // Makes the best move, choosing the lowest x among equals as search_insert
+  // does.
+  //
+  // Settling the best row may lower its gain, so the choice is repeated until
+  // it falls on a row that was already exact.
+  double InsertEngine::searchInsert () {
+    for (int x = 0; x < n_; ++ x) {
+      refresh (x);
+    }
+    for (;;) {
+      int max_x = -1;
+      double max_delta = 0.0;
+      for (int x = 0; x < n_; ++ x) {
+	double gain = delta (x, best_ [x]);
+	if (gain > max_delta) {
+	  max_x = x;
+	  max_delta = gain;
+	}
+      }
+      if (max_x < 0) {
+	return 0.0;
+      } else if (exact_ [max_x]) {
+	insert (max_x, best_ [max_x]);
+	return max_delta;
+      }
+      settle (max_x);
+    }
+  }
+
+  // Sums in the same order as BeforeCostInterface::score.
+  double InsertEngine::score () const {
+    double s = 0.0;
+    for (int a = 0; a < n_ - 1; ++ a) {
+      const PermutedCost::Pair * row = cost_.row (pi_ [a]);
+      for (int b = a + 1; b < n_; ++ b) {
+	s += row [pi_ [b]].before;
+      }
+    }
+    return s;
+  }
+
+  // Orders the targets of x as visit scans them: leftward from x - 1, then
+  // rightward from x + 1.  Staying put comes last.
+  int InsertEngine::rank (int x, int r) const {
+    if (r < x) {
+      return x - 1 - r;
+    } else if (r > x) {
+      return r - 1;
+    } else {
+      return n_;
+    }
+  }
+
+  bool InsertEngine::better (int x, int r, int s) {
+    return delta (x, r) > delta (x, s)
+      || (delta (x, r) == delta (x, s) && rank (x, r) < rank (x, s));
+  }
+
+  // Brings row x up to date after the moves since it was last read.  A move
+  // only reorders the positions between its ends, so a row outside that range
+  // recomputes just those entries.
+  void InsertEngine::refresh (int x) {
+    int lo = stale_ [x].first, hi = stale_ [x].second;
+    if (lo > hi) {
+      return;
+    } else if (lo <= x && x <= hi) {
+      fill (x);
+      choose (x);
+      exact_ [x] = true;
+    } else {
+      fill (x, lo, hi);
+      choose (x, lo, hi);
+    }
+    stale_ [x] = std::make_pair (n_, -1);
+  }
+
+  // Recomputes row x in full unless it is already exact, so that its best
+  // gain is the one visit would find.
+  void InsertEngine::settle (int x) {
+    if (! exact_ [x]) {
+      fill (x);
+      choose (x);
+      exact_ [x] = true;
+    }
+  }
+
+  // Accumulates the gains of row x exactly as visit does.
+  void InsertEngine::fill (int x) {
+    const PermutedCost::Pair * row = cost_.row (pi_ [x]);
+    double d = 0.0;
+    for (int r = x - 1; r >= 0; -- r) {
+      d -= row [pi_ [r]].after;
+      d += row [pi_ [r]].before;
+      delta (x, r) = d;
+    }
+    delta (x, x) = 0.0;
+    d = 0.0;
+    for (int r = x + 1; r < n_; ++ r) {
+      d -= row [pi_ [r]].before;
+      d += row [pi_ [r]].after;
+      delta (x, r) = d;
+    }
+  }
+
+  // Recomputes the gains of row x for the targets in [lo, hi], where x lies
+  // outside that range, continuing from the gain of the target next to it.
+  void InsertEngine::fill (int x, int lo, int hi) {
+    const PermutedCost::Pair * row = cost_.row (pi_ [x]);
+    if (x < lo) {
+      double d = (lo - 1 > x) ? delta (x, lo - 1) : 0.0;
+      for (int r = lo; r <= hi; ++ r) {
+	d -= row [pi_ [r]].before;
+	d += row [pi_ [r]].after;
+	delta (x, r) = d;
+      }
+    } else {
+      double d = (hi + 1 < x) ? delta (x, hi + 1) : 0.0;
+      for (int r = hi; r >= lo; -- r) {
+	d -= row [pi_ [r]].after;
+	d += row [pi_ [r]].before;
+	delta (x, r) = d;
+      }
+    }
+  }
+
+  void InsertEngine::choose (int x) {
+    best_ [x] = x;
+    for (int r = 0; r < n_; ++ r) {
+      if (better (x, r, best_ [x])) {
+	best_ [x] = r;
+      }
+    }
+  }
+
+  // Updates the best target of row x after its gains in [lo, hi] changed.
+  // Only rescans the row if the old best was among them.
+  void InsertEngine::choose (int x, int lo, int hi) {
+    if (lo <= best_ [x] && best_ [x] <= hi) {
+      choose (x);
+    } else {
+      for (int r = lo; r <= hi; ++ r) {
+	if (better (x, r, best_ [x])) {
+	  best_ [x] = r;
+	}
+      }
+    }
+  }
+
+  // Moves position i to j and widens the stale range of every row to cover
+  // the positions between them.
+  void InsertEngine::insert (int i, int j) {
+    Permute::insert (pi_, i, j);
+    int lo = std::min (i, j), hi = std::max (i, j);
+    for (int x = 0; x < n_; ++ x) {
+      stale_ [x].first = std::min (stale_ [x].first, lo);
+      stale_ [x].second = std::max (stale_ [x].second, hi);
+      exact_ [x] = false;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+
   class Ratio {
   public:
     int i;
+    int position;
     double first;
     double last;
     bool used;
     Ratio (int i, double first, double last) :
       i (i),
+      position (0),
       first (first),
       last (last),
       used (false)
@@ -143,16 +341,24 @@ namespace Permute {
   // For each remaining element, subtracts the effect of the last removed item
   // from each numerator and denominator, while simultaneously recording the
   // maximum ratio.
+  //
+  // Items stay indexed by element, but remember their position in the initial
+  // permutation, where the view of the costs finds them.
   double becker_greedy (Permutation & pi, const BeforeCostRef & bc) {
     double score = 0;
+    PermutedCost cost (bc, pi);
     std::vector <Ratio> items (pi.size (), Ratio (0, 0, 0));
-    for (Permutation::const_iterator i = pi.begin (); i != pi.end (); ++ i) {
-      items [* i].i = * i;
-      for (Permutation::const_iterator j = i + 1; j != pi.end (); ++ j) {
-	items [* i].first += bc -> cost (* i, * j);
-	items [* i].last += bc -> cost (* j, * i);
-	items [* j].first += bc -> cost (* j, * i);
-	items [* j].last += bc -> cost (* i, * j);
+    for (int a = 0; a < pi.size (); ++ a) {
+      Ratio & item = items [pi [a]];
+      item.i = pi [a];
+      item.position = a;
+      const PermutedCost::Pair * row = cost.row (a);
+      for (int b = a + 1; b < pi.size (); ++ b) {
+	Ratio & other = items [pi [b]];
+	item.first += row [b].before;
+	item.last += row [b].after;
+	other.first += row [b].after;
+	other.last += row [b].before;
       }
     }
     for (Permutation::iterator pi_it = pi.begin (); pi_it != pi.end (); ++ pi_it) {
@@ -163,10 +369,11 @@ namespace Permute {
       score += best -> first;
       best -> used = true;
       // Updates the first and last scores of the remaining items:
+      const PermutedCost::Pair * row = cost.row (best -> position);
       for (std::vector <Ratio>::iterator it = items.begin (); it != items.end (); ++ it) {
 	if (! it -> used) {
-	  it -> first -= bc -> cost (it -> i, best -> i);
-	  it -> last -= bc -> cost (best -> i, it -> i);
+	  it -> first -= row [it -> position].after;
+	  it -> last -= row [it -> position].before;
 	}
       }
     }
@@ -175,58 +382,70 @@ namespace Permute {
 
   ////////////////////////////////////////////////////////////////////////////////
 
-  typedef std::vector <double> V1D;
-  typedef std::vector <V1D> V2D;
-  typedef std::vector <V2D> V3D;
+  BlockWorkspace::BlockWorkspace () :
+    n_ (0)
+  {}
 
-  // Would it be faster to use a static vector instead of reallocating it each
-  // time?
-  double block_lsf (Permutation & pi, const BeforeCostRef & bc, int max_width) {
+  void BlockWorkspace::resize (int n) {
+    n_ = n;
+  }
+
+  // Grows the current width a row at a time, since most calls stop after the
+  // first few rows.
+  const double * BlockWorkspace::fill (const PermutedCost & cost, int w, int i) {
+    typedef std::reverse_iterator <double *> Reverse;
+    if (current_.size () < (i + 1) * (n_ + 1)) {
+      current_.resize ((i + 1) * (n_ + 1));
+    }
+    double * dwi = row (current_, i);
+    int j = i + w + 1;
+    // (k, i, j)
+    differences (cost.row (j - 1), i, false, dwi);
+    std::partial_sum (Reverse (dwi + i), Reverse (dwi), Reverse (dwi + i));
+    if (w > 0) {
+      std::transform (dwi, dwi + i, row (previous_, i), dwi,
+		      std::plus <double> ());
+    }
+    std::fill (dwi + i, dwi + j + 1, 0.0);
+    // (i, j, k)
+    differences (cost.row (i) + j, n_ - j, true, dwi + j + 1);
+    std::partial_sum (dwi + j + 1, dwi + n_ + 1, dwi + j + 1);
+    if (w > 0) {
+      std::transform (dwi + j + 1, dwi + n_ + 1, row (previous_, i + 1) + j + 1,
+		      dwi + j + 1,
+		      std::plus <double> ());
+    }
+    return dwi;
+  }
+
+  double block_lsf (Permutation & pi, PermutedCost & cost, int max_width, BlockWorkspace & workspace) {
     max_width = std::min (max_width, static_cast <int> (pi.size ()) / 2);
-    V3D delta (max_width);
+    workspace.resize (pi.size ());
     for (int w = 0; w < max_width; ++ w) {
-      V2D & dw = delta [w];
-      dw.resize (pi.size () - w - 1);
-      for (int i = 0; i < dw.size (); ++ i) {
-	V1D & dwi = dw [i];
-	dwi.resize (pi.size () + 1, 0.0);
-	int j = i + w + 1;
-	for (int k = 0; k < i; ++ k) { // (k, i, j)
-	  dwi [k] =
-	    bc -> cost (pi [j - 1], pi [k]) -
-	    bc -> cost (pi [k], pi [j - 1]);
-	}
-	std::partial_sum (dwi.rend () - i, dwi.rend (),
-			  dwi.rend () - i);
-	if (w > 0) {
-	  std::transform (dwi.begin (), dwi.begin () + i,
-			  delta [w - 1] [i].begin (),
-			  dwi.begin (),
-			  std::plus <double> ());
-	}
-	for (int k = j + 1; k <= pi.size (); ++ k) { // (i, j, k)
-	  dwi [k] =
-	    bc -> cost (pi [k - 1], pi [i]) -
-	    bc -> cost (pi [i], pi [k - 1]);
-	}
-	std::partial_sum (dwi.begin () + j + 1, dwi.end (),
-			  dwi.begin () + j + 1);
-	if (w > 0) {
-	  std::transform (dwi.begin () + j + 1, dwi.end (),
-			  delta [w - 1] [i + 1].begin () + j + 1,
-			  dwi.begin () + j + 1,
-			  std::plus <double> ());
-	}
- 	V1D::const_iterator max_it = std::max_element (dwi.begin (), dwi.end ());
+      for (int i = 0; i + w + 1 < pi.size (); ++ i) {
+	const double * dwi = workspace.fill (cost, w, i);
+	const double * max_it = std::max_element (dwi, dwi + pi.size () + 1);
  	if (* max_it > 0.0) {
-	  insert (pi, i, j, max_it - dwi.begin ());
+	  insert (pi, i, i + w + 1, max_it - dwi);
+	  cost.insert (i, i + w + 1, max_it - dwi);
 	  return * max_it;
  	}
       }
+      workspace.next ();
     }
     return 0.0;
   }
 
+  double block_lsf (Permutation & pi, PermutedCost & cost, int max_width) {
+    BlockWorkspace workspace;
+    return block_lsf (pi, cost, max_width, workspace);
+  }
+
+  double block_lsf (Permutation & pi, const BeforeCostRef & bc, int max_width) {
+    PermutedCost cost (bc, pi);
+    return block_lsf (pi, cost, max_width);
+  }
+
   // Moves the contents of (i, j) after the contents of (j, k).
   void insert (Permutation & pi, int i, int j, int k) {
     if (k < i) {
@@ -278,12 +497,11 @@ namespace Permute {
 
   ////////////////////////////////////////////////////////////////////////////////
 
-  double search_adjacent (Permutation & pi, const BeforeCostRef & bc) {
+  double search_adjacent (Permutation & pi, PermutedCost & cost) {
     int max_i;
     double max_delta = 0.0;
     for (int i = 0; i < pi.size () - 1; ++ i) {
-      double delta = bc -> cost (pi [i + 1], pi [i])
-	- bc -> cost (pi [i], pi [i + 1]);
+      double delta = cost.after (i, i + 1) - cost.before (i, i + 1);
       if (delta > max_delta) {
 	max_i = i;
 	max_delta = delta;
@@ -291,10 +509,16 @@ namespace Permute {
     }
     if (max_delta > 0.0) {
       std::swap (pi [max_i], pi [max_i + 1]);
+      cost.insert (max_i, max_i + 1);
     }
     return max_delta;
   }
 
+  double search_adjacent (Permutation & pi, const BeforeCostRef & bc) {
+    PermutedCost cost (bc, pi);
+    return search_adjacent (pi, cost);
+  }
+
   ////////////////////////////////////////////////////////////////////////////////
 
   QuadraticNeighborhood::QuadraticNeighborhood (const Permutation & permutation,
@@ -7,12 +7,81 @@
 
 namespace Permute {
 
+  // Each search comes in two forms.  The PermutedCost form reads the costs from
+  // a view of pi, and applies its move to both pi and the view, so a caller
+  // can keep one view across many iterations.  The BeforeCostRef form builds
+  // a view for a single call.
+  double search_insert (Permutation & pi, PermutedCost & cost);
   double search_insert (Permutation & pi, const BeforeCostRef & bc);
+  double visit (Permutation & pi, PermutedCost & cost);
   double visit (Permutation & pi, const BeforeCostRef & bc);
   void insert (Permutation & pi, int i, int j);
 
   double becker_greedy (Permutation & pi, const BeforeCostRef & bc);
 
+  // InsertEngine runs LS_f (visit) and greedy insert search (search_insert)
+  // from a table of insert deltas that it keeps up to date lazily between
+  // moves.  With integer costs it makes the same moves as visit and
+  // search_insert.
+  class InsertEngine {
+  private:
+    Permutation & pi_;
+    // The costs in element order, which never changes.
+    PermutedCost cost_;
+    int n_;
+    std::vector <double> delta_;
+    std::vector <int> best_;
+    // Row x is up to date outside [stale_ [x].first, stale_ [x].second].
+    std::vector <std::pair <int, int> > stale_;
+    // Whether row x has been recomputed in full since the last move.
+    std::vector <bool> exact_;
+  public:
+    InsertEngine (Permutation & pi, const BeforeCostRef & bc);
+
+    // Rebuilds the table after pi has been changed by some other means.
+    void assign ();
+    double visit ();
+    double searchInsert ();
+    double score () const;
+  private:
+    double & delta (int x, int r) { return delta_ [x * n_ + r]; }
+    int rank (int x, int r) const;
+    bool better (int x, int r, int s);
+    void refresh (int x);
+    void settle (int x);
+    void fill (int x);
+    void fill (int x, int lo, int hi);
+    void choose (int x);
+    void choose (int x, int lo, int hi);
+    void insert (int i, int j);
+  };
+
+  // Holds the deltas of block_lsf and blockSearch.  Entry k of row i at width
+  // w is the gain of moving the block (i, i + w + 1) to k, and each width is
+  // built from the one before it, so only two widths are kept at a time.
+  // Reusing one workspace across calls keeps its memory from one call to the
+  // next.
+  class BlockWorkspace {
+  private:
+    int n_;
+    std::vector <double> previous_;
+    std::vector <double> current_;
+  public:
+    BlockWorkspace ();
+
+    // Prepares for a permutation of length n.
+    void resize (int n);
+    // Computes row i at width w into the current width, from the previous
+    // width if w > 0, and returns it.  Entries i through i + w + 1 are zero.
+    const double * fill (const PermutedCost & cost, int w, int i);
+    // Makes the current width the previous one.
+    void next () { previous_.swap (current_); }
+  private:
+    double * row (std::vector <double> & layer, int i) { return & layer [i * (n_ + 1)]; }
+  };
+
+  double block_lsf (Permutation & pi, PermutedCost & cost, int max_width, BlockWorkspace & workspace);
+  double block_lsf (Permutation & pi, PermutedCost & cost, int max_width);
   double block_lsf (Permutation & pi, const BeforeCostRef & bc, int max_width);
   void insert (Permutation & pi, int i, int j, int k);
 
@@ -32,6 +101,7 @@ namespace Permute {
     virtual double score ();
   };
 
+  double search_adjacent (Permutation & pi, PermutedCost & cost);
   double search_adjacent (Permutation & pi, const BeforeCostRef & bc);
 
   // 
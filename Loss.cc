@@ -12,7 +12,7 @@ namespace Permute {
     bleu_ += computeBleuScore (ref, cand);
     AdjacentLoss adj (ref);
     adjacent_ += adj.score (cand);
-    tau_ += tauScorer (ref, cand) -> score (cand);
+    tau_ += tauScore (ref, cand);
   }
 
   std::ostream & operator << (std::ostream & out, const Loss & loss) {
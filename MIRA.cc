@@ -4,7 +4,7 @@
 namespace Permute {
 
   bool operator < (const WRef & left, const WRef & right) {
-    return left.get () < right.get ();
+    return left.address () < right.address ();
   }
 
   SparsePV::SparsePV (double margin) :
@@ -80,7 +80,7 @@ namespace Permute {
     const Sum & sum = bc -> operator () (l, r);
     for (std::vector <WRef>::const_iterator it = sum.begin ();
 	 it != sum.end (); ++ it) {
-      operator [] (* it) += sign;
+      operator [] (* it) += sign * sum.sign (it);
     }
   }
   
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "Memetic.hh"
+
+namespace Permute {
+
+  namespace {
+    // Orders individuals by decreasing score, and equal scores by order, so
+    // that duplicates end up next to each other.
+    class Better {
+    public:
+      bool operator () (const Memetic::Individual & a, const Memetic::Individual & b) const {
+	if (a.score != b.score) {
+	  return a.score > b.score;
+	}
+	return a.order < b.order;
+      }
+    };
+
+    class Same {
+    public:
+      bool operator () (const Memetic::Individual & a, const Memetic::Individual & b) const {
+	return a.order == b.order;
+      }
+    };
+
+    // Binds improve to the search for use with parallelFor.
+    class Improve {
+    private:
+      Memetic & memetic_;
+    public:
+      Improve (Memetic & memetic) : memetic_ (memetic) {}
+      void operator () (int index) const {
+	memetic_.improve (index);
+      }
+    };
+  }
+
+  Memetic::Memetic (const BeforeCostRef & bc,
+		    const ThreadPoolRef & pool,
+		    int size,
+		    int children,
+		    int blockWidth,
+		    int patience,
+		    unsigned seed) :
+    bc_ (bc),
+    pool_ (pool),
+    size_ (std::max (size, 1)),
+    children_ (std::max (children, 1)),
+    blockWidth_ (blockWidth),
+    patience_ (std::max (patience, 1)),
+    state_ (seed),
+    population_ (),
+    offspring_ (),
+    generations_ (0),
+    restarts_ (0),
+    timer_ ()
+  {}
+
+  double Memetic::run (Permutation & pi, int generations, double seconds) {
+    timer_.start ();
+    generations_ = 0;
+    restarts_ = 0;
+
+    population_.clear ();
+    offspring_.assign (size_, Individual ());
+    for (std::vector <Individual>::iterator it = offspring_.begin (); it != offspring_.end (); ++ it) {
+      shuffle (* it);
+    }
+    improveOffspring ();
+    select ();
+
+    double bestAverage = average ();
+    int stale = 0;
+    while (generations_ < generations && ! expired (seconds)) {
+      offspring_.resize (children_);
+      const int size = population_.size ();
+      for (std::vector <Individual>::iterator it = offspring_.begin (); it != offspring_.end (); ++ it) {
+	int a = random (size), b = a;
+	if (size > 1) {
+	  b = random (size - 1);
+	  if (b >= a) {
+	    ++ b;
+	  }
+	}
+	crossover (population_ [a], population_ [b], * it);
+      }
+      improveOffspring ();
+      select ();
+      ++ generations_;
+
+      double mean = average ();
+      if (mean > bestAverage) {
+	bestAverage = mean;
+	stale = 0;
+      } else if (++ stale >= patience_) {
+	restart ();
+	bestAverage = average ();
+	stale = 0;
+      }
+    }
+
+    const Individual & best = population_.front ();
+    std::copy (best.order.begin (), best.order.end (), pi.begin ());
+    return best.score;
+  }
+
+  // Reads the cost matrix only through bc_, and builds its own permutation,
+  // view and workspace, so that children can be improved side by side.
+  void Memetic::improve (int index) {
+    Individual & child = offspring_ [index];
+    Permutation pi;
+    pi.assign (child.order.begin (), child.order.end ());
+    PermutedCost cost (bc_, pi);
+    while (visit (pi, cost) > 0.0);
+    if (blockWidth_ > 0) {
+      BlockWorkspace workspace;
+      while (block_lsf (pi, cost, blockWidth_, workspace) > 0.0);
+    }
+    child.order.assign (pi.begin (), pi.end ());
+    child.score = cost.score ();
+  }
+
+  int Memetic::random (int n) {
+    return rand_r (& state_) % n;
+  }
+
+  void Memetic::shuffle (Individual & individual) {
+    const int n = bc_ -> size ();
+    individual.order.resize (n);
+    for (int i = 0; i < n; ++ i) {
+      individual.order [i] = i;
+    }
+    for (int i = n - 1; i > 0; -- i) {
+      std::swap (individual.order [i], individual.order [random (i + 1)]);
+    }
+  }
+
+  // Order-based crossover (Syswerda, 1991): chooses a random subset of the
+  // positions of b, and rearranges the elements at those positions within a
+  // copy of a into the order they have in b.
+  void Memetic::crossover (const Individual & a, const Individual & b, Individual & child) {
+    const int n = a.order.size ();
+    std::vector <bool> chosen (n, false);
+    std::vector <size_t> picked;
+    for (int p = 0; p < n; ++ p) {
+      if (random (2)) {
+	chosen [b.order [p]] = true;
+	picked.push_back (b.order [p]);
+      }
+    }
+    child.order = a.order;
+    std::vector <size_t>::const_iterator next = picked.begin ();
+    for (int i = 0; i < n; ++ i) {
+      if (chosen [child.order [i]]) {
+	child.order [i] = * next ++;
+      }
+    }
+  }
+
+  void Memetic::improveOffspring () {
+    parallelFor (pool_, 0, offspring_.size (), Improve (* this), 1);
+  }
+
+  // Keeps the best size_ distinct individuals among the population and the
+  // offspring, best first.
+  void Memetic::select () {
+    population_.insert (population_.end (), offspring_.begin (), offspring_.end ());
+    offspring_.clear ();
+    std::sort (population_.begin (), population_.end (), Better ());
+    population_.erase (std::unique (population_.begin (), population_.end (), Same ()),
+		       population_.end ());
+    if (population_.size () > size_) {
+      population_.resize (size_);
+    }
+  }
+
+  // Keeps only the best individual, and fills the rest of the population with
+  // new random local optima.
+  void Memetic::restart () {
+    population_.resize (1);
+    offspring_.assign (size_ - 1, Individual ());
+    for (std::vector <Individual>::iterator it = offspring_.begin (); it != offspring_.end (); ++ it) {
+      shuffle (* it);
+    }
+    improveOffspring ();
+    select ();
+    ++ restarts_;
+  }
+
+  double Memetic::average () const {
+    double sum = 0.0;
+    for (std::vector <Individual>::const_iterator it = population_.begin (); it != population_.end (); ++ it) {
+      sum += it -> score;
+    }
+    return sum / population_.size ();
+  }
+
+  // Core::Timer measures up to the last call to stop.
+  bool Memetic::expired (double seconds) {
+    if (seconds <= 0.0) {
+      return false;
+    }
+    timer_.stop ();
+    return timer_.elapsed () >= seconds;
+  }
+}
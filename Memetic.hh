@@ -0,0 +1,79 @@
+#ifndef _PERMUTE_MEMETIC_HH
+#define _PERMUTE_MEMETIC_HH
+
+#include <Core/Statistics.hh>
+
+#include "BeforeScorer.hh"
+#include "LinearOrdering.hh"
+#include "Permutation.hh"
+#include "ThreadPool.hh"
+
+namespace Permute {
+
+  // Implements a memetic algorithm for the linear ordering problem, after
+  // Schiavinotto & Stützle (2004).  Every individual of the population is a
+  // local optimum: each generation recombines random pairs of parents with
+  // order-based crossover, improves each child with LS_f (visit), followed by
+  // block_lsf if a block width is given, and keeps the best distinct
+  // individuals of parents and children.  Duplicates never survive selection,
+  // and once the average score of the population has not improved for
+  // patience generations, every individual but the best is replaced by a new
+  // random local optimum.
+  //
+  // Children are produced on the calling thread and improved in parallel on
+  // the thread pool, so for a given seed the search is the same for any
+  // number of threads.
+  class Memetic {
+  public:
+    class Individual {
+    public:
+      std::vector <size_t> order;
+      double score;
+      Individual () : order (), score (0.0) {}
+    };
+  private:
+    BeforeCostRef bc_;
+    ThreadPoolRef pool_;
+    int size_;
+    int children_;
+    int blockWidth_;
+    int patience_;
+    unsigned state_;
+    std::vector <Individual> population_;
+    std::vector <Individual> offspring_;
+    int generations_;
+    int restarts_;
+    Core::Timer timer_;
+  public:
+    Memetic (const BeforeCostRef & bc,
+	     const ThreadPoolRef & pool,
+	     int size,
+	     int children,
+	     int blockWidth,
+	     int patience,
+	     unsigned seed);
+
+    // Evolves a new population for the given number of generations, or until
+    // seconds of wall-clock time have passed if seconds is positive.  Leaves
+    // the best permutation in pi, which must have the right length, and
+    // returns its score.
+    double run (Permutation & pi, int generations, double seconds = 0.0);
+    int generations () const { return generations_; }
+    int restarts () const { return restarts_; }
+    const std::vector <Individual> & population () const { return population_; }
+
+    // Improves child index by local search.  Public for the thread pool.
+    void improve (int index);
+  private:
+    int random (int n);
+    void shuffle (Individual & individual);
+    void crossover (const Individual & a, const Individual & b, Individual & child);
+    void improveOffspring ();
+    void select ();
+    void restart ();
+    double average () const;
+    bool expired (double seconds);
+  };
+}
+
+#endif//_PERMUTE_MEMETIC_HH
@@ -1,4 +1,5 @@
 #include "Outside.hh"
+#include "ParsePolicy.hh"
 
 namespace Permute {
   // The mapping from (begin, end) pairs to one-dimensional indices differs for
@@ -20,15 +21,24 @@ namespace Permute {
     outside_ (1 + index (0, n_, n_), Core::Type <double>::min)
   {}
 
-  // Populates the outside_ array with outside estimates.  First, calls
-  // Chart::permute to compute best paths in all spans.  Next, initializes the
-  // outside_ array to double::min, except outside(0,n) = 0.0.  Then, for each
-  // span, sets outside(i,j) to the max over k of
-  //   outside(i,k) + max(gamma(i,j,k), bargamma(i,j,k)) + inside(j,k)
-  // and
-  //   outside(k,j) + max(gamma(k,i,j), bargamma(k,i,j)) + inside(k,i).
-  void Outside::estimate (ParseControllerRef controller, ScorerRef scorer) {
-    Chart::permute (chart_, controller, scorer);
+  // Binds fill to an Outside and scorer for use with dispatch.
+  class Outside::Estimate {
+  private:
+    Outside & outside_;
+    const Scorer & scorer_;
+  public:
+    Estimate (Outside & outside, const Scorer & scorer) :
+      outside_ (outside),
+      scorer_ (scorer)
+    {}
+    template <class Policy>
+    void operator () (const Policy & policy) const {
+      outside_.fill (policy, scorer_);
+    }
+  };
+
+  template <class Policy>
+  void Outside::fill (const Policy & policy, const Scorer & scorer) {
     for (std::vector <double>::iterator i = outside_.begin (); i != outside_.end (); ++ i) {
       * i = Core::Type <double>::min;
     }
@@ -36,8 +46,8 @@ namespace Permute {
     for (int span = n_; span >= 2; -- span) {
       for (int i = 0; i <= n_ - span; ++ i) {
 	int k = i + span;
-	for (ParseController::iterator j = controller -> begin (i, k); j != controller -> end (i, k); ++ j) {
-	  double alpha = outside (i, k) + std::max (scorer -> score (i, j, k), scorer -> score (k, j, i));
+	for (typename Policy::iterator j = policy.begin (i, k), j_end = policy.end (i, k); j != j_end; ++ j) {
+	  double alpha = outside (i, k) + std::max (scorer.score (i, j, k), scorer.score (k, j, i));
 	  operator () (i, j) = std::max (outside (i, j), alpha + inside (chart_, j, k));
 	  operator () (j, k) = std::max (outside (j, k), alpha + inside (chart_, i, j));
 	}
@@ -45,6 +55,18 @@ namespace Permute {
     }
   }
 
+  // Populates the outside_ array with outside estimates.  First, calls
+  // Chart::permute to compute best paths in all spans.  Next, initializes the
+  // outside_ array to double::min, except outside(0,n) = 0.0.  Then, for each
+  // span, sets outside(i,j) to the max over k of
+  //   outside(i,k) + max(gamma(i,j,k), bargamma(i,j,k)) + inside(j,k)
+  // and
+  //   outside(k,j) + max(gamma(k,i,j), bargamma(k,i,j)) + inside(k,i).
+  void Outside::estimate (ParseControllerRef controller, ScorerRef scorer) {
+    Chart::permute (chart_, controller, scorer);
+    dispatch (controller, Estimate (* this, * scorer));
+  }
+
   // Returns a reference to the appropriate element in the outside_ array. 
   double & Outside::operator () (int begin, int end) {
     return outside_ [index (begin, end, n_)];
@@ -12,6 +12,8 @@ namespace Permute {
     int n_;
     std::vector <double> outside_;
     double & operator () (int, int);
+    class Estimate;
+    template <class Policy> void fill (const Policy &, const Scorer &);
   public:
     Outside (ChartRef);
     void estimate (ParseControllerRef, ScorerRef);
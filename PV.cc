@@ -1,3 +1,13 @@
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
 #include <Core/Application.hh>
 #include <Core/Choice.hh>
 #include <Core/StringUtilities.hh>
@@ -67,6 +77,29 @@ namespace Permute {
     return inverse_ [vz];
   }
 
+  int FeatureType::id (const std::string & value) {
+    return decode (intern (value));
+  }
+
+  // Reads the little-endian counter that intern writes.
+  int FeatureType::decode (const std::string & vz) const {
+    int id = 0;
+    for (int b = bytes_ - 1; b >= 0; -- b) {
+      id = (id << 8) | static_cast <unsigned char> (vz [b]);
+    }
+    return id;
+  }
+
+  void FeatureType::values (std::vector <std::string> & values) const {
+    values.assign (map_.size (), "");
+    for (const_iterator it = map_.begin (); it != map_.end (); ++ it) {
+      const int id = decode (it -> second);
+      if (id < values.size ()) {
+	values [id] = it -> first;
+      }
+    }
+  }
+
   /**********************************************************************
    * FeatureTemplate methods
    **********************************************************************/
@@ -179,6 +212,154 @@ namespace Permute {
     return map.print (out);
   }
 
+  /**********************************************************************
+   * KeyTable methods
+   **********************************************************************/
+
+  namespace {
+    // The finalizer of SplitMix64, which spreads every input bit over the
+    // whole key.
+    FeatureKey mix (FeatureKey key) {
+      key ^= key >> 30;
+      key *= 0xbf58476d1ce4e5b9ULL;
+      key ^= key >> 27;
+      key *= 0x94d049bb133111ebULL;
+      key ^= key >> 31;
+      return key;
+    }
+
+    FeatureKey extend (FeatureKey key, int id) {
+      return mix (key ^ (FeatureKey (id) + 0x9e3779b97f4a7c15ULL));
+    }
+  }
+
+  KeyTable::KeyTable () :
+    keys_ (),
+    slots_ (),
+    weights_ (),
+    collisions_ (0)
+  {}
+
+  void KeyTable::clear () {
+    keys_.clear ();
+    slots_.clear ();
+    weights_.clear ();
+    collisions_ = 0;
+  }
+
+  // Grows the table to hold n keys at most half full, moving the keys it
+  // already holds.
+  void KeyTable::reserve (size_t n) {
+    size_t capacity = 16;
+    while (capacity < 2 * n) {
+      capacity *= 2;
+    }
+    if (capacity <= slots_.size ()) {
+      return;
+    }
+    std::vector <FeatureKey> keys (capacity, 0);
+    std::vector <int> slots (capacity, -1);
+    keys.swap (keys_);
+    slots.swap (slots_);
+    for (size_t s = 0; s < slots.size (); ++ s) {
+      if (slots [s] >= 0) {
+	size_t t = probe (keys [s]);
+	keys_ [t] = keys [s];
+	slots_ [t] = slots [s];
+      }
+    }
+  }
+
+  bool KeyTable::insert (FeatureKey key, const WRef & w) {
+    reserve (weights_.size () + 1);
+    size_t s = probe (key);
+    if (slots_ [s] < 0) {
+      keys_ [s] = key;
+      slots_ [s] = weights_.size ();
+      weights_.push_back (w);
+      return true;
+    } else if (weights_ [slots_ [s]] == w) {
+      return true;
+    } else {
+      ++ collisions_;
+      return false;
+    }
+  }
+
+  const WRef * KeyTable::find (FeatureKey key) const {
+    if (slots_.empty ()) {
+      return 0;
+    }
+    int slot = slots_ [probe (key)];
+    return slot < 0 ? 0 : & weights_ [slot];
+  }
+
+  // Returns the slot holding key, or the empty slot where it belongs.  Keys
+  // are already mixed, so their low bits serve as the hash.
+  size_t KeyTable::probe (FeatureKey key) const {
+    const size_t mask = slots_.size () - 1;
+    size_t s = key & mask;
+    while (slots_ [s] >= 0 && keys_ [s] != key) {
+      s = (s + 1) & mask;
+    }
+    return s;
+  }
+
+  /**********************************************************************
+   * MappedPV methods
+   **********************************************************************/
+
+  MappedPV::MappedPV (void * map, size_t length, size_t size,
+		      const FeatureKey * keys, const double * weights,
+		      const u64 * offsets, const char * strings) :
+    Core::ReferenceCounted (),
+    map_ (map),
+    length_ (length),
+    size_ (size),
+    keys_ (keys),
+    weights_ (weights),
+    offsets_ (offsets),
+    strings_ (strings)
+  {}
+
+  MappedPV::~MappedPV () {
+    ::munmap (map_, length_);
+  }
+
+  const double * MappedPV::find (FeatureKey key) const {
+    const FeatureKey * it = std::lower_bound (keys_, keys_ + size_, key);
+    return (it != keys_ + size_ && * it == key) ? weights_ + (it - keys_) : 0;
+  }
+
+  std::string MappedPV::feature (size_t n) const {
+    return std::string (strings_ + offsets_ [n], strings_ + offsets_ [n + 1]);
+  }
+
+  /**********************************************************************
+   * HashedWeights methods
+   **********************************************************************/
+
+  HashedWeights::HashedWeights () :
+    weights_ (),
+    mask_ (0),
+    signed_ (false)
+  {}
+
+  void HashedWeights::resize (int bits, bool sign) {
+    std::vector <double> weights (size_t (1) << bits, 0.0);
+    weights_.swap (weights);
+    mask_ = (FeatureKey (1) << bits) - 1;
+    signed_ = sign;
+  }
+
+  int HashedWeights::bits () const {
+    int bits = 0;
+    while ((FeatureKey (1) << bits) < weights_.size ()) {
+      ++ bits;
+    }
+    return bits;
+  }
+
   /**********************************************************************
    * TemplateList methods
    **********************************************************************/
@@ -345,6 +526,95 @@ namespace Permute {
     return buffer.str ();
   }
 
+  bool TemplateList::keyed () const {
+    for (const_iterator it = map_.begin (); it != map_.end (); ++ it) {
+      for (int i = 0; i < FeatureChoice.nChoices (); ++ i) {
+	if (it -> first [i] && ! feature_types_ [i]) {
+	  return false;
+	}
+      }
+    }
+    return true;
+  }
+
+  // Interns all of the features in the given map, and stores their ids.
+  void TemplateList::ids (std::vector <int> & ids, const FeatureMap & fmap) const {
+    ids.resize (FeatureChoice.nChoices (), -1);
+    const FeatureTemplate & mask = fmap.mask ();
+    for (int it = 0; it < FeatureChoice.nChoices (); ++ it) {
+      if (mask [it]) {
+	this -> ids (ids, fmap, static_cast <FeatureName> (it));
+      }
+    }
+  }
+
+  void TemplateList::ids (std::vector <int> & ids, const FeatureMap & fmap, FeatureName templ) const {
+    ids [templ] = id (templ, fmap.getValue (templ));
+  }
+
+  // Interns the given value of the given feature, and returns its id, or -1
+  // if the feature has no type.
+  int TemplateList::id (FeatureName templ, const std::string & value) const {
+    return feature_types_ [templ] ? feature_types_ [templ] -> id (value) : -1;
+  }
+
+  // Adds the key of each template with the given FeatureName/bit pair that the
+  // map fills, in the order of featuresWithTemplate.
+  // @precondition ids must hold the ids of the values in the map.
+  void TemplateList::keysWithTemplate (std::vector <FeatureKey> & f,
+				       const FeatureMap & fmap,
+				       const std::vector <int> & ids,
+				       FeatureName templ,
+				       bool bit) const {
+    for (const_iterator it = map_.begin (), end = map_.end ();
+	 it != end; ++ it) {
+      if (fmap.has (it -> first) && it -> first [templ] == bit) {
+	f.push_back (keyFromIterator (ids, it));
+      }
+    }
+  }
+
+  FeatureKey TemplateList::keyFromIterator (const std::vector <int> & ids,
+					    const_iterator it) const {
+    FeatureKey key = mix (static_cast <unsigned char> (it -> second [0]) + 1);
+    for (int i = 0; i < FeatureChoice.nChoices (); ++ i) {
+      if (it -> first [i]) {
+	key = extend (key, ids [i]);
+      }
+    }
+    return key;
+  }
+
+  // Computes the key of a compressed feature from the template number and
+  // value ids it holds.  Returns false if the template is unknown or the
+  // string is too short for its values.
+  bool TemplateList::key (FeatureKey & key, const std::string & fz) const {
+    if (fz.empty ()) {
+      return false;
+    }
+    const_iterator it = map_.begin ();
+    while (it != map_.end () && it -> second [0] != fz [0]) {
+      ++ it;
+    }
+    if (it == map_.end ()) {
+      return false;
+    }
+    std::vector <int> ids (FeatureChoice.nChoices (), -1);
+    size_t offset = 1;
+    for (int i = 0; i < FeatureChoice.nChoices (); ++ i) {
+      if (it -> first [i]) {
+	const int bytes = feature_types_ [i] -> bytes ();
+	if (offset + bytes > fz.size ()) {
+	  return false;
+	}
+	ids [i] = feature_types_ [i] -> decode (fz.substr (offset, bytes));
+	offset += bytes;
+      }
+    }
+    key = keyFromIterator (ids, it);
+    return true;
+  }
+
   // Computes the number of active features the first template contains that the
   // second does not.  If the second contains active features not in the first,
   // the difference is zero.
@@ -402,13 +672,21 @@ namespace Permute {
   PV::PV () :
     Parent (),
     templates_ (),
-    distances_ ()
+    distances_ (),
+    keys_ (),
+    indexed_ (-1),
+    mapped_ (),
+    hashed_ ()
   {}
 
   PV::PV (const PV & pv) :
     Parent (),
     templates_ (pv.templates_),
-    distances_ (pv.distances_)
+    distances_ (pv.distances_),
+    keys_ (),
+    indexed_ (-1),
+    mapped_ (),
+    hashed_ ()
   {}
 
   // Adds the given type, with the given count, to the inventory.  Creates a new
@@ -458,21 +736,9 @@ namespace Permute {
 		     const Permutation & words,
 		     const Permutation & pos,
 		     size_t i, size_t j) const {
-    Fsa::ConstAlphabetRef WORDS = words.alphabet (), POS = pos.alphabet ();
+    Fsa::ConstAlphabetRef POS = pos.alphabet ();
     FeatureMap fmap;
-    fmap.setValue (lPOSm1, i == 0 ? "<s>" : POS -> symbol (pos.label (pos [i - 1])));
-    fmap.setValue (lPOS, POS -> symbol (pos.label (pos [i])));
-    fmap.setValue (lWord, WORDS -> symbol (words.label (words [i])));
-    fmap.setValue (lPOSp1, POS -> symbol (pos.label (pos [i + 1])));
-    fmap.setValue (rPOSm1, POS -> symbol (pos.label (pos [j - 1])));
-    fmap.setValue (rPOS, POS -> symbol (pos.label (pos [j])));
-    fmap.setValue (rWord, WORDS -> symbol (words.label (words [j])));
-    fmap.setValue (rPOSp1, j + 1 == pos.size () ? "</s>" : POS -> symbol (pos.label (pos [j + 1])));
-    fmap.setValue (Dist, distance (j - i));
-    fmap.setValue (lPrefix, prefix (words.symbol (i)));
-    fmap.setValue (rPrefix, prefix (words.symbol (j)));
-    fmap.setValue (lSuffix, suffix (words.symbol (i)));
-    fmap.setValue (rSuffix, suffix (words.symbol (j)));
+    values (fmap, words, pos, i, j);
     templates_.intern (fmap);
     templates_.featuresWithTemplate (f, fmap, bPOS, 0); 
     for (size_t b = i + 1; b < j; ++ b) {
@@ -489,6 +755,133 @@ namespace Permute {
 		     const Permutation & labels,
 		     size_t i, size_t j) const {
     FeatureMap fmap;
+    values (fmap, words, pos, parents, labels, i, j);
+    templates_.intern (fmap);
+    templates_.featuresWithTemplate (f, fmap, bPOS, 0);
+    for (size_t b = i + 1; b < j; ++ b) {
+      fmap.setValue (bPOS, pos.symbol (b));
+      templates_.intern (fmap, bPOS);
+      templates_.featuresWithTemplate (f, fmap, bPOS, 1);
+    }
+  }
+
+  void PV::keys (std::vector <FeatureKey> & f,
+		 const Permutation & words,
+		 const Permutation & pos,
+		 size_t i, size_t j) const {
+    Fsa::ConstAlphabetRef POS = pos.alphabet ();
+    FeatureMap fmap;
+    std::vector <int> ids;
+    values (fmap, words, pos, i, j);
+    templates_.ids (ids, fmap);
+    templates_.keysWithTemplate (f, fmap, ids, bPOS, 0);
+    for (size_t b = i + 1; b < j; ++ b) {
+      fmap.setValue (bPOS, POS -> symbol (pos.label (pos [b])));
+      templates_.ids (ids, fmap, bPOS);
+      templates_.keysWithTemplate (f, fmap, ids, bPOS, 1);
+    }
+  }
+
+  void PV::keys (std::vector <FeatureKey> & f,
+		 const Permutation & words,
+		 const Permutation & pos,
+		 const std::vector <int> & parents,
+		 const Permutation & labels,
+		 size_t i, size_t j) const {
+    FeatureMap fmap;
+    std::vector <int> ids;
+    values (fmap, words, pos, parents, labels, i, j);
+    templates_.ids (ids, fmap);
+    templates_.keysWithTemplate (f, fmap, ids, bPOS, 0);
+    for (size_t b = i + 1; b < j; ++ b) {
+      fmap.setValue (bPOS, pos.symbol (b));
+      templates_.ids (ids, fmap, bPOS);
+      templates_.keysWithTemplate (f, fmap, ids, bPOS, 1);
+    }
+  }
+
+  // Indexes every feature whose key can be computed.  Features with an
+  // unknown template never fire, so leaving them out loses nothing.
+  bool PV::index () {
+    keys_.clear ();
+    indexed_ = -1;
+    if (! templates_.keyed ()) {
+      return false;
+    }
+    keys_.reserve (size ());
+    for (const_iterator p = begin (); p != end (); ++ p) {
+      FeatureKey key;
+      if (templates_.key (key, p -> first)) {
+	keys_.insert (key, p -> second);
+      }
+    }
+    if (keys_.collisions () > 0) {
+      return false;
+    }
+    indexed_ = size ();
+    return true;
+  }
+
+  bool PV::hash (int bits, bool sign) {
+    if (bits < 1 || bits > HashedWeights::MaxBits || ! templates_.keyed ()) {
+      return false;
+    }
+    hashed_.resize (bits, sign);
+    for (const_iterator p = begin (); p != end (); ++ p) {
+      FeatureKey key;
+      if (templates_.key (key, p -> first)) {
+	hashed_.find (key) += hashed_.sign (key) * double (p -> second);
+      }
+    }
+    clear ();
+    keys_.clear ();
+    indexed_ = -1;
+    return true;
+  }
+
+  void PV::weights (std::vector <WRef> & weights) const {
+    if (hashed ()) {
+      for (size_t n = 0; n < hashed_.size (); ++ n) {
+	weights.push_back (hashed_ [n]);
+      }
+    } else {
+      for (const_iterator p = begin (); p != end (); ++ p) {
+	weights.push_back (p -> second);
+      }
+    }
+  }
+
+  /**********************************************************************
+   * PV private methods
+   **********************************************************************/
+
+  // Sets the values of every feature of the pair (i,j) except bPOS.
+  void PV::values (FeatureMap & fmap,
+		   const Permutation & words,
+		   const Permutation & pos,
+		   size_t i, size_t j) const {
+    Fsa::ConstAlphabetRef WORDS = words.alphabet (), POS = pos.alphabet ();
+    fmap.setValue (lPOSm1, i == 0 ? "<s>" : POS -> symbol (pos.label (pos [i - 1])));
+    fmap.setValue (lPOS, POS -> symbol (pos.label (pos [i])));
+    fmap.setValue (lWord, WORDS -> symbol (words.label (words [i])));
+    fmap.setValue (lPOSp1, POS -> symbol (pos.label (pos [i + 1])));
+    fmap.setValue (rPOSm1, POS -> symbol (pos.label (pos [j - 1])));
+    fmap.setValue (rPOS, POS -> symbol (pos.label (pos [j])));
+    fmap.setValue (rWord, WORDS -> symbol (words.label (words [j])));
+    fmap.setValue (rPOSp1, j + 1 == pos.size () ? "</s>" : POS -> symbol (pos.label (pos [j + 1])));
+    fmap.setValue (Dist, distance (j - i));
+    fmap.setValue (lPrefix, prefix (words.symbol (i)));
+    fmap.setValue (rPrefix, prefix (words.symbol (j)));
+    fmap.setValue (lSuffix, suffix (words.symbol (i)));
+    fmap.setValue (rSuffix, suffix (words.symbol (j)));
+  }
+
+  void PV::values (FeatureMap & fmap,
+		   const Permutation & words,
+		   const Permutation & pos,
+		   const std::vector <int> & parents,
+		   const Permutation & labels,
+		   size_t i, size_t j) const {
     fmap.setValue (lPOSm1, i == 0 ? "<s>" : pos.symbol (i - 1));
     fmap.setValue (lPOS, pos.symbol (i));
     fmap.setValue (lWord, words.symbol (i));
@@ -512,19 +905,8 @@ namespace Permute {
     fmap.setValue (rPrefix, prefix (words.symbol (j)));
     fmap.setValue (lSuffix, suffix (words.symbol (i)));
     fmap.setValue (rSuffix, suffix (words.symbol (j)));
-    templates_.intern (fmap);
-    templates_.featuresWithTemplate (f, fmap, bPOS, 0);
-    for (size_t b = i + 1; b < j; ++ b) {
-      fmap.setValue (bPOS, pos.symbol (b));
-      templates_.intern (fmap, bPOS);
-      templates_.featuresWithTemplate (f, fmap, bPOS, 1);
-    }
   }
 
-  /**********************************************************************
-   * PV private methods
-   **********************************************************************/
-
   // Performs the given comparison on the given pair of values and returns the
   // result of the comparison.
   bool compare (int i, ComparisonOperator op, int j) {
@@ -647,7 +1029,11 @@ namespace Permute {
     }
   }
 
+  // Reads either format.
   bool readFile (PV & pv, const std::string & file) {
+    if (isBinaryPV (file)) {
+      return readBinary (pv, file);
+    }
     PVXmlParser parser (Core::Application::us () -> getConfiguration (), pv);
     return parser.parseFile (file);
   }
@@ -678,6 +1064,7 @@ namespace Permute {
       }
       xout << Core::XmlClose ("parameters")
 	   << "\n";
+      return out;
     }
   }
 
@@ -946,6 +1333,346 @@ namespace Permute {
     AggregatePVXmlParser parser (Core::Application::us () -> getConfiguration (), pv);
     return parser.parseFile (file);
   }
+
+  /**********************************************************************
+   * The binary PV format
+   **********************************************************************/
+
+  namespace {
+    const char PV_MAGIC [8] = { 'P', 'V', 'b', 'i', 'n', 'a', 'r', 'y' };
+    const unsigned PV_ORDER = 0x01020304;
+
+    struct BinaryPVHeader {
+      char magic [8];
+      // PV_ORDER in the byte order of the machine that wrote the file.
+      unsigned order;
+      unsigned metadata_size;
+      // The bits of a hashed PV, or zero, and whether its hashing is signed.
+      unsigned hash_bits;
+      unsigned hash_signed;
+      // The number of features, or of hashed weights.
+      u64 size;
+      // The positions of the keys, weights, string offsets and strings from
+      // the start of the file.
+      u64 keys;
+      u64 weights;
+      u64 offsets;
+      u64 strings;
+    };
+
+    u64 align (u64 offset) {
+      return (offset + sizeof (u64) - 1) / sizeof (u64) * sizeof (u64);
+    }
+
+    void putInt (std::ostream & out, unsigned x) {
+      out.write (reinterpret_cast <const char *> (& x), sizeof (x));
+    }
+
+    void putString (std::ostream & out, const std::string & s) {
+      putInt (out, s.size ());
+      out.write (s.data (), s.size ());
+    }
+
+    // Reads back what putInt and putString write, and fails rather than read
+    // past the end of the metadata.
+    class MetadataReader {
+    private:
+      const char * p_;
+      const char * end_;
+      bool ok_;
+    public:
+      MetadataReader (const char * begin, const char * end) :
+	p_ (begin),
+	end_ (end),
+	ok_ (true)
+      {}
+      unsigned getInt () {
+	unsigned x = 0;
+	if (end_ - p_ < sizeof (x)) {
+	  ok_ = false;
+	} else {
+	  std::memcpy (& x, p_, sizeof (x));
+	  p_ += sizeof (x);
+	}
+	return x;
+      }
+      std::string getString () {
+	unsigned size = getInt ();
+	if (! ok_ || end_ - p_ < size) {
+	  ok_ = false;
+	  return std::string ();
+	}
+	std::string s (p_, size);
+	p_ += size;
+	return s;
+      }
+      bool ok () const { return ok_; }
+    };
+
+    // Walks the metadata in the order that readBinary restores it, so that
+    // readBinary can reject a corrupt file before it changes the PV.
+    bool checkMetadata (MetadataReader metadata) {
+      for (unsigned t = metadata.getInt (); t > 0 && metadata.ok (); -- t) {
+	metadata.getString ();
+	metadata.getInt ();
+	for (unsigned v = metadata.getInt (); v > 0 && metadata.ok (); -- v) {
+	  metadata.getString ();
+	}
+      }
+      for (unsigned f = metadata.getInt (); f > 0 && metadata.ok (); -- f) {
+	metadata.getString ();
+	metadata.getString ();
+      }
+      for (unsigned t = metadata.getInt (); t > 0 && metadata.ok (); -- t) {
+	metadata.getInt ();
+	metadata.getString ();
+      }
+      for (unsigned d = metadata.getInt (); d > 0 && metadata.ok (); -- d) {
+	metadata.getInt ();
+	metadata.getInt ();
+      }
+      return metadata.ok ();
+    }
+
+    class KeyedFeature {
+    public:
+      FeatureKey key;
+      const std::string * feature;
+      double weight;
+      bool operator < (const KeyedFeature & f) const { return key < f.key; }
+    };
+  }
+
+  bool isBinaryPV (const std::string & file) {
+    std::ifstream in (file.c_str (), std::ios::binary);
+    char magic [sizeof (PV_MAGIC)];
+    return in.read (magic, sizeof (magic))
+      && std::memcmp (magic, PV_MAGIC, sizeof (magic)) == 0;
+  }
+
+  bool readBinary (PV & pv, const std::string & file, bool map) {
+    if (! pv.empty () || pv.templates_.begin () != pv.templates_.end ()) {
+      std::cerr << "Binary PV files must be read into an empty PV: " << file << std::endl;
+      return false;
+    }
+    int fd = ::open (file.c_str (), O_RDONLY);
+    if (fd < 0) {
+      std::cerr << "Could not open binary PV file: " << file << std::endl;
+      return false;
+    }
+    struct stat status;
+    if (::fstat (fd, & status) != 0 || status.st_size < 0 ||
+	static_cast <size_t> (status.st_size) < sizeof (BinaryPVHeader)) {
+      std::cerr << "Truncated binary PV file: " << file << std::endl;
+      ::close (fd);
+      return false;
+    }
+    size_t length = status.st_size;
+    void * mapping = ::mmap (0, length, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping holds its own reference to the file.
+    ::close (fd);
+    if (mapping == MAP_FAILED) {
+      std::cerr << "Could not map binary PV file: " << file << std::endl;
+      return false;
+    }
+    const char * bytes = static_cast <const char *> (mapping);
+    const BinaryPVHeader & header = * reinterpret_cast <const BinaryPVHeader *> (bytes);
+    const u64 n = header.size;
+    // A hashed PV has no keys or strings.
+    const u64 keyed = header.hash_bits ? 0 : n;
+    if (std::memcmp (header.magic, PV_MAGIC, sizeof (PV_MAGIC)) != 0 ||
+	header.order != PV_ORDER ||
+	header.hash_bits > HashedWeights::MaxBits ||
+	(header.hash_bits && n != u64 (1) << header.hash_bits) ||
+	n > length / sizeof (double) ||
+	header.keys != align (sizeof (BinaryPVHeader) + header.metadata_size) ||
+	header.weights != header.keys + keyed * sizeof (FeatureKey) ||
+	header.offsets != header.weights + n * sizeof (double) ||
+	header.strings != header.offsets + (keyed + 1) * sizeof (u64) ||
+	header.strings > length ||
+	reinterpret_cast <const u64 *> (bytes + header.offsets) [keyed] > length - header.strings) {
+      std::cerr << "Invalid binary PV file: " << file << std::endl;
+      ::munmap (mapping, length);
+      return false;
+    }
+    MetadataReader metadata (bytes + sizeof (BinaryPVHeader),
+			     bytes + sizeof (BinaryPVHeader) + header.metadata_size);
+    if (! checkMetadata (metadata)) {
+      std::cerr << "Invalid binary PV metadata: " << file << std::endl;
+      ::munmap (mapping, length);
+      return false;
+    }
+    MappedPVRef mapped (new MappedPV (mapping, length, keyed,
+				      reinterpret_cast <const FeatureKey *> (bytes + header.keys),
+				      reinterpret_cast <const double *> (bytes + header.weights),
+				      reinterpret_cast <const u64 *> (bytes + header.offsets),
+				      bytes + header.strings));
+
+    // Restores the types with their values in the order of their ids, and
+    // the templates with the numbers that their features begin with.
+    TemplateList & tl = pv.templates_;
+    for (unsigned t = metadata.getInt (); t > 0 && metadata.ok (); -- t) {
+      const std::string name = metadata.getString ();
+      const int count = metadata.getInt ();
+      pv.addType (name, count);
+      FeatureType * type = tl.types_ [name];
+      for (unsigned v = metadata.getInt (); v > 0 && metadata.ok (); -- v) {
+	type -> intern (metadata.getString ());
+      }
+    }
+    for (unsigned f = metadata.getInt (); f > 0 && metadata.ok (); -- f) {
+      const std::string feature = metadata.getString ();
+      const std::string type = metadata.getString ();
+      pv.addFeatureType (feature, type);
+    }
+    for (unsigned t = metadata.getInt (); t > 0 && metadata.ok (); -- t) {
+      const int number = metadata.getInt ();
+      tl.map_ [tl.getTemplate (metadata.getString ())] = std::string (1, char (number));
+      tl.count_ = std::max (tl.count_, number + 1);
+    }
+    for (unsigned d = metadata.getInt (); d > 0 && metadata.ok (); -- d) {
+      const ComparisonOperator comparison = ComparisonOperator (metadata.getInt ());
+      pv.addDistance (comparison, int (metadata.getInt ()));
+    }
+
+    if (header.hash_bits) {
+      pv.hashed_.resize (header.hash_bits, header.hash_signed);
+      const double * weights = reinterpret_cast <const double *> (bytes + header.weights);
+      for (size_t b = 0; b < n; ++ b) {
+	pv.hashed_ [b] = weights [b];
+      }
+    } else if (map) {
+      pv.mapped_ = mapped;
+    } else {
+      for (size_t f = 0; f < n; ++ f) {
+	pv [mapped -> feature (f)] = mapped -> weight (f);
+      }
+    }
+    return true;
+  }
+
+  // Writes the features of the hash table, not those of a mapping.  Skips
+  // the empty feature, under which the XML parser gathers the features of
+  // unknown templates.
+  bool writeBinary (const PV & pv, std::ostream & out) {
+    const TemplateList & tl = pv.templates_;
+    if (! out) {
+      return false;
+    } else if (! tl.keyed ()) {
+      std::cerr << "Some feature template lacks a type" << std::endl;
+      return false;
+    }
+    std::vector <KeyedFeature> features;
+    features.reserve (pv.size ());
+    for (PV::const_iterator p = pv.hashed () ? pv.end () : pv.begin (); p != pv.end (); ++ p) {
+      if (p -> first.empty ()) {
+	continue;
+      }
+      KeyedFeature f;
+      if (! tl.key (f.key, p -> first)) {
+	std::cerr << "Could not compute the key of " << tl.uncompress (p -> first) << std::endl;
+	return false;
+      }
+      f.feature = & p -> first;
+      f.weight = p -> second;
+      features.push_back (f);
+    }
+    std::sort (features.begin (), features.end ());
+    for (size_t f = 1; f < features.size (); ++ f) {
+      if (features [f - 1].key == features [f].key) {
+	std::cerr << "Feature keys collide: " << tl.uncompress (* features [f - 1].feature)
+		  << " and " << tl.uncompress (* features [f].feature) << std::endl;
+	return false;
+      }
+    }
+
+    std::ostringstream metadata;
+    int types = 0;
+    for (TemplateList::TypeMap::const_iterator it = tl.types_.begin (); it != tl.types_.end (); ++ it) {
+      types += it -> second != 0;
+    }
+    putInt (metadata, types);
+    for (TemplateList::TypeMap::const_iterator it = tl.types_.begin (); it != tl.types_.end (); ++ it) {
+      if (it -> second) {
+	std::vector <std::string> values;
+	it -> second -> values (values);
+	putString (metadata, it -> first);
+	putInt (metadata, it -> second -> count ());
+	putInt (metadata, values.size ());
+	for (std::vector <std::string>::const_iterator v = values.begin (); v != values.end (); ++ v) {
+	  putString (metadata, * v);
+	}
+      }
+    }
+    int featureTypes = 0;
+    for (int i = 0; i < FeatureChoice.nChoices (); ++ i) {
+      featureTypes += tl.feature_types_ [i] != 0;
+    }
+    putInt (metadata, featureTypes);
+    for (int i = 0; i < FeatureChoice.nChoices (); ++ i) {
+      if (tl.feature_types_ [i]) {
+	putString (metadata, FeatureChoice [FeatureName (i)]);
+	putString (metadata, tl.feature_types_ [i] -> name ());
+      }
+    }
+    putInt (metadata, tl.map_.size ());
+    for (TemplateList::const_iterator it = tl.begin (); it != tl.end (); ++ it) {
+      std::string names;
+      for (int i = 0; i < FeatureChoice.nChoices (); ++ i) {
+	if (it -> first [i]) {
+	  names += (names.empty () ? "" : " ") + std::string (FeatureChoice [FeatureName (i)]);
+	}
+      }
+      putInt (metadata, static_cast <unsigned char> (it -> second [0]));
+      putString (metadata, names);
+    }
+    putInt (metadata, pv.distances_.size ());
+    for (PV::DistanceVector::const_iterator d = pv.distances_.begin (); d != pv.distances_.end (); ++ d) {
+      putInt (metadata, d -> first);
+      putInt (metadata, d -> second);
+    }
+
+    const u64 n = features.size ();
+    const HashedWeights & hashed = pv.hashed_;
+    BinaryPVHeader header;
+    std::memcpy (header.magic, PV_MAGIC, sizeof (PV_MAGIC));
+    header.order = PV_ORDER;
+    header.metadata_size = metadata.str ().size ();
+    header.hash_bits = pv.hashed () ? hashed.bits () : 0;
+    header.hash_signed = hashed.isSigned ();
+    header.size = pv.hashed () ? hashed.size () : n;
+    header.keys = align (sizeof (BinaryPVHeader) + header.metadata_size);
+    header.weights = header.keys + n * sizeof (FeatureKey);
+    header.offsets = header.weights + (pv.hashed () ? hashed.size () : n) * sizeof (double);
+    header.strings = header.offsets + (n + 1) * sizeof (u64);
+    out.write (reinterpret_cast <const char *> (& header), sizeof (header));
+    out.write (metadata.str ().data (), header.metadata_size);
+    const char zeros [sizeof (u64)] = { 0 };
+    out.write (zeros, header.keys - sizeof (header) - header.metadata_size);
+
+    std::vector <FeatureKey> keys (n);
+    std::vector <double> weights (n);
+    std::vector <u64> offsets (n + 1, 0);
+    for (size_t f = 0; f < n; ++ f) {
+      keys [f] = features [f].key;
+      weights [f] = features [f].weight;
+      offsets [f + 1] = offsets [f] + features [f].feature -> size ();
+    }
+    if (pv.hashed ()) {
+      weights.assign (hashed.data (), hashed.data () + hashed.size ());
+    }
+    if (n > 0) {
+      out.write (reinterpret_cast <const char *> (& keys [0]), n * sizeof (FeatureKey));
+    }
+    if (! weights.empty ()) {
+      out.write (reinterpret_cast <const char *> (& weights [0]), weights.size () * sizeof (double));
+    }
+    out.write (reinterpret_cast <const char *> (& offsets [0]), (n + 1) * sizeof (u64));
+    for (size_t f = 0; f < n; ++ f) {
+      out.write (features [f].feature -> data (), features [f].feature -> size ());
+    }
+    return out;
+  }
   
   /**********************************************************************
    * W public methods
@@ -982,68 +1709,106 @@ namespace Permute {
    **********************************************************************/
 
   WRef::WRef (double w) :
-    Parent (new W (w))
+    Parent (new W (w)),
+    slot_ (0)
   {}
 
+  WRef WRef::slot (double * slot) {
+    return WRef (Parent (), slot);
+  }
+
   const WRef & WRef::operator = (double w) const {
-    Parent::operator * () = w;
+    if (slot_) {
+      * slot_ = w;
+    } else {
+      Parent::operator * () = w;
+    }
     return * this;
   }
 
   const WRef & WRef::operator += (double w) const {
-    Parent::operator * () += w;
+    if (slot_) {
+      * slot_ += w;
+    } else {
+      Parent::operator * () += w;
+    }
     return * this;
   }
 
   const WRef & WRef::operator /= (double w) const {
-    Parent::operator * () /= w;
+    if (slot_) {
+      * slot_ /= w;
+    } else {
+      Parent::operator * () /= w;
+    }
     return * this;
   }
 
   WRef::operator double () const {
-    return Parent::operator * ();
+    return slot_ ? * slot_ : double (Parent::operator * ());
+  }
+
+  const void * WRef::address () const {
+    return slot_ ? static_cast <const void *> (slot_) : static_cast <const void *> (get ());
   }
 
   /**********************************************************************
-   * Sum public methods
+   * WRef private methods
    **********************************************************************/
 
-  Sum::Sum () :
-    v_ (),
-    sum_ (0.0)
+  WRef::WRef (const Parent & w, double * slot) :
+    Parent (w),
+    slot_ (slot)
   {}
 
-  Sum::Sum (const Sum & s) :
-    v_ (s.v_),
-    sum_ (s.sum_)
-  {}
+  /**********************************************************************
+   * Sum public methods
+   **********************************************************************/
 
   Sum & Sum::operator += (const WRef & w) {
-    v_.push_back (w);
-    sum_ += (* w);
+    matrix_ -> append (cell_, w, false);
+    return * this;
+  }
+
+  Sum & Sum::operator -= (const WRef & w) {
+    matrix_ -> append (cell_, w, true);
+    return * this;
+  }
+
+  int Sum::sign (const_iterator w) const {
+    const std::vector <bool> & negated = matrix_ -> negated_;
+    return negated.empty () || ! negated [w - matrix_ -> weights_.begin ()] ? 1 : -1;
+  }
+
+  Sum & Sum::operator += (double w) {
+    matrix_ -> sums_ [cell_] += w;
+    return * this;
   }
 
   Sum::operator double () const {
-    return sum_;
+    return matrix_ -> sums_ [cell_];
   }
 
-  // @bug Why use the W operator += instead of the WRef operator +=?
   void Sum::add (double update) {
-    for (std::vector <WRef>::iterator w = v_.begin (); w != v_.end (); ++ w) {
-      (* * w) += update;
-      sum_ += update;
-    }
+    matrix_ -> add (cell_, update);
+  }
+
+  Sum::const_iterator Sum::begin () const {
+    return matrix_ -> weights_.begin () + matrix_ -> begin (cell_);
+  }
+
+  Sum::const_iterator Sum::end () const {
+    return matrix_ -> weights_.begin () + matrix_ -> end (cell_);
   }
 
   /**********************************************************************
    * Sum private methods
    **********************************************************************/
 
-  Sum & Sum::operator = (const Sum & s) {
-    v_ = s.v_;
-    sum_ = s.sum_;
-    return * this;
-  }
+  Sum::Sum (SumBeforeCost * matrix, size_t cell) :
+    matrix_ (matrix),
+    cell_ (cell)
+  {}
 
   /**********************************************************************
    * SumBeforeCost public methods
@@ -1051,7 +1816,11 @@ namespace Permute {
 
   SumBeforeCost::SumBeforeCost (size_t n, const std::string & name) :
     BeforeCostInterface (n),
-    matrix_ (n * n),
+    weights_ (),
+    negated_ (),
+    end_ (n * n, 0),
+    sums_ (n * n, 0.0),
+    last_ (0),
     name_ (name)
   {}
 
@@ -1060,15 +1829,85 @@ namespace Permute {
   }
   
   double SumBeforeCost::cost (int i, int j) const {
-    return double (matrix_ [index (i, j)]);
+    return sums_ [index (i, j)];
   }
 
   const std::string & SumBeforeCost::name () const {
     return name_;
   }
   
-  Sum & SumBeforeCost::operator () (int i, int j) {
-    return matrix_ [index (i, j)];
+  Sum SumBeforeCost::operator () (int i, int j) {
+    return Sum (this, index (i, j));
+  }
+
+  void SumBeforeCost::add (const Permutation & pi, double update) {
+    const int n = size ();
+    std::vector <int> rank (n);
+    int r = 0;
+    for (Permutation::const_iterator i = pi.begin (); i != pi.end (); ++ i) {
+      rank [* i] = r ++;
+    }
+    for (int i = 0; i + 1 < n; ++ i) {
+      for (int j = i + 1; j < n; ++ j) {
+	if (rank [i] < rank [j]) {
+	  add (index (i, j), update);
+	}
+      }
+    }
+  }
+
+  void SumBeforeCost::reserve (size_t weights) {
+    weights_.reserve (weights);
+  }
+
+  /**********************************************************************
+   * SumBeforeCost private methods
+   **********************************************************************/
+
+  size_t SumBeforeCost::begin (size_t cell) const {
+    if (cell > last_) {
+      return weights_.size ();
+    }
+    return cell == 0 ? 0 : end_ [cell - 1];
+  }
+
+  size_t SumBeforeCost::end (size_t cell) const {
+    return cell > last_ ? weights_.size () : end_ [cell];
+  }
+
+  // Appends the weight to the array if no later cell has any, and otherwise
+  // inserts it at the end of its cell and shifts the later cells.
+  void SumBeforeCost::append (size_t cell, const WRef & w, bool negated) {
+    const size_t at = cell >= last_ ? weights_.size () : end_ [cell];
+    if (negated || ! negated_.empty ()) {
+      if (negated_.empty ()) {
+	negated_.assign (weights_.size (), false);
+      }
+      negated_.insert (negated_.begin () + at, negated);
+    }
+    if (cell >= last_) {
+      weights_.push_back (w);
+      for (size_t c = last_ + 1; c < cell; ++ c) {
+	end_ [c] = at;
+      }
+      last_ = cell;
+      end_ [cell] = weights_.size ();
+    } else {
+      weights_.insert (weights_.begin () + at, w);
+      for (size_t c = cell; c <= last_; ++ c) {
+	++ end_ [c];
+      }
+    }
+    sums_ [cell] += negated ? - double (w) : double (w);
+  }
+
+  // @bug Why use the W operator += instead of the WRef operator +=?
+  void SumBeforeCost::add (size_t cell, double update) {
+    const size_t last = end (cell);
+    for (size_t w = begin (cell); w < last; ++ w) {
+      weights_ [w] += (negated_.empty () || ! negated_ [w] ? update : - update);
+      sums_ [cell] += update;
+    }
   }
   
 }
@@ -5,6 +5,7 @@
 
 #include <Core/Choice.hh>
 #include <Core/Hash.hh>
+#include <Core/Types.hh>
 
 #include "BeforeScorer.hh"
 #include "Permutation.hh"
@@ -66,15 +67,25 @@ namespace Permute {
 
   // WRef is a reference to a W.  It specializes the reference counting
   // interface to include the setter, accumulator, and getter methods of W.
+  // A WRef may instead refer to a slot of an array of weights that it does
+  // not own, such as HashedWeights, so that the array needs no W per slot.
+  // Compare WRefs by address, which identifies the weight either way.
   class WRef : public Core::Ref <W> {
   private:
     typedef Core::Ref <W> Parent;
+    double * slot_;
+    WRef (const Parent &, double *);
   public:
     explicit WRef (double = 0.0);
+    // Refers to the given slot, which must outlive the WRef.
+    static WRef slot (double *);
     const WRef & operator = (double) const;
     const WRef & operator += (double) const;
     const WRef & operator /= (double) const;
     operator double () const;
+    const void * address () const;
+    bool operator == (const WRef & w) const { return address () == w.address (); }
+    bool operator != (const WRef & w) const { return address () != w.address (); }
   };
 
   /**********************************************************************/
@@ -98,6 +109,12 @@ namespace Permute {
     int bytes () const { return bytes_; }
     const std::string & intern (const std::string &);
     const std::string & unintern (const std::string &);
+    // Returns the integer that the compressed string of the given value
+    // encodes, interning it first if necessary.
+    int id (const std::string &);
+    int decode (const std::string &) const;
+    // Lists the values interned so far in the order of their ids.
+    void values (std::vector <std::string> &) const;
   };
 
   /**********************************************************************/
@@ -157,6 +174,106 @@ namespace Permute {
 
   /**********************************************************************/
 
+  // A FeatureKey is a 64-bit hash of a template number and the interned ids
+  // of the values that fill it.  It identifies a feature without building
+  // its string, at the risk of a collision between two features, which
+  // KeyTable detects among the features it holds.
+  typedef u64 FeatureKey;
+
+  // KeyTable maps FeatureKeys to weights by open addressing with linear
+  // probing, in a power-of-two table kept at most half full.  The weights are
+  // shared with the PV they came from, so that updates through either are
+  // seen by both.  Inserting a key already present with a different weight
+  // is a collision: insert counts it and keeps the first weight.
+  class KeyTable {
+  private:
+    std::vector <FeatureKey> keys_;
+    // The index in weights_ of the entry in each slot, or -1 if empty.
+    std::vector <int> slots_;
+    std::vector <WRef> weights_;
+    int collisions_;
+  public:
+    KeyTable ();
+    void clear ();
+    void reserve (size_t);
+    bool insert (FeatureKey, const WRef &);
+    const WRef * find (FeatureKey) const;
+    size_t size () const { return weights_.size (); }
+    int collisions () const { return collisions_; }
+  private:
+    size_t probe (FeatureKey) const;
+  };
+
+  /**********************************************************************/
+
+  // MappedPV serves the weights of a binary PV file straight from a read-only
+  // mapping of it.  The keys are sorted, so find is a binary search that
+  // touches O(log n) pages, and the features are neither parsed nor copied.
+  // The compressed feature strings are kept only for conversion back to XML.
+  // The mapping is shared with every other process that maps the same file.
+  class MappedPV : public Core::ReferenceCounted {
+  private:
+    void * map_;
+    size_t length_;
+    size_t size_;
+    const FeatureKey * keys_;
+    const double * weights_;
+    const u64 * offsets_;
+    const char * strings_;
+  public:
+    MappedPV (void * map, size_t length, size_t size,
+	      const FeatureKey * keys, const double * weights,
+	      const u64 * offsets, const char * strings);
+    ~MappedPV ();
+    const double * find (FeatureKey) const;
+    size_t size () const { return size_; }
+    // The compressed string and the weight of the nth feature in key order.
+    std::string feature (size_t n) const;
+    double weight (size_t n) const { return weights_ [n]; }
+  private:
+    MappedPV (const MappedPV &);
+    MappedPV & operator = (const MappedPV &);
+  };
+
+  typedef Core::Ref <const MappedPV> MappedPVRef;
+
+  /**********************************************************************/
+
+  // HashedWeights maps every FeatureKey into a fixed array of 2^bits weights
+  // by its low bits, storing no keys, so that any feature has a weight
+  // without first being collected, and the model takes a fixed amount of
+  // memory.  Features that share a bucket share its weight.  With signed
+  // hashing, the top bit of the key also decides whether a feature adds or
+  // subtracts the weight of its bucket, so that collisions cancel in
+  // expectation rather than bias the weight (Weinberger et al., 2009).
+  //
+  // The weights are one array of doubles, which hands out WRefs to its slots;
+  // like the weights of a const PV, they may change through those WRefs.
+  class HashedWeights {
+  private:
+    mutable std::vector <double> weights_;
+    FeatureKey mask_;
+    bool signed_;
+  public:
+    // The most bits of any table: 2^32 weights take 32GB.
+    enum { MaxBits = 32 };
+    HashedWeights ();
+    // Replaces the weights with 2^bits zero weights.
+    void resize (int bits, bool sign);
+    int bits () const;
+    bool isSigned () const { return signed_; }
+    size_t size () const { return weights_.size (); }
+    const double * data () const { return weights_.empty () ? 0 : & weights_ [0]; }
+    WRef operator [] (size_t n) const { return WRef::slot (& weights_ [n]); }
+    WRef find (FeatureKey key) const { return operator [] (key & mask_); }
+    // Returns 1 if the feature adds its weight, or -1 if it subtracts it.
+    int sign (FeatureKey key) const { return signed_ && (key >> 63) ? -1 : 1; }
+  };
+
+  /**********************************************************************/
+
+  class PV;
+
   // A list of templates encoded as integers and mapped to single-character
   // strings.  Currently breaks if there are more than 256 feature templates.
   class TemplateList {
@@ -197,11 +314,31 @@ namespace Permute {
     std::string featureFromIterator (const FeatureMap & fmap,
 				     const_iterator it) const;
 
+    // The integer counterparts of intern and featuresWithTemplate: ids
+    // receives the value id of each feature in the map, and keysWithTemplate
+    // adds the key of each matching template instantiation to the vector.
+    // Keys require a type for every feature of every template; keyed checks
+    // that they have one.
+    bool keyed () const;
+    int id (FeatureName templ, const std::string & value) const;
+    void ids (std::vector <int> & ids, const FeatureMap & fmap) const;
+    void ids (std::vector <int> & ids, const FeatureMap & fmap, FeatureName templ) const;
+    void keysWithTemplate (std::vector <FeatureKey> & f,
+			   const FeatureMap & fmap,
+			   const std::vector <int> & ids,
+			   FeatureName templ,
+			   bool bit) const;
+    FeatureKey keyFromIterator (const std::vector <int> & ids,
+				const_iterator it) const;
+    bool key (FeatureKey & key, const std::string & fz) const;
+
     std::vector <FeatureTemplate> generalize (const FeatureTemplate & ft) const;
   private:
     FeatureTemplate getTemplate (const std::string &) const;
 
     friend bool writeXml (const TemplateList &, Core::XmlWriter &);
+    friend bool writeBinary (const PV &, std::ostream &);
+    friend bool readBinary (PV &, const std::string &, bool);
   };
 
   /**********************************************************************/
@@ -227,7 +364,17 @@ namespace Permute {
   // compute feature strings given indices into a permutation.
   //
   // The features method populates a vector of strings with the list of features
-  // that fire for a given pair (i,j) of positions in a given permutation.
+  // that fire for a given pair (i,j) of positions in a given permutation.  The
+  // keys method lists the FeatureKeys of the same features in the same order,
+  // without building their strings, for lookup in the KeyTable that index
+  // builds.  The index holds the features present when it was built, so it
+  // must be rebuilt after features are added or removed.
+  //
+  // A PV read from a binary file by readBinary with map set holds no features
+  // of its own: it looks up the keys of its features in a MappedPV instead.
+  // Such a PV is read-only, for decoding through FeaturePlan.  Likewise, a
+  // hashed PV keeps its weights in HashedWeights rather than the hash table,
+  // and scores every feature.
   class PV : public __gnu_cxx::hash_map <std::string, WRef, StringHash, Core::StringEquality> {
   private:
     typedef __gnu_cxx::hash_map <std::string, WRef, StringHash, Core::StringEquality> Parent;
@@ -235,6 +382,11 @@ namespace Permute {
 
     TemplateList templates_;
     DistanceVector distances_;
+    KeyTable keys_;
+    // The number of features when index last succeeded, or -1.
+    long indexed_;
+    MappedPVRef mapped_;
+    HashedWeights hashed_;
 
   public:
     PV ();
@@ -257,7 +409,32 @@ namespace Permute {
 		   const std::vector <int> & parents,
 		   const Permutation & labels,
 		   size_t i, size_t j) const;
-    
+
+    void keys (std::vector <FeatureKey> &, const Permutation & words, const Permutation & pos, size_t, size_t) const;
+    void keys (std::vector <FeatureKey> &,
+	       const Permutation & words,
+	       const Permutation & pos,
+	       const std::vector <int> & parents,
+	       const Permutation & labels,
+	       size_t i, size_t j) const;
+    // Builds the KeyTable of the current features.  Returns false, leaving
+    // the PV unindexed, if some template lacks a type or two features
+    // collide.
+    bool index ();
+    bool indexed () const { return indexed_ == long (size ()); }
+    const KeyTable & table () const { return keys_; }
+    bool mapped () const { return mapped_.get () != 0; }
+    const MappedPV & mapping () const { return * mapped_; }
+    // Switches to 2^bits hashed weights, folding in the weights of the
+    // features already held, which leave the hash table.  Returns false if bits
+    // is not in [1, HashedWeights::MaxBits] or some template lacks a type.
+    bool hash (int bits, bool sign);
+    bool hashed () const { return hashed_.size () > 0; }
+    const HashedWeights & hashing () const { return hashed_; }
+    // Appends every weight that training may update: the hashed weights if
+    // any, and otherwise the weights of the hash table.
+    void weights (std::vector <WRef> &) const;
+
     std::string distance (int) const;
 
     static const int PREFIX_SIZE;
@@ -266,34 +443,75 @@ namespace Permute {
     static std::string suffix (const std::string &);
 
     friend bool writeXml (const PV &, std::ostream &);
+    friend bool writeBinary (const PV &, std::ostream &);
+    friend bool readBinary (PV &, const std::string &, bool);
+  private:
+    void values (FeatureMap &, const Permutation & words, const Permutation & pos, size_t, size_t) const;
+    void values (FeatureMap &,
+		 const Permutation & words,
+		 const Permutation & pos,
+		 const std::vector <int> & parents,
+		 const Permutation & labels,
+		 size_t i, size_t j) const;
   };
 
   bool readXml (PV &, std::istream &);
   bool readFile (PV &, const std::string &);
   bool aggregateFile (PV &, const std::string &);
 
+  // The binary PV format holds the same types, templates, distances and
+  // features as the XML format, laid out so that the features can be looked
+  // up in place: a BinaryPVHeader, the metadata, zero padding to a multiple of
+  // eight bytes, the sorted FeatureKeys, their weights as native doubles, and
+  // the offsets and bytes of their compressed strings.  The metadata lists
+  // the values of each type in the order of their ids, so that a PV read from
+  // the file builds the same keys as the one that wrote it.
+  //
+  // readBinary reads such a file into an empty PV, either copying the
+  // features into its hash table or, if map is set, mapping them.
+  // writeBinary fails if the features cannot all be keyed without collision.
+  //
+  // A hashed PV is written with its hashed weights in place of the keys,
+  // weights and strings, and is always read into memory.
+  bool isBinaryPV (const std::string & file);
+  bool readBinary (PV &, const std::string & file, bool map = false);
+  bool writeBinary (const PV &, std::ostream &);
+
   /**********************************************************************/
 
-  // Serves as the sum of a list of weights.  The accumulator (operator +=) adds
-  // an additional weight to the sum.  The getter method (operator double)
-  // computes the value of the sum.  The add method accumulates the given value
-  // onto each of the weights in the sum.
+  class SumBeforeCost;
+
+  // Serves as the sum of a list of weights, held in one cell of a
+  // SumBeforeCost.  The accumulator (operator +=) adds an additional weight to
+  // the sum.  The getter method (operator double) computes the value of the
+  // sum.  The add method accumulates the given value onto each of the weights
+  // in the sum.  A Sum refers to its cell rather than copying it, so it is
+  // cheap to return by value, and is valid as long as its SumBeforeCost.
   //
-  // Invariant: sum_ always contains the sum of the weights in v_.  Thus, sum_
-  // is initialized to zero, operator += accumulates into sum, and add
-  // accumulates into sum once for each weight in v_.
+  // Invariant: the cached sum of the cell always contains the sum of its
+  // weights, negated where subtracted, plus any constant weights added as
+  // doubles, which add leaves alone.  Thus, the sum is initialized to zero,
+  // operator += accumulates into sum, and add accumulates into sum once for
+  // each weight in the cell.
   class Sum {
   private:
-    std::vector <WRef> v_;
-    double sum_;
+    SumBeforeCost * matrix_;
+    size_t cell_;
+    Sum (SumBeforeCost *, size_t);
+    friend class SumBeforeCost;
   public:
-    Sum ();
-    Sum (const Sum &);
+    typedef std::vector <WRef>::const_iterator const_iterator;
     Sum & operator += (const WRef &);
+    Sum & operator += (double);
+    // Subtracts a weight, for signed hashing.  add subtracts updates from it
+    // in turn, so that the sum still grows by the update.
+    Sum & operator -= (const WRef &);
     operator double () const;
     void add (double);
-    std::vector <WRef>::const_iterator begin () const { return v_.begin (); }
-    std::vector <WRef>::const_iterator end () const { return v_.end (); }
+    const_iterator begin () const;
+    const_iterator end () const;
+    // Returns -1 if the given weight was subtracted, and otherwise 1.
+    int sign (const_iterator) const;
   private:
     Sum & operator = (const Sum &);
   };
@@ -304,16 +522,40 @@ namespace Permute {
   // rather than a single value.  Allows learning algorithms to propagate
   // updates to matrix positions back to the features from which the matrix was
   // computed.
+  //
+  // The weights of all the cells share one array, in compressed sparse row
+  // order: cell c holds weights_ [end_ [c - 1], end_ [c]), and each cell caches
+  // its sum in sums_.  Cells filled in order of index, as both ways of
+  // filling a matrix from a PV do, append to the array; a weight added to an
+  // earlier cell is inserted, which is correct but slow.
   class SumBeforeCost : public BeforeCostInterface {
   private:
-    Fsa::Vector <Sum> matrix_;
+    std::vector <WRef> weights_;
+    // Whether each weight in weights_ was subtracted, or empty if none was.
+    std::vector <bool> negated_;
+    // The end of each cell in weights_.  Valid through last_; the cells after
+    // it are empty.
+    std::vector <size_t> end_;
+    std::vector <double> sums_;
+    size_t last_;
     std::string name_;
+    friend class Sum;
+    size_t begin (size_t cell) const;
+    size_t end (size_t cell) const;
+    void append (size_t cell, const WRef &, bool negated);
+    void add (size_t cell, double);
   public:
     SumBeforeCost (size_t, const std::string & name);
     ~ SumBeforeCost ();
     virtual double cost (int, int) const;
     virtual const std::string & name () const;
-    Sum & operator () (int, int);
+    Sum operator () (int, int);
+    // Adds the given value to the weights of each cell (i,j), i < j, for
+    // which i precedes j in the given permutation.  Visits the cells in
+    // order, rather than in the order of the permutation.
+    void add (const Permutation &, double);
+    // Makes room for the given number of weights across all the cells.
+    void reserve (size_t);
   };
 
   typedef Core::Ref <SumBeforeCost> SumBeforeCostRef;
@@ -1,5 +1,6 @@
 #include "ParseController.hh"
 #include "BeforeScorer.hh"
+#include "ParsePolicy.hh"
 
 namespace Permute {
 
@@ -11,17 +12,11 @@ namespace Permute {
   // compatible with both the cubic neighborhood and the quadratic
   // neighborhood.
   double ParseController::grammar (const BeforeScorer & b, int i, int j, int k) const {
-    if (i < k) {
-      return b.score (i, j, k - 1)
-	+ b.score (i + 1, j, k)
-	- b.score (i + 1, j, k - 1)
-	+ b.cost (i, k - 1);
-    } else {
-      return b.score (i - 1, j, k)
-	+ b.score (i, j, k + 1)
-	- b.score (i - 1, j, k + 1)
-	+ b.cost (i - 1, k);
-    }
+    return defaultGrammar (b, i, j, k);
+  }
+
+  bool ParseController::policy (ParsePolicy &) const {
+    return false;
   }
 
   /**********************************************************************/
@@ -54,6 +49,13 @@ namespace Permute {
     return ((middle - begin) <= size_) || ((end - middle) <= size_);
   }
 
+  bool QuadraticParseController::policy (ParsePolicy & p) const {
+    p = ParsePolicy ();
+    p.type = ParsePolicy::QUADRATIC;
+    p.width = size_;
+    return true;
+  }
+
   ParseControllerRef QuadraticParseController::create (int size) {
     return ParseControllerRef (new QuadraticParseController (size));
   }
@@ -72,6 +74,11 @@ namespace Permute {
     return true;
   }
 
+  bool CubicParseController::policy (ParsePolicy & p) const {
+    p = ParsePolicy ();
+    return true;
+  }
+
   /**********************************************************************/
 
   ParseControllerDecorator::ParseControllerDecorator (ParseControllerRef controller) :
@@ -119,20 +126,25 @@ namespace Permute {
 
   double LeftAnchorParseController::grammar (const BeforeScorer & b, int i, int j, int k) const {
     if (i < k && i < width_) {
-      return b.score (i, j, k - 1)
-	+ b.score (i, j - 1, k)
-	- b.score (i, j - 1, k - 1)
-	+ b.cost (j - 1, k - 1);
+      return leftKeepGrammar (b, i, j, k);
     } else if (k < width_) {
-      return b.score (i - 1, j, k)
-	+ b.score (i, j - 1, k)
-	- b.score (i - 1, j - 1, k)
-	+ b.cost (i - 1, j - 1);
+      return leftSwapGrammar (b, i, j, k);
     } else {
       return ParseControllerDecorator::grammar (b, i, j, k);
     }
   }
 
+  // Only describes left anchors applied directly to a cubic or quadratic
+  // controller, since AnchoredMidpoints fixes the order of the recurrences.
+  bool LeftAnchorParseController::policy (ParsePolicy & p) const {
+    if (! decorated_ -> policy (p) || p.type == ParsePolicy::ANCHORED) {
+      return false;
+    }
+    p.type = ParsePolicy::ANCHORED;
+    p.left = width_;
+    return true;
+  }
+
   ParseControllerRef LeftAnchorParseController::decorate (ParseControllerRef controller, int width) {
     return ParseControllerRef (new LeftAnchorParseController (controller, width));
   }
@@ -164,20 +176,27 @@ namespace Permute {
   // @bug Test.
   double RightAnchorParseController::grammar (const BeforeScorer & b, int i, int j, int k) const {
     if (i < k && k > permutation_.size () - width_) {
-      return b.score (i + 1, j, k)
-	+ b.score (i, j + 1, k)
-	- b.score (i + 1, j + 1, k)
-	+ b.cost (i, j);
+      return rightKeepGrammar (b, i, j, k);
     } else if (i > permutation_.size () - width_) {
-      return b.score (i, j, k + 1)
-	+ b.score (i, j + 1, k)
-	- b.score (i, j + 1, k + 1)
-	+ b.cost (j, k);
+      return rightSwapGrammar (b, i, j, k);
     } else {
       return ParseControllerDecorator::grammar (b, i, j, k);
     }
   }
 
+  // Describes right anchors applied to a cubic, quadratic or left-anchored
+  // controller.  Matches the unsigned comparison in begin, under which a width
+  // larger than the permutation anchors nothing.
+  bool RightAnchorParseController::policy (ParsePolicy & p) const {
+    if (! decorated_ -> policy (p) || p.right != INT_MAX) {
+      return false;
+    }
+    p.type = ParsePolicy::ANCHORED;
+    int n = permutation_.size ();
+    p.right = (width_ <= n) ? n - width_ : INT_MAX;
+    return true;
+  }
+
   ParseControllerRef RightAnchorParseController::decorate (ParseControllerRef controller, const Permutation & permutation, int width) {
     return ParseControllerRef (new RightAnchorParseController (controller, permutation, width));
   }
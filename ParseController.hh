@@ -9,8 +9,9 @@
 
 namespace Permute {
 
-  // Forward declares BeforeScorer.
+  // Forward declares BeforeScorer and ParsePolicy.
   class BeforeScorer;
+  class ParsePolicy;
   
   // Returns an iterator over midpoints for a given (start, end) constituent
   // pair (begin and end methods), or allows queries of particular midpoint
@@ -65,6 +66,9 @@ namespace Permute {
     virtual iterator end (int, int) const;
     virtual bool allows (int, int, int) const = 0;
     virtual double grammar (const BeforeScorer &, int, int, int) const;
+    // Describes this controller as a compile-time policy (see ParsePolicy.hh)
+    // and returns true, or returns false if there is no such policy.
+    virtual bool policy (ParsePolicy &) const;
   };
 
   typedef Core::Ref <const ParseController> ParseControllerRef;
@@ -87,6 +91,7 @@ namespace Permute {
     QuadraticParseController (int = 1);
     virtual iterator begin (int, int) const;
     virtual bool allows (int, int, int) const;
+    virtual bool policy (ParsePolicy &) const;
     static ParseControllerRef create (int = 1);
   };
 
@@ -97,6 +102,7 @@ namespace Permute {
   public:
     virtual iterator begin (int, int) const;
     virtual bool allows (int, int, int) const;
+    virtual bool policy (ParsePolicy &) const;
     static ParseControllerRef create ();
   };
 
@@ -125,6 +131,7 @@ namespace Permute {
     virtual iterator begin (int, int) const;
     virtual bool allows (int, int, int) const;
     virtual double grammar (const BeforeScorer &, int, int, int) const;
+    virtual bool policy (ParsePolicy &) const;
     static ParseControllerRef decorate (ParseControllerRef, int);
   };
 
@@ -141,6 +148,7 @@ namespace Permute {
     virtual iterator begin (int, int) const;
     virtual bool allows (int, int, int) const;
     virtual double grammar (const BeforeScorer &, int, int, int) const;
+    virtual bool policy (ParsePolicy &) const;
     static ParseControllerRef decorate (ParseControllerRef, const Permutation &, int);
   };
 }
@@ -0,0 +1,208 @@
+// Defines compile-time counterparts of the standard ParseController classes.
+// Each policy enumerates midpoints with a plain integer iterator and computes
+// the grammar recurrence inline, so that charts and scorers templated on a
+// policy avoid the heap-allocated, virtual iterators of ParseController.  The
+// dispatch function recovers a policy from a ParseControllerRef at run time,
+// falling back on ControllerMidpoints for controllers it does not recognize.
+
+#ifndef _PERMUTE_PARSE_POLICY_HH
+#define _PERMUTE_PARSE_POLICY_HH
+
+#include <climits>
+#include "BeforeScorer.hh"
+#include "ParseController.hh"
+
+namespace Permute {
+
+  // Describes a standard controller: its type, the quadratic width (negative
+  // if the underlying controller is cubic), and the anchors.  Spans with begin
+  // < left or end > right allow every midpoint.
+  class ParsePolicy {
+  public:
+    typedef enum {
+      CUBIC,
+      QUADRATIC,
+      ANCHORED
+    } Type;
+    Type type;
+    int width;
+    int left;
+    int right;
+    ParsePolicy () :
+      type (CUBIC),
+      width (-1),
+      left (0),
+      right (INT_MAX)
+    {}
+  };
+
+  /**********************************************************************/
+
+  // Implements the recurrences of ParseController::grammar and the anchor
+  // decorators.  ParseController.cc uses these same functions, so both paths
+  // produce identical scores.
+  inline double defaultGrammar (const BeforeScorer & b, int i, int j, int k) {
+    if (i < k) {
+      return b.score (i, j, k - 1)
+	+ b.score (i + 1, j, k)
+	- b.score (i + 1, j, k - 1)
+	+ b.cost (i, k - 1);
+    } else {
+      return b.score (i - 1, j, k)
+	+ b.score (i, j, k + 1)
+	- b.score (i - 1, j, k + 1)
+	+ b.cost (i - 1, k);
+    }
+  }
+
+  inline double leftKeepGrammar (const BeforeScorer & b, int i, int j, int k) {
+    return b.score (i, j, k - 1)
+      + b.score (i, j - 1, k)
+      - b.score (i, j - 1, k - 1)
+      + b.cost (j - 1, k - 1);
+  }
+
+  inline double leftSwapGrammar (const BeforeScorer & b, int i, int j, int k) {
+    return b.score (i - 1, j, k)
+      + b.score (i, j - 1, k)
+      - b.score (i - 1, j - 1, k)
+      + b.cost (i - 1, j - 1);
+  }
+
+  inline double rightKeepGrammar (const BeforeScorer & b, int i, int j, int k) {
+    return b.score (i + 1, j, k)
+      + b.score (i, j + 1, k)
+      - b.score (i + 1, j + 1, k)
+      + b.cost (i, j);
+  }
+
+  inline double rightSwapGrammar (const BeforeScorer & b, int i, int j, int k) {
+    return b.score (i, j, k + 1)
+      + b.score (i, j + 1, k)
+      - b.score (i, j + 1, k + 1)
+      + b.cost (j, k);
+  }
+
+  /**********************************************************************/
+
+  // Iterates over the integers from current to end, jumping from left + 1 to
+  // right.  A span without a gap uses left == right.
+  class Midpoints {
+  private:
+    int current_, left_, right_;
+  public:
+    Midpoints (int current, int left, int right) :
+      current_ (current),
+      left_ (left),
+      right_ (right)
+    {}
+    Midpoints & operator ++ () {
+      ++ current_;
+      if (current_ > left_ && current_ < right_) {
+	current_ = right_;
+      }
+      return * this;
+    }
+    operator int () const {
+      return current_;
+    }
+    bool operator != (const Midpoints & other) const {
+      return current_ != other.current_;
+    }
+  };
+
+  // Counterpart of CubicParseController.
+  class CubicMidpoints {
+  public:
+    typedef Midpoints iterator;
+    iterator begin (int i, int k) const { return iterator (i + 1, k, k); }
+    iterator end (int, int k) const { return iterator (k, k, k); }
+    double grammar (const BeforeScorer & b, int i, int j, int k) const {
+      return defaultGrammar (b, i, j, k);
+    }
+  };
+
+  // Counterpart of QuadraticParseController.
+  class QuadraticMidpoints {
+  private:
+    int width_;
+  public:
+    typedef Midpoints iterator;
+    explicit QuadraticMidpoints (int width) : width_ (width) {}
+    iterator begin (int i, int k) const { return iterator (i + 1, i + width_, k - width_); }
+    iterator end (int, int k) const { return iterator (k, k, k); }
+    double grammar (const BeforeScorer & b, int i, int j, int k) const {
+      return defaultGrammar (b, i, j, k);
+    }
+  };
+
+  // Counterpart of RightAnchorParseController decorating
+  // LeftAnchorParseController decorating a cubic or quadratic controller.
+  class AnchoredMidpoints {
+  private:
+    int width_, left_, right_;
+  public:
+    typedef Midpoints iterator;
+    AnchoredMidpoints (int width, int left, int right) :
+      width_ (width),
+      left_ (left),
+      right_ (right)
+    {}
+    iterator begin (int i, int k) const {
+      if (width_ < 0 || i < left_ || k > right_) {
+	return iterator (i + 1, k, k);
+      } else {
+	return iterator (i + 1, i + width_, k - width_);
+      }
+    }
+    iterator end (int, int k) const { return iterator (k, k, k); }
+    double grammar (const BeforeScorer & b, int i, int j, int k) const {
+      if (i < k && k > right_) {
+	return rightKeepGrammar (b, i, j, k);
+      } else if (i > right_) {
+	return rightSwapGrammar (b, i, j, k);
+      } else if (i < k && i < left_) {
+	return leftKeepGrammar (b, i, j, k);
+      } else if (k < left_) {
+	return leftSwapGrammar (b, i, j, k);
+      } else {
+	return defaultGrammar (b, i, j, k);
+      }
+    }
+  };
+
+  // Forwards to an arbitrary ParseController through its virtual interface.
+  class ControllerMidpoints {
+  private:
+    const ParseController & controller_;
+  public:
+    typedef ParseController::iterator iterator;
+    explicit ControllerMidpoints (const ParseController & controller) :
+      controller_ (controller)
+    {}
+    iterator begin (int i, int k) const { return controller_.begin (i, k); }
+    iterator end (int i, int k) const { return controller_.end (i, k); }
+    double grammar (const BeforeScorer & b, int i, int j, int k) const {
+      return controller_.grammar (b, i, j, k);
+    }
+  };
+
+  /**********************************************************************/
+
+  // Calls f(policy) with the policy equivalent to the given controller.
+  template <class Functor>
+  void dispatch (const ParseControllerRef & controller, const Functor & f) {
+    ParsePolicy policy;
+    if (! controller -> policy (policy)) {
+      f (ControllerMidpoints (* controller));
+    } else if (policy.type == ParsePolicy::CUBIC) {
+      f (CubicMidpoints ());
+    } else if (policy.type == ParsePolicy::QUADRATIC) {
+      f (QuadraticMidpoints (policy.width));
+    } else {
+      f (AnchoredMidpoints (policy.width, policy.left, policy.right));
+    }
+  }
+}
+
+#endif//_PERMUTE_PARSE_POLICY_HH
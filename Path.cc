@@ -1,10 +1,112 @@
 #include "Path.hh"
 #include "PathVisitor.hh"
 
+#include <pthread.h>
 #include <Core/Types.hh>
 #include <Fsa/Automaton.hh>
 
 namespace Permute {
+  namespace {
+    // Nodes are grouped in size classes that are multiples of NodeAlignment up
+    // to MaxNodeSize.  Larger nodes come from the general heap.
+    const size_t NodeAlignment = 16, MaxNodeSize = 256, SlabSize = 1 << 16,
+      SizeClasses = MaxNodeSize / NodeAlignment;
+
+    struct FreeNode {
+      FreeNode * next;
+    };
+
+    __thread FreeNode * freeNodes [SizeClasses];
+    __thread bool registered = false;
+
+    // The free nodes of threads that have exited, which the remaining threads
+    // take before carving new slabs.
+    FreeNode * sharedNodes [SizeClasses];
+    pthread_mutex_t sharedMutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_key_t exitKey;
+    pthread_once_t exitOnce = PTHREAD_ONCE_INIT;
+
+    // Moves the free lists of an exiting thread to the shared pool.
+    void drain (void *) {
+      pthread_mutex_lock (& sharedMutex);
+      for (size_t c = 0; c < SizeClasses; ++ c) {
+	if (freeNodes [c] != 0) {
+	  FreeNode * tail = freeNodes [c];
+	  while (tail -> next != 0) {
+	    tail = tail -> next;
+	  }
+	  tail -> next = sharedNodes [c];
+	  sharedNodes [c] = freeNodes [c];
+	  freeNodes [c] = 0;
+	}
+      }
+      pthread_mutex_unlock (& sharedMutex);
+      registered = false;
+    }
+
+    void createExitKey () {
+      pthread_key_create (& exitKey, drain);
+    }
+
+    // Arranges for drain to run when the calling thread exits.
+    FreeNode * & freeList (size_t size) {
+      if (! registered) {
+	pthread_once (& exitOnce, createExitKey);
+	pthread_setspecific (exitKey, & registered);
+	registered = true;
+      }
+      return freeNodes [(size - 1) / NodeAlignment];
+    }
+
+    // Takes the shared free nodes of the given size class, or carves a new
+    // slab into free nodes if there are none.  Slabs are never returned to
+    // the heap, so the pool keeps its peak size.
+    void refill (FreeNode * & head, size_t size) {
+      size_t c = (size - 1) / NodeAlignment;
+      pthread_mutex_lock (& sharedMutex);
+      head = sharedNodes [c];
+      sharedNodes [c] = 0;
+      pthread_mutex_unlock (& sharedMutex);
+      if (head != 0) {
+	return;
+      }
+      size_t node = (c + 1) * NodeAlignment;
+      char * slab = static_cast <char *> (::operator new (SlabSize));
+      for (char * p = slab; p + node <= slab + SlabSize; p += node) {
+	FreeNode * free = reinterpret_cast <FreeNode *> (p);
+	free -> next = head;
+	head = free;
+      }
+    }
+  }
+
+  void * Path::operator new (size_t size) {
+    if (size > MaxNodeSize) {
+      return ::operator new (size);
+    }
+    FreeNode * & head = freeList (size);
+    if (head == 0) {
+      refill (head, size);
+    }
+    FreeNode * node = head;
+    head = node -> next;
+    return node;
+  }
+
+  void Path::operator delete (void * p, size_t size) {
+    if (p == 0) {
+      return;
+    } else if (size > MaxNodeSize) {
+      ::operator delete (p);
+    } else {
+      FreeNode * & head = freeList (size);
+      FreeNode * node = static_cast <FreeNode *> (p);
+      node -> next = head;
+      head = node;
+    }
+  }
+
+  /**********************************************************************/
 
   Arc::Arc (size_t index, Fsa::StateId source, Fsa::StateId target, double score) :
     PathImpl (score),
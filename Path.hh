@@ -18,6 +18,12 @@ namespace Permute {
   //
   // Path has numerous static methods for constructing different kinds of
   // paths.
+  //
+  // Charts create and discard many small paths, so Path recycles the memory of
+  // its nodes through per-thread free lists instead of the general heap.  A
+  // node may be freed on a different thread than the one that allocated it.
+  // The free lists of a thread that exits pass to a shared pool, from which
+  // the other threads refill theirs.
   class Path : public Core::ReferenceCounted {
   public:
     typedef enum {
@@ -27,6 +33,8 @@ namespace Permute {
     } Type;
     Path () : Core::ReferenceCounted () {}
     virtual ~Path () {};
+    static void * operator new (size_t);
+    static void operator delete (void *, size_t);
     virtual Fsa::StateId getStart () const = 0;
     virtual Fsa::StateId getEnd () const = 0;
     virtual double getScore () const = 0;
@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <time.h>
+
+#include "LOPChart.hh"
+#include "LinearOrdering.hh"
+#include "ParseController.hh"
+#include "Portfolio.hh"
+
+namespace Permute {
+
+  namespace {
+    // Returns the CPU time in seconds of the calling thread, or else of the
+    // whole process, which includes the pool threads that a step fills its
+    // chart on.
+    double cpuTime (bool thread) {
+      struct timespec now;
+      clock_gettime (thread ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID, & now);
+      return now.tv_sec + now.tv_nsec / 1e9;
+    }
+
+    // Binds search to the portfolio for use with parallelFor.
+    class Search {
+    private:
+      Portfolio & portfolio_;
+    public:
+      Search (Portfolio & portfolio) : portfolio_ (portfolio) {}
+      void operator () (int index) const {
+	portfolio_.search (index);
+      }
+    };
+  }
+
+  // One neighborhood, with everything it needs to search from its own copy
+  // of the permutation.
+  class Portfolio::Arm {
+  public:
+    const Neighborhood neighborhood;
+    Permutation pi;
+    PermutedCost cost;
+    BlockWorkspace workspace;
+    ParseControllerRef controller;
+    ScorerRef scorer;
+    std::auto_ptr <QuadraticNormalLOPChart> quadratic;
+    std::auto_ptr <LOPChart> cubic;
+    // The version of the best permutation that pi holds, and the last
+    // version this neighborhood failed to improve.
+    int version;
+    int stuck;
+    int steps;
+    // Discounted improvement and CPU time.
+    double gain;
+    double time;
+
+    Arm (Neighborhood neighborhood, const BeforeCostRef & bc, const Permutation & start,
+	 const ThreadPoolRef & pool, int quadraticWidth) :
+      neighborhood (neighborhood),
+      pi (start),
+      cost (bc, pi),
+      workspace (),
+      controller (),
+      scorer (),
+      quadratic (),
+      cubic ()
+    {
+      reset ();
+      if (neighborhood == QUADRATIC || neighborhood == CUBIC) {
+	BeforeScorer * beforeScorer = new BeforeScorer (bc, pi);
+	beforeScorer -> setThreadPool (pool);
+	scorer = ScorerRef (beforeScorer);
+      }
+      if (neighborhood == QUADRATIC) {
+	controller = QuadraticParseController::create (quadraticWidth);
+	quadratic.reset (new QuadraticNormalLOPChart (pi, quadraticWidth, true, pool));
+      } else if (neighborhood == CUBIC) {
+	controller = CubicParseController::create ();
+	cubic.reset (new LOPChart (pi, 0, pool));
+      }
+    }
+
+    void reset () {
+      version = 0;
+      stuck = -1;
+      steps = 0;
+      gain = 0.0;
+      time = 0.0;
+    }
+
+    void step (int blockWidth) {
+      switch (neighborhood) {
+      case LSF:
+	visit (pi, cost);
+	break;
+      case BLOCK_LSF:
+	block_lsf (pi, cost, blockWidth, workspace);
+	break;
+      case QUADRATIC:
+	quadratic -> permute (controller, scorer);
+	reorder (quadratic -> getBestPath ());
+	break;
+      case CUBIC:
+	cubic -> permute (controller, scorer);
+	reorder (cubic -> getBestPath ());
+	break;
+      default:
+	break;
+      }
+    }
+
+    void reorder (const ConstPathRef & path) {
+      if (path -> getScore () > cost.score ()) {
+	pi.reorder (path);
+	cost.assign (pi);
+      }
+    }
+  };
+
+  Portfolio::Portfolio (const BeforeCostRef & bc,
+			const ThreadPoolRef & pool,
+			bool concurrent,
+			int blockWidth,
+			int quadraticWidth,
+			double exploration,
+			double discount) :
+    bc_ (bc),
+    pool_ (pool),
+    concurrent_ (concurrent),
+    blockWidth_ (blockWidth),
+    quadraticWidth_ (std::max (quadraticWidth, 1)),
+    exploration_ (exploration),
+    discount_ (discount),
+    arms_ (),
+    best_ (),
+    score_ (0.0),
+    version_ (0),
+    seconds_ (0.0),
+    timer_ ()
+  {
+    std::fill (enabled_, enabled_ + NEIGHBORHOODS, true);
+    pthread_mutex_init (& mutex_, 0);
+  }
+
+  Portfolio::~Portfolio () {
+    for (std::vector <Arm *>::const_iterator it = arms_.begin (); it != arms_.end (); ++ it) {
+      delete * it;
+    }
+    pthread_mutex_destroy (& mutex_);
+  }
+
+  void Portfolio::enable (Neighborhood neighborhood, bool enabled) {
+    enabled_ [neighborhood] = enabled;
+  }
+
+  int Portfolio::steps () const {
+    int steps = 0;
+    for (int i = 0; i < NEIGHBORHOODS; ++ i) {
+      steps += records_ [i].steps;
+    }
+    return steps;
+  }
+
+  double Portfolio::run (Permutation & pi, double seconds) {
+    timer_.start ();
+    seconds_ = seconds;
+    build (pi);
+
+    if (concurrent_) {
+      // A thread that finds its neighborhood stuck returns, so another round
+      // is needed if a later improvement unstuck it.
+      do {
+	parallelFor (pool_, 0, arms_.size (), Search (* this), 1);
+      } while (! settled () && ! expired ());
+    } else {
+      for (int index; (index = choose ()) >= 0 && advance (* arms_ [index]););
+    }
+
+    std::copy (best_.begin (), best_.end (), pi.begin ());
+    return score_;
+  }
+
+  void Portfolio::search (int index) {
+    while (advance (* arms_ [index]));
+  }
+
+  // Builds the neighborhoods on the first run, and afterwards points them at
+  // the new starting permutation.
+  void Portfolio::build (const Permutation & pi) {
+    if (arms_.empty ()) {
+      const ThreadPoolRef & pool = concurrent_ ? ThreadPoolRef () : pool_;
+      for (int i = 0; i < NEIGHBORHOODS; ++ i) {
+	if (enabled_ [i] && (i != BLOCK_LSF || blockWidth_ > 0)) {
+	  arms_.push_back (new Arm (Neighborhood (i), bc_, pi, pool, quadraticWidth_));
+	}
+      }
+    } else {
+      for (std::vector <Arm *>::const_iterator it = arms_.begin (); it != arms_.end (); ++ it) {
+	std::copy (pi.begin (), pi.end (), (* it) -> pi.begin ());
+	(* it) -> cost.assign ((* it) -> pi);
+	(* it) -> reset ();
+      }
+    }
+    std::fill (records_, records_ + NEIGHBORHOODS, Record ());
+    best_.assign (pi.begin (), pi.end ());
+    score_ = bc_ -> score (pi);
+    version_ = 0;
+  }
+
+  // Returns the neighborhood to run next, or -1 if every one is stuck.
+  // Neighborhoods never run before come first, cheapest first.
+  int Portfolio::choose () const {
+    int total = 0;
+    double top = 0.0;
+    for (std::vector <Arm *>::const_iterator it = arms_.begin (); it != arms_.end (); ++ it) {
+      total += (* it) -> steps;
+      if ((* it) -> steps > 0) {
+	top = std::max (top, (* it) -> gain / (* it) -> time);
+      }
+    }
+    int choice = -1;
+    double value = 0.0;
+    for (int i = 0; i < arms_.size (); ++ i) {
+      const Arm & arm = * arms_ [i];
+      if (arm.stuck == version_) {
+	continue;
+      } else if (arm.steps == 0) {
+	return i;
+      }
+      double bound = arm.gain / arm.time
+	+ exploration_ * top * std::sqrt (std::log (double (total)) / arm.steps);
+      if (choice < 0 || bound > value) {
+	choice = i;
+	value = bound;
+      }
+    }
+    return choice;
+  }
+
+  // Runs one step of arm, starting from the best permutation if it has
+  // changed since the arm last saw it.  Returns false, without a step, once
+  // the arm is stuck or time has run out.
+  bool Portfolio::advance (Arm & arm) {
+    pthread_mutex_lock (& mutex_);
+    const bool done = expired () || arm.stuck == version_;
+    const bool stale = ! done && arm.version != version_;
+    if (stale) {
+      std::copy (best_.begin (), best_.end (), arm.pi.begin ());
+      arm.version = version_;
+    }
+    pthread_mutex_unlock (& mutex_);
+    if (done) {
+      return false;
+    }
+    if (stale) {
+      arm.cost.assign (arm.pi);
+    }
+
+    const double before = arm.cost.score ();
+    // Concurrent arms each run on one thread; otherwise an arm's step may
+    // run on the whole pool, and nothing else runs meanwhile.
+    const double start = cpuTime (concurrent_);
+    arm.step (blockWidth_);
+    const double time = std::max (cpuTime (concurrent_) - start, 1e-6);
+    const double score = arm.cost.score ();
+    // Ignores gains within rounding error, which would never end.
+    const double gain = score - before > 1e-10 * (1.0 + std::fabs (before)) ? score - before : 0.0;
+
+    ++ arm.steps;
+    arm.gain = discount_ * arm.gain + gain;
+    arm.time = discount_ * arm.time + time;
+    Record & record = records_ [arm.neighborhood];
+    ++ record.steps;
+    record.gain += gain;
+    record.time += time;
+
+    pthread_mutex_lock (& mutex_);
+    if (gain > 0.0 && score > score_) {
+      best_.assign (arm.pi.begin (), arm.pi.end ());
+      score_ = score;
+      arm.version = ++ version_;
+    } else if (gain == 0.0 && arm.version == version_) {
+      arm.stuck = version_;
+    }
+    pthread_mutex_unlock (& mutex_);
+    return true;
+  }
+
+  bool Portfolio::settled () const {
+    for (std::vector <Arm *>::const_iterator it = arms_.begin (); it != arms_.end (); ++ it) {
+      if ((* it) -> stuck != version_) {
+	return false;
+      }
+    }
+    return true;
+  }
+
+  // Core::Timer measures up to the last call to stop.  Called with mutex_
+  // held, or with no search running.
+  bool Portfolio::expired () {
+    if (seconds_ <= 0.0) {
+      return false;
+    }
+    timer_.stop ();
+    return timer_.elapsed () >= seconds_;
+  }
+}
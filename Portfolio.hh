@@ -0,0 +1,110 @@
+#ifndef _PERMUTE_PORTFOLIO_HH
+#define _PERMUTE_PORTFOLIO_HH
+
+#include <pthread.h>
+#include <Core/Statistics.hh>
+
+#include "BeforeScorer.hh"
+#include "Permutation.hh"
+#include "ThreadPool.hh"
+
+namespace Permute {
+
+  // Schedules several local search neighborhoods of the linear ordering
+  // problem by how fast each has been improving the permutation: LS_f
+  // (visit), block_lsf, Q(2) (QuadraticNormalLOPChart), and the cubic ITG
+  // neighborhood (LOPChart).  Each step runs one neighborhood once.
+  //
+  // The choice is a bandit: every neighborhood is tried once, and afterwards
+  // the one with the highest upper confidence bound (UCB1, Auer et al., 2002)
+  // on its improvement per CPU-second runs next.  The estimates discount
+  // older steps, since every neighborhood slows down as the permutation
+  // approaches a local optimum.  A neighborhood that fails to improve the
+  // current permutation is left out until the permutation changes, and the
+  // search ends at a local optimum of every enabled neighborhood, or when
+  // the time limit expires.
+  //
+  // With concurrent set, each neighborhood instead runs on its own thread of
+  // the pool, which should have a thread for each.  The threads share the
+  // best permutation through a mutex: a neighborhood that improves on it
+  // publishes its result, and one that falls behind starts again from it.
+  // Otherwise the charts and scorers use the pool themselves.
+  //
+  // Every neighborhood keeps its own permutation, cost view, scorer and
+  // chart, built on the calling thread, so that threads never touch a shared
+  // reference count.
+  class Portfolio {
+  public:
+    typedef enum {
+      LSF,
+      BLOCK_LSF,
+      QUADRATIC,
+      CUBIC,
+      NEIGHBORHOODS
+    } Neighborhood;
+
+    // What one neighborhood has done during the last run.
+    class Record {
+    public:
+      int steps;
+      double gain;
+      double time;
+      Record () : steps (0), gain (0.0), time (0.0) {}
+    };
+
+    class Arm;
+  private:
+    BeforeCostRef bc_;
+    ThreadPoolRef pool_;
+    bool concurrent_;
+    int blockWidth_;
+    int quadraticWidth_;
+    double exploration_;
+    double discount_;
+    bool enabled_ [NEIGHBORHOODS];
+    Record records_ [NEIGHBORHOODS];
+    std::vector <Arm *> arms_;
+    pthread_mutex_t mutex_;
+    // The best permutation so far, and how many times it has changed.
+    std::vector <size_t> best_;
+    double score_;
+    int version_;
+    double seconds_;
+    Core::Timer timer_;
+  public:
+    // A block width of zero disables block_lsf.  Exploration scales the
+    // confidence bonus, and discount weighs the previous estimate of a
+    // neighborhood against its latest step.
+    Portfolio (const BeforeCostRef & bc,
+	       const ThreadPoolRef & pool,
+	       bool concurrent,
+	       int blockWidth,
+	       int quadraticWidth = 2,
+	       double exploration = 1.0,
+	       double discount = 0.9);
+    ~Portfolio ();
+
+    // Must be called before the first run.
+    void enable (Neighborhood neighborhood, bool enabled);
+
+    // Improves pi until no neighborhood can, or until seconds of wall-clock
+    // time have passed if seconds is positive.  Leaves the best permutation
+    // in pi and returns its score.
+    double run (Permutation & pi, double seconds = 0.0);
+    const Record & record (Neighborhood neighborhood) const { return records_ [neighborhood]; }
+    int steps () const;
+
+    // Runs neighborhood index until it is stuck.  Public for the thread pool.
+    void search (int index);
+  private:
+    Portfolio (const Portfolio &);
+    Portfolio & operator = (const Portfolio &);
+    void build (const Permutation & pi);
+    int choose () const;
+    bool advance (Arm & arm);
+    bool settled () const;
+    bool expired ();
+  };
+}
+
+#endif//_PERMUTE_PORTFOLIO_HH
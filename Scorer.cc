@@ -7,4 +7,10 @@ namespace Permute {
   double Scorer::score (const Permutation &) const {
     return 0.0;
   }
+  void Scorer::scores (int i, int k, int first, int last, double * keep, double * swap) const {
+    for (int j = first; j < last; ++ j) {
+      * keep ++ = score (i, j, k);
+      * swap ++ = score (k, j, i);
+    }
+  }
 }
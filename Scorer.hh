@@ -13,12 +13,15 @@ namespace Permute {
   // Computes scores for ordering subsequences of permutation: score(i, j, k) is
   // the score for everything in (i, j) preceding everything in (j, k), score(k,
   // j, i) is the opposite, and score(pi) computes the total score of a given
-  // permutation.
+  // permutation.  The scores method fetches a run of midpoints at once:
+  // scores(i, k, first, last, keep, swap) sets keep[j - first] to score(i, j,
+  // k) and swap[j - first] to score(k, j, i) for first <= j < last.
   class Scorer : public Core::ReferenceCounted {
   public:
     Scorer () : Core::ReferenceCounted () {}
     virtual double score (int, int, int) const;
     virtual double score (const Permutation &) const;
+    virtual void scores (int, int, int, int, double *, double *) const;
     virtual void compute (const ParseControllerRef &) {};
   };
 
@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "LinearOrdering.hh"
+#include "TabuSearch.hh"
+
+namespace Permute {
+
+  namespace {
+    Permutation identity (int n) {
+      Permutation pi;
+      integerPermutation (pi, n);
+      return pi;
+    }
+  }
+
+  TabuSearch::TabuSearch (const BeforeCostRef & bc, int tenure, int blockWidth, unsigned seed) :
+    cost_ (bc, identity (bc -> size ())),
+    tenure_ (std::max (tenure, 0)),
+    blockWidth_ (std::max (blockWidth, 1)),
+    state_ (seed),
+    pi_ (0),
+    n_ (0),
+    delta_ (),
+    best_ (),
+    until_ (),
+    from_ (),
+    direction_ (),
+    sums_ (),
+    current_ (0.0),
+    bestScore_ (0.0),
+    moves_ (0),
+    seconds_ (0.0),
+    timer_ ()
+  {}
+
+  double TabuSearch::run (Permutation & pi, long moves, double seconds) {
+    timer_.start ();
+    seconds_ = seconds;
+    pi_ = & pi;
+    n_ = pi.size ();
+    delta_.assign (n_ * n_, 0.0);
+    best_.assign (n_, 0);
+    until_.assign (n_, 0);
+    from_.assign (n_, 0);
+    direction_.assign (n_, 0);
+    sums_.assign (n_, 0.0);
+    lower_.assign (n_, 0);
+    upper_.assign (n_, n_ - 1);
+    moves_ = 0;
+
+    rebuild ();
+    bestScore_ = current_;
+    std::vector <size_t> best (pi.begin (), pi.end ());
+
+    while (n_ > 1 && (moves <= 0 || moves_ < moves) && ! expired ()) {
+      limit ();
+      int x, r;
+      double gain = bestInsert (x, r);
+      int i, w, k;
+      double blockGain = (gain <= 0.0 && blockWidth_ > 1) ? bestBlock (i, w, k) : 0.0;
+      if (blockGain > 0.0) {
+	gain = blockGain;
+	if (k >= i + w) {
+	  forbid (i, i + w, 1);
+	  insert (pi, i, i + w, k + 1);
+	  update (i, k);
+	} else {
+	  forbid (i, i + w, -1);
+	  insert (pi, i, i + w, k);
+	  update (k, i + w - 1);
+	}
+      } else {
+	forbid (x, x + 1, r > x ? 1 : -1);
+	insert (pi, x, r);
+	update (std::min (x, r), std::max (x, r));
+      }
+      current_ += gain;
+      ++ moves_;
+      if (moves_ % n_ == 0) {
+	rebuild ();
+      }
+      if (current_ > bestScore_) {
+	bestScore_ = current_;
+	best.assign (pi.begin (), pi.end ());
+      }
+    }
+
+    std::copy (best.begin (), best.end (), pi.begin ());
+    bestScore_ = score ();
+    pi_ = 0;
+    return bestScore_;
+  }
+
+  // Sums in the same order as BeforeCostInterface::score.
+  double TabuSearch::score () const {
+    const Permutation & pi = * pi_;
+    double s = 0.0;
+    for (int a = 0; a < n_ - 1; ++ a) {
+      const PermutedCost::Pair * row = cost_.row (pi [a]);
+      for (int b = a + 1; b < n_; ++ b) {
+	s += row [pi [b]].before;
+      }
+    }
+    return s;
+  }
+
+  void TabuSearch::rebuild () {
+    for (int x = 0; x < n_; ++ x) {
+      fill (x);
+      choose (x);
+    }
+    current_ = score ();
+  }
+
+  // Accumulates the gains of row x as InsertEngine does.
+  void TabuSearch::fill (int x) {
+    const Permutation & pi = * pi_;
+    const PermutedCost::Pair * row = cost_.row (pi [x]);
+    double d = 0.0;
+    for (int r = x - 1; r >= 0; -- r) {
+      d -= row [pi [r]].after;
+      d += row [pi [r]].before;
+      delta (x, r) = d;
+    }
+    delta (x, x) = 0.0;
+    d = 0.0;
+    for (int r = x + 1; r < n_; ++ r) {
+      d -= row [pi [r]].before;
+      d += row [pi [r]].after;
+      delta (x, r) = d;
+    }
+  }
+
+  // Recomputes the gains of row x for the targets in [lo, hi], where x lies
+  // outside that range, continuing from the gain of the target next to it.
+  void TabuSearch::fill (int x, int lo, int hi) {
+    const Permutation & pi = * pi_;
+    const PermutedCost::Pair * row = cost_.row (pi [x]);
+    if (x < lo) {
+      double d = (lo - 1 > x) ? delta (x, lo - 1) : 0.0;
+      for (int r = lo; r <= hi; ++ r) {
+	d -= row [pi [r]].before;
+	d += row [pi [r]].after;
+	delta (x, r) = d;
+      }
+    } else {
+      double d = (hi + 1 < x) ? delta (x, hi + 1) : 0.0;
+      for (int r = hi; r >= lo; -- r) {
+	d -= row [pi [r]].after;
+	d += row [pi [r]].before;
+	delta (x, r) = d;
+      }
+    }
+  }
+
+  // Chooses the first of the best targets of row x other than x itself.
+  void TabuSearch::choose (int x) {
+    int best = (x == 0) ? 1 : 0;
+    for (int r = best + 1; r < n_; ++ r) {
+      if (r != x && delta (x, r) > delta (x, best)) {
+	best = r;
+      }
+    }
+    best_ [x] = best;
+  }
+
+  // Updates the best target of row x after its gains in [lo, hi] changed.
+  // Only rescans the row if the old best was among them.
+  void TabuSearch::choose (int x, int lo, int hi) {
+    if (lo <= best_ [x] && best_ [x] <= hi) {
+      choose (x);
+    } else {
+      for (int r = lo; r <= hi; ++ r) {
+	if (delta (x, r) > delta (x, best_ [x])
+	    || (delta (x, r) == delta (x, best_ [x]) && r < best_ [x])) {
+	  best_ [x] = r;
+	}
+      }
+    }
+  }
+
+  // Brings the table up to date after positions lo through hi were reordered.
+  void TabuSearch::update (int lo, int hi) {
+    for (int x = 0; x < n_; ++ x) {
+      if (lo <= x && x <= hi) {
+	fill (x);
+	choose (x);
+      } else {
+	fill (x, lo, hi);
+	choose (x, lo, hi);
+      }
+    }
+  }
+
+  // Finds the targets of each position that cross no tabu element the wrong
+  // way: past one that moved right, rightward, or past one that moved left,
+  // leftward.
+  void TabuSearch::limit () {
+    const Permutation & pi = * pi_;
+    int bound = 0;
+    for (int x = 0; x < n_; ++ x) {
+      lower_ [x] = bound;
+      if (tabu (pi [x]) && direction_ [pi [x]] < 0) {
+	bound = x + 1;
+      }
+    }
+    bound = n_ - 1;
+    for (int x = n_ - 1; x >= 0; -- x) {
+      upper_ [x] = bound;
+      if (tabu (pi [x]) && direction_ [pi [x]] > 0) {
+	bound = x - 1;
+      }
+    }
+  }
+
+  bool TabuSearch::allowed (int x, int r) const {
+    const int element = (* pi_) [x];
+    if (r < lower_ [x] || r > upper_ [x]) {
+      return false;
+    } else if (! tabu (element)) {
+      return true;
+    } else if (direction_ [element] > 0) {
+      return r > from_ [element];
+    } else {
+      return r < from_ [element];
+    }
+  }
+
+  // Finds the admissible insert move with the greatest gain, the first among
+  // equals, and returns its gain.  If every move is tabu, ignores tabu.
+  double TabuSearch::bestInsert (int & x, int & r) {
+    x = -1;
+    r = -1;
+    double max = 0.0;
+    for (int y = 0; y < n_; ++ y) {
+      int s = best_ [y];
+      double gain = delta (y, s);
+      if (! allowed (y, s) && ! aspires (gain)) {
+	s = -1;
+	for (int t = 0; t < n_; ++ t) {
+	  if (t != y && allowed (y, t) && (s < 0 || delta (y, t) > gain)) {
+	    s = t;
+	    gain = delta (y, t);
+	  }
+	}
+	if (s < 0) {
+	  continue;
+	}
+      }
+      if (x < 0 || gain > max) {
+	x = y;
+	r = s;
+	max = gain;
+      }
+    }
+    if (x < 0) {
+      for (int y = 0; y < n_; ++ y) {
+	if (x < 0 || delta (y, best_ [y]) > max) {
+	  x = y;
+	  r = best_ [y];
+	  max = delta (y, best_ [y]);
+	}
+      }
+    }
+    return max;
+  }
+
+  // Finds the admissible block move with the greatest gain, among blocks of
+  // two to blockWidth elements, and returns its gain, or zero if none gains.
+  // Moving block [i, i + w) after position k >= i + w gains the sum over the
+  // block of delta (x, k) - delta (x, i + w - 1), and moving it to start at
+  // k < i gains the sum of delta (x, k) - delta (x, i).  A block holding a
+  // tabu element, or crossing one the wrong way, moves only by aspiration.
+  double TabuSearch::bestBlock (int & i, int & w, int & k) {
+    const Permutation & pi = * pi_;
+    double max = 0.0;
+    i = -1;
+    for (int a = 0; a + 1 < n_; ++ a) {
+      for (int t = 0; t < n_; ++ t) {
+	sums_ [t] = delta (a, t);
+      }
+      double left = 0.0;
+      bool blocked = tabu (pi [a]);
+      for (int width = 2; width <= blockWidth_ && a + width <= n_; ++ width) {
+	const int last = a + width - 1;
+	blocked = blocked || tabu (pi [last]);
+	for (int t = 0; t < n_; ++ t) {
+	  sums_ [t] += delta (last, t);
+	}
+	left += delta (last, a);
+	double right = 0.0;
+	for (int x = a; x <= last; ++ x) {
+	  right += delta (x, last);
+	}
+	for (int t = 0; t < n_; ++ t) {
+	  if (t >= a && t <= last) {
+	    continue;
+	  }
+	  double gain = sums_ [t] - (t > last ? right : left);
+	  bool crosses = t > last ? t > upper_ [last] : t < lower_ [a];
+	  if (gain > max && ((! blocked && ! crosses) || aspires (gain))) {
+	    max = gain;
+	    i = a;
+	    w = width;
+	    k = t;
+	  }
+	}
+      }
+    }
+    return max;
+  }
+
+  // Makes the elements at positions [first, last) tabu before they move in
+  // the given direction, for between tenure and twice tenure moves.
+  void TabuSearch::forbid (int first, int last, int direction) {
+    const Permutation & pi = * pi_;
+    const long until = moves_ + 1 + tenure_ + rand_r (& state_) % (tenure_ + 1);
+    for (int x = first; x < last; ++ x) {
+      const int element = pi [x];
+      until_ [element] = until;
+      from_ [element] = x;
+      direction_ [element] = direction;
+    }
+  }
+
+  // Core::Timer measures up to the last call to stop.
+  bool TabuSearch::expired () {
+    if (seconds_ <= 0.0) {
+      return false;
+    }
+    timer_.stop ();
+    return timer_.elapsed () >= seconds_;
+  }
+}
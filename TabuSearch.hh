@@ -0,0 +1,96 @@
+#ifndef _PERMUTE_TABU_SEARCH_HH
+#define _PERMUTE_TABU_SEARCH_HH
+
+#include <Core/Statistics.hh>
+
+#include "BeforeScorer.hh"
+#include "Permutation.hh"
+
+namespace Permute {
+
+  // Implements tabu search (Glover, 1989) for the linear ordering problem over
+  // insert moves and, when no insert improves, block-insert moves of up to
+  // blockWidth elements.  Each move is the best admissible one, even when it
+  // worsens the score, so the search walks on from a local optimum instead of
+  // stopping there.
+  //
+  // Moving an element from position p makes it tabu: it may not move back to
+  // p or past it, and the elements it passed may not pass it back.  The
+  // tenure of each move is drawn between tenure and twice tenure moves, so
+  // that the search does not settle into a cycle of fixed length.  A tabu
+  // move is still admissible if it would beat the best score found so far
+  // (aspiration).
+  //
+  // Entry (x,r) of an n-by-n table holds the gain of insert(pi, x, r), and
+  // each row keeps its best target, as in InsertEngine.  A move that reorders
+  // positions lo through hi refills only those entries of the other rows, and
+  // the rows in that range in full, so choosing a move costs O(1) per row and
+  // keeping the table costs O(1) per changed entry.  Only the few rows of tabu
+  // elements are rescanned for their best admissible target.  Since a block
+  // gain is a difference of sums of insert gains, block moves too cost O(1)
+  // each.  The table is rebuilt every n moves, so that rounding error in the
+  // incremental sums cannot build up.
+  //
+  // Reads the cost matrix only through a PermutedCost view, so that several
+  // searches may share it from different threads.
+  class TabuSearch {
+  private:
+    // The costs in element order, which never changes.
+    PermutedCost cost_;
+    int tenure_;
+    int blockWidth_;
+    unsigned state_;
+    Permutation * pi_;
+    int n_;
+    std::vector <double> delta_;
+    std::vector <int> best_;
+    // Element e is tabu until move until_ [e], and may not return to or past
+    // position from_ [e] in direction -direction_ [e].
+    std::vector <long> until_;
+    std::vector <int> from_;
+    std::vector <int> direction_;
+    // The targets of position x that cross no tabu element the wrong way lie
+    // in [lower_ [x], upper_ [x]].
+    std::vector <int> lower_;
+    std::vector <int> upper_;
+    // Scratch sums for block moves.
+    std::vector <double> sums_;
+    double current_;
+    double bestScore_;
+    long moves_;
+    double seconds_;
+    Core::Timer timer_;
+  public:
+    TabuSearch (const BeforeCostRef & bc, int tenure, int blockWidth, unsigned seed);
+
+    // Searches from pi for the given number of moves, or until seconds of
+    // wall-clock time have passed if seconds is positive, whichever comes
+    // first.  A non-positive number of moves means no limit, in which case
+    // seconds must be positive.  Leaves the best permutation found in pi and
+    // returns its score.
+    double run (Permutation & pi, long moves, double seconds = 0.0);
+    // Returns the number of moves of the last run.
+    long moves () const { return moves_; }
+  private:
+    TabuSearch (const TabuSearch &);
+    TabuSearch & operator = (const TabuSearch &);
+    double & delta (int x, int r) { return delta_ [x * n_ + r]; }
+    double score () const;
+    void rebuild ();
+    void fill (int x);
+    void fill (int x, int lo, int hi);
+    void choose (int x);
+    void choose (int x, int lo, int hi);
+    void update (int lo, int hi);
+    void limit ();
+    bool tabu (int element) const { return until_ [element] > moves_; }
+    bool allowed (int x, int r) const;
+    bool aspires (double gain) const { return current_ + gain > bestScore_; }
+    double bestInsert (int & x, int & r);
+    double bestBlock (int & i, int & w, int & k);
+    void forbid (int first, int last, int direction);
+    bool expired ();
+  };
+}
+
+#endif//_PERMUTE_TABU_SEARCH_HH
@@ -0,0 +1,113 @@
+#include "ThreadPool.hh"
+#include <algorithm>
+
+namespace Permute {
+
+  ThreadPool::ThreadPool (int size) :
+    Core::ReferenceCounted (),
+    task_ (0),
+    next_ (0),
+    end_ (0),
+    chunk_ (1),
+    pending_ (0),
+    generation_ (0),
+    stop_ (false)
+  {
+    pthread_mutex_init (& mutex_, 0);
+    pthread_cond_init (& start_, 0);
+    pthread_cond_init (& done_, 0);
+    for (int i = 1; i < size; ++ i) {
+      pthread_t thread;
+      if (pthread_create (& thread, 0, & ThreadPool::main, this) == 0) {
+	threads_.push_back (thread);
+      }
+    }
+  }
+
+  ThreadPool::~ThreadPool () {
+    pthread_mutex_lock (& mutex_);
+    stop_ = true;
+    pthread_cond_broadcast (& start_);
+    pthread_mutex_unlock (& mutex_);
+    for (std::vector <pthread_t>::iterator t = threads_.begin (); t != threads_.end (); ++ t) {
+      pthread_join (* t, 0);
+    }
+    pthread_cond_destroy (& done_);
+    pthread_cond_destroy (& start_);
+    pthread_mutex_destroy (& mutex_);
+  }
+
+  // Publishes the task to the workers, takes part in the work, and waits for
+  // the workers to finish.  Short ranges run inline, since waking the workers
+  // costs more than the work itself.
+  void ThreadPool::run (Task & task, int begin, int end, int chunk) {
+    if (threads_.empty () || end - begin <= 1) {
+      for (int i = begin; i < end; ++ i) {
+	task.run (i);
+      }
+      return;
+    }
+    pthread_mutex_lock (& mutex_);
+    task_ = & task;
+    next_ = begin;
+    end_ = end;
+    chunk_ = chunk > 0 ? chunk : std::max (1, (end - begin) / (4 * size ()));
+    pending_ = threads_.size ();
+    ++ generation_;
+    pthread_cond_broadcast (& start_);
+    pthread_mutex_unlock (& mutex_);
+
+    work ();
+
+    pthread_mutex_lock (& mutex_);
+    while (pending_ > 0) {
+      pthread_cond_wait (& done_, & mutex_);
+    }
+    task_ = 0;
+    pthread_mutex_unlock (& mutex_);
+  }
+
+  void * ThreadPool::main (void * pool) {
+    static_cast <ThreadPool *> (pool) -> loop ();
+    return 0;
+  }
+
+  // Waits for each new generation of work until the pool is destroyed.
+  void ThreadPool::loop () {
+    unsigned seen = 0;
+    for (;;) {
+      pthread_mutex_lock (& mutex_);
+      while (generation_ == seen && ! stop_) {
+	pthread_cond_wait (& start_, & mutex_);
+      }
+      if (stop_) {
+	pthread_mutex_unlock (& mutex_);
+	return;
+      }
+      seen = generation_;
+      pthread_mutex_unlock (& mutex_);
+
+      work ();
+
+      pthread_mutex_lock (& mutex_);
+      if (-- pending_ == 0) {
+	pthread_cond_signal (& done_);
+      }
+      pthread_mutex_unlock (& mutex_);
+    }
+  }
+
+  // Claims chunks of indices until none remain.
+  void ThreadPool::work () {
+    for (;;) {
+      int begin = __sync_fetch_and_add (& next_, chunk_);
+      if (begin >= end_) {
+	return;
+      }
+      int end = std::min (begin + chunk_, end_);
+      for (int i = begin; i < end; ++ i) {
+	task_ -> run (i);
+      }
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#ifndef _PERMUTE_THREAD_POOL_HH
+#define _PERMUTE_THREAD_POOL_HH
+
+#include <pthread.h>
+#include <vector>
+#include <Core/ReferenceCounting.hh>
+
+namespace Permute {
+
+  // Runs a Task over a range of indices on a fixed set of threads.  The thread
+  // calling run participates in the work, so a pool of size n starts n - 1
+  // additional threads.  Indices are handed out dynamically in chunks, which
+  // by default are small enough to give each thread several, and run returns
+  // only after every index has been processed, which makes each call a
+  // barrier.
+  //
+  // Tasks must not copy Core::Ref handles, whose reference counts are not
+  // atomic.
+  class ThreadPool : public Core::ReferenceCounted {
+  public:
+    class Task {
+    public:
+      virtual ~Task () {}
+      virtual void run (int index) = 0;
+    };
+  private:
+    std::vector <pthread_t> threads_;
+    pthread_mutex_t mutex_;
+    pthread_cond_t start_, done_;
+    Task * task_;
+    int next_, end_, chunk_;
+    int pending_;
+    unsigned generation_;
+    bool stop_;
+  public:
+    ThreadPool (int size);
+    ~ThreadPool ();
+    int size () const { return threads_.size () + 1; }
+    void run (Task &, int begin, int end, int chunk = 0);
+  private:
+    ThreadPool (const ThreadPool &);
+    ThreadPool & operator = (const ThreadPool &);
+    static void * main (void *);
+    void loop ();
+    void work ();
+  };
+
+  typedef Core::Ref <ThreadPool> ThreadPoolRef;
+
+  /**********************************************************************/
+
+  // Adapts a functor f with f(int) to the Task interface.
+  template <class Functor>
+  class FunctorTask : public ThreadPool::Task {
+  private:
+    const Functor & f_;
+  public:
+    FunctorTask (const Functor & f) : f_ (f) {}
+    virtual void run (int index) { f_ (index); }
+  };
+
+  // Calls f(i) for each i in [begin, end), on the given pool if there is one
+  // and serially in order otherwise.  A positive chunk sets how many indices a
+  // thread claims at a time; long, uneven tasks should use 1.
+  template <class Functor>
+  void parallelFor (const ThreadPoolRef & pool, int begin, int end, const Functor & f,
+		    int chunk = 0) {
+    if (pool) {
+      FunctorTask <Functor> task (f);
+      pool -> run (task, begin, end, chunk);
+    } else {
+      for (int i = begin; i < end; ++ i) {
+	f (i);
+      }
+    }
+  }
+}
+
+#endif//_PERMUTE_THREAD_POOL_HH
@@ -29,7 +29,7 @@ public:
     std::cerr << "Reading PV: [" << LOP_FILE << "]" << std::endl;
     timer_.start ();
     PV pv;
-    if (! this -> readPV (pv)) {
+    if (! this -> readPV (pv, true)) {
       return EXIT_FAILURE;
     }
     timer_.stop ();
@@ -79,7 +79,8 @@ public:
       ConstCellRef closure (cellMapP -> epsilonClosure ());
       CellRef topCell (new StartEndCell (a, closure));
       
-      while (blockSearch (source, bc, WINDOW, a, cellMap, topCell, closure) > 0.0);
+      BlockWorkspace workspace;
+      while (blockSearch (source, bc, WINDOW, a, cellMap, topCell, closure, workspace) > 0.0);
 
       Fsa::ConstAutomatonRef
 	sentence = fsa (source, Fsa::TropicalSemiring),
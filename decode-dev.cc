@@ -18,7 +18,7 @@ public:
 	      << std::endl;
     
     Permute::PV pv;
-    if (! this -> readPV (pv)) {
+    if (! this -> readPV (pv, true)) {
       return EXIT_FAILURE;
     }
 
@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <cmath>
+
 #include "Application.hh"
+#include "BranchAndBound.hh"
 #include "Iterator.hh"
 #include "LOPChart.hh"
 #include "Loss.hh"
@@ -8,19 +12,33 @@ APPLICATION
 
 using namespace Permute;
 
-// Decodes the input using a PV.
+// Decodes the input using a PV.  If --exact is true, also solves each
+// sentence by branch and bound and reports how often, and by how much, the
+// search falls short of the optimum.  --exact-nodes bounds each search, past
+// which its result is not certified.
 class DecodePV : public Application {
+private:
+  static Core::ParameterBool paramExact;
+  bool EXACT;
+  static Core::ParameterInt paramExactNodes;
+  int EXACT_NODES;
 public:
   DecodePV () :
     Application ("decode-pv") {}
 
+  virtual void getParameters () {
+    Application::getParameters ();
+    EXACT = paramExact (config);
+    EXACT_NODES = paramExactNodes (config);
+  }
+
   int main (const std::vector <std::string> & args) {
     this -> getParameters ();
 
     std::cerr << "ITERATE_SEARCH: " << Boolean (ITERATE_SEARCH) << std::endl;
 
     PV pv;
-    if (! this -> readPV (pv)) {
+    if (! this -> readPV (pv, true)) {
       return EXIT_FAILURE;
     }
 
@@ -30,6 +48,8 @@ public:
     ParseControllerRef controller = this -> parseController (source);
 
     Loss loss;
+    int sentences = 0, errors = 0, uncertified = 0;
+    double gap = 0.0;
 
     std::istream & in = this -> input ();
     std::ostream & out = this -> output ();
@@ -45,14 +65,14 @@ public:
       SumBeforeCostRef bc (new SumBeforeCost (source.size (), "decode-pv"));
       ScorerRef scorer = this -> sumBeforeScorer (bc, pv, source, pos, parents, labels);
 //       ChartRef chart = factory -> chart (source, WINDOW);
-      LOPChart chart (source, WINDOW);
+      OneBestChartRef chart = this -> oneBestChart (source);
 
       double best_score = scorer -> score (source);
       do {
 // 	Chart::permute (chart, controller, scorer);
 // 	ConstPathRef bestPath = chart -> getBestPath ();
-	chart.permute (controller, scorer);
-	ConstPathRef bestPath = chart.getBestPath ();
+	chart -> permute (controller, scorer);
+	ConstPathRef bestPath = chart -> getBestPath ();
 	source.changed (false);
 	if (bestPath -> getScore () > best_score) {
 	  best_score = bestPath -> getScore ();
@@ -60,12 +80,34 @@ public:
 	}
       } while (ITERATE_SEARCH && source.changed ());
 
+      if (EXACT) {
+	Permutation optimal (source);
+	BeforeCostRef cost (bc);
+	BranchAndBound bb (cost, this -> threadPool (), EXACT_NODES);
+	double optimum = bb.solve (optimal);
+	++ sentences;
+	if (! bb.optimal ()) {
+	  ++ uncertified;
+	}
+	if (optimum > best_score + 1e-9 * std::max (1.0, std::fabs (optimum))) {
+	  ++ errors;
+	  gap += optimum - best_score;
+	}
+      }
+
       out << source << std::endl;
       loss.add (target, source);
     }
 
     std::cerr << loss << std::endl;
+    if (EXACT) {
+      std::cerr << "Search errors: " << errors << " of " << sentences
+		<< " (total gap " << gap << ", " << uncertified << " not certified)" << std::endl;
+    }
 
     return EXIT_SUCCESS;
   }
 } app;
+
+Core::ParameterBool DecodePV::paramExact ("exact", "Solve each sentence by branch and bound and count search errors", false);
+Core::ParameterInt DecodePV::paramExactNodes ("exact-nodes", "The number of branch and bound nodes after which --exact gives up (0 for no limit)", 10000000, 0);
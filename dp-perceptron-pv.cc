@@ -67,25 +67,9 @@ public:
 	}
 
 	// Adds the feature counts of target.
-	for (Permutation::const_iterator i = target.begin ();
-	     i != -- target.end (); ++ i) {
-	  for (Permutation::const_iterator j = i + 1;
-	       j != target.end (); ++ j) {
-	    if (* i < * j) {
-	      (* bc) (* i, * j).add (LEARNING_RATE / t);
-	    }
-	  }
-	}
+	bc -> add (target, LEARNING_RATE / t);
 	// Subtracts the feature counts of source.
-	for (Permutation::const_iterator i = source.begin ();
-	     i != -- source.end (); ++ i) {
-	  for (Permutation::const_iterator j = i + 1;
-	       j != source.end (); ++ j) {
-	    if (* i < * j) {
-	      (* bc) (* i, * j).add (- LEARNING_RATE / t);
-	    }
-	  }
-	}
+	bc -> add (source, - LEARNING_RATE / t);
       }
 
       if (! DEBUG) {
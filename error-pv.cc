@@ -77,21 +77,9 @@ public:
       } while (ITERATE_SEARCH && source.changed ());
 
       // Add the feature counts of target.
-      for (Permutation::const_iterator i = target.begin (); i != -- target.end (); ++ i) {
-	for (Permutation::const_iterator j = i + 1; j != target.end (); ++ j) {
-	  if (* i < * j) {
-	    (* fbc) (* i, * j).add (1.0);
-	  }
-	}
-      }
+      fbc -> add (target, 1.0);
       // Subtract the feature counts of source.
-      for (Permutation::const_iterator i = source.begin (); i != -- source.end (); ++ i) {
-	for (Permutation::const_iterator j = i + 1; j != source.end (); ++ j) {
-	  if (* i < * j) {
-	    (* fbc) (* i, * j).add (- 1.0);
-	  }
-	}
-      }
+      fbc -> add (source, - 1.0);
     }
 
     this -> writePV (features);
@@ -1,23 +1,39 @@
 #include "Application.hh"
 #include "BeforeScorer.hh"
+#include "BranchAndBound.hh"
 #include "LinearOrdering.hh"
 #include "LOPChart.hh"
+#include "Portfolio.hh"
 
 APPLICATION
 
 using namespace Permute;
 
+static const char * NEIGHBORHOOD_NAMES [Portfolio::NEIGHBORHOODS] = {
+  "LSF", "Block", "Q2", "Cubic"
+};
+
 // Runs some combination of LS_f, Q(2), and Cubic neighborhood local search,
 // starting with the most efficient method specified and invoking the less
 // efficient, larger, neighborhoods only when the more efficient ones get
 // stuck.  If --iterate is true, runs only a single step of Q(2) or Cubic when
-// necessary and starts again on LS_f.
+// necessary and starts again on LS_f.  If --exact is true, first solves each
+// matrix by branch and bound and reports the gap of every restart.
+//
+// If --portfolio is true, instead lets Portfolio choose among LS_f, block_lsf
+// (with a positive --block-width), Q(2) and Cubic by their improvement per
+// CPU-second so far, and reports each neighborhood's steps, total gain and
+// time.  With --concurrent, the neighborhoods run side by side on the thread
+// pool, and the time is wall-clock time rather than user time.
 class Hybrid : public Application {
 private:
-  static Core::ParameterBool paramLSf, paramQ2, paramCubic, paramIterate;
-  bool LSF, Q2, CUBIC, ITERATE;
-  static Core::ParameterInt paramRestart;
-  int RESTART;
+  static Core::ParameterBool paramLSf, paramQ2, paramCubic, paramIterate, paramExact,
+    paramPortfolio, paramConcurrent;
+  bool LSF, Q2, CUBIC, ITERATE, EXACT, PORTFOLIO, CONCURRENT;
+  static Core::ParameterInt paramRestart, paramBlockWidth, paramExactNodes;
+  int RESTART, BLOCK_WIDTH, EXACT_NODES;
+  static Core::ParameterFloat paramTimeLimit;
+  double TIME_LIMIT;
   Core::Timer timer;
 public:
   Hybrid () :
@@ -31,6 +47,12 @@ public:
     CUBIC = paramCubic (config);
     ITERATE = paramIterate (config);
     RESTART = paramRestart (config);
+    EXACT = paramExact (config);
+    EXACT_NODES = paramExactNodes (config);
+    PORTFOLIO = paramPortfolio (config);
+    CONCURRENT = paramConcurrent (config);
+    BLOCK_WIDTH = paramBlockWidth (config);
+    TIME_LIMIT = paramTimeLimit (config);
   }
 
   int main (const std::vector <std::string> & args) {
@@ -50,55 +72,82 @@ public:
       integerPermutation (pi, bcr -> size ());
 
       ScorerRef gamma (new BeforeScorer (bcr, pi));
+      PermutedCost cost (bcr);
       LOPChart chart (pi);
 
+      double optimum = 0.0;
+      if (EXACT) {
+	BranchAndBound bb (bcr, this -> threadPool (), EXACT_NODES);
+	optimum = bb.solve (pi);
+	std::cerr << "Optimum \"" << bcr -> name () << "\" " << optimum << ' '
+		  << bb.nodes () << (bb.optimal () ? "" : " (not certified)") << std::endl;
+      }
+
+      Portfolio portfolio (bcr, this -> threadPool (), CONCURRENT, BLOCK_WIDTH);
+      portfolio.enable (Portfolio::LSF, LSF);
+      portfolio.enable (Portfolio::QUADRATIC, Q2);
+      portfolio.enable (Portfolio::CUBIC, CUBIC);
+
       for (int restart = 0; restart < RESTART; ++ restart) {
 	timer.start ();
 	pi.randomize ();
 	// Counts the total number of iterations.
 	int iterations = 0;
 	double score;
-	do {
-	  if (LSF) {
-	    for (++ iterations; visit (pi, bcr) > 0; ++ iterations);
-	  }
-	  std::cerr << "LSF: " << iterations << " ";
-	  score = gamma -> score (pi);
-	  if (Q2) {
-	    do {
-	      ++ iterations;
-	      chart.permute (qpc, gamma);
-	      const ConstPathRef & bestPath = chart.getBestPath ();
-	      pi.changed (false);
-	      if (bestPath -> getScore () > score) {
-		score = bestPath -> getScore ();
-		pi.reorder (bestPath);
-	      }
-	    } while (pi.changed () && ! ITERATE);
-	    std::cerr << "Q2: " << iterations << " ";
-	  }
-	  // If Q2 && ITERATE && pi.changed () then cubic doesn't run yet.
-	  if (CUBIC && !(Q2 && ITERATE && pi.changed ())) {
-	    do {
-	      ++ iterations;
-	      chart.permute (cpc, gamma);
-	      const ConstPathRef & bestPath = chart.getBestPath ();
-	      pi.changed (false);
-	      if (bestPath -> getScore () > score) {
-		score = bestPath -> getScore ();
-		pi.reorder (bestPath);
-	      }
-	    } while (pi.changed () && ! ITERATE);
-	    std::cerr << "Cubic: " << iterations << " ";
+	if (PORTFOLIO) {
+	  score = portfolio.run (pi, TIME_LIMIT);
+	  iterations = portfolio.steps ();
+	  for (int n = 0; n < Portfolio::NEIGHBORHOODS; ++ n) {
+	    const Portfolio::Record & record = portfolio.record (Portfolio::Neighborhood (n));
+	    std::cerr << NEIGHBORHOOD_NAMES [n] << ": " << record.steps << ' ' << record.gain << ' ' << record.time << " ";
 	  }
-	} while (ITERATE && pi.changed ());
+	} else {
+	  do {
+	    if (LSF) {
+	      cost.assign (pi);
+	      for (++ iterations; visit (pi, cost) > 0; ++ iterations);
+	    }
+	    std::cerr << "LSF: " << iterations << " ";
+	    score = gamma -> score (pi);
+	    if (Q2) {
+	      do {
+		++ iterations;
+		chart.permute (qpc, gamma);
+		const ConstPathRef & bestPath = chart.getBestPath ();
+		pi.changed (false);
+		if (bestPath -> getScore () > score) {
+		  score = bestPath -> getScore ();
+		  pi.reorder (bestPath);
+		}
+	      } while (pi.changed () && ! ITERATE);
+	      std::cerr << "Q2: " << iterations << " ";
+	    }
+	    // If Q2 && ITERATE && pi.changed () then cubic doesn't run yet.
+	    if (CUBIC && !(Q2 && ITERATE && pi.changed ())) {
+	      do {
+		++ iterations;
+		chart.permute (cpc, gamma);
+		const ConstPathRef & bestPath = chart.getBestPath ();
+		pi.changed (false);
+		if (bestPath -> getScore () > score) {
+		  score = bestPath -> getScore ();
+		  pi.reorder (bestPath);
+		}
+	      } while (pi.changed () && ! ITERATE);
+	      std::cerr << "Cubic: " << iterations << " ";
+	    }
+	  } while (ITERATE && pi.changed ());
+	}
 	timer.stop ();
+	if (EXACT) {
+	  std::cerr << "Gap: " << optimum - score;
+	}
 	std::cerr << std::endl;
 	std::cout << index ++ << ' '
 		  << bcr -> name () << ' '
 		  << score << ' '
 		  << iterations << ' '
-		  << timer.user () << std::endl;
+		  << (PORTFOLIO && CONCURRENT ? timer.elapsed () : timer.user ()) << std::endl;
       }
     }
     return EXIT_SUCCESS;
@@ -109,4 +158,10 @@ Core::ParameterBool Hybrid::paramLSf ("lsf", "Use the LS_f local search method",
 Core::ParameterBool Hybrid::paramQ2 ("q2", "Use the Q(2) quadratic-time VLSN", true);
 Core::ParameterBool Hybrid::paramCubic ("cubic", "Use the cubic-time VLSN", true);
 Core::ParameterBool Hybrid::paramIterate ("iterate", "Run a single step of Q(2)/Cubic and restart LS_f", true);
+Core::ParameterBool Hybrid::paramExact ("exact", "Solve each matrix by branch and bound and report the gap", false);
+Core::ParameterInt Hybrid::paramExactNodes ("exact-nodes", "The number of branch and bound nodes after which --exact gives up (0 for no limit)", 10000000, 0);
 Core::ParameterInt Hybrid::paramRestart ("restart", "The number of random restarts", 100, 1);
+Core::ParameterBool Hybrid::paramPortfolio ("portfolio", "Schedule the neighborhoods by their rate of improvement", false);
+Core::ParameterBool Hybrid::paramConcurrent ("concurrent", "Run the portfolio's neighborhoods side by side on the thread pool", false);
+Core::ParameterInt Hybrid::paramBlockWidth ("block-width", "The maximum width of block_lsf in the portfolio (0 to leave it out)", 0, 0);
+Core::ParameterFloat Hybrid::paramTimeLimit ("time-limit", "The wall-clock seconds of each portfolio run (0 for no limit)", 0.0, 0.0);
@@ -60,7 +60,7 @@ public:
 
     timer_.start ("Reading PV: ", LOP_FILE);
     PV pv;
-    if (! this -> readPV (pv)) {
+    if (! this -> readPV (pv, true)) {
       return EXIT_FAILURE;
     }
     timer_.stop ("Reading PV: ", LOP_FILE);
@@ -50,7 +50,7 @@ public:
 
       SumBeforeCostRef bc (new SumBeforeCost (source.size (), "LikelihoodPV"));
       this -> sumBeforeCost (bc, pv, source, pos);
-      GradientScorer scorer (bc, target);
+      GradientScorer scorer (bc, target, this -> scorerLayout ());
       double numerator = scorer.score (target);
 
       GradientChart chart (target);
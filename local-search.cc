@@ -1,21 +1,32 @@
 // Roy W. Tromble
 // 31 October 2007
 
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include <cstdlib>
+#include <memory>
+
 #include "Application.hh"
 #include "BeforeScorer.hh"
+#include "Iterator.hh"
+#include "IteratedLocalSearch.hh"
 #include "LinearOrdering.hh"
+#include "TabuSearch.hh"
 
 APPLICATION
 
 using namespace Permute;
 
-class SearchFunctor : public std::binary_function<Permutation &, const BeforeCostRef &, double> {
+class SearchFunctor : public std::binary_function<Permutation &, PermutedCost &, double> {
 public:
   virtual ~SearchFunctor () {}
+  // Returns a copy for use by one restart, since restarts run side by side.
+  virtual SearchFunctor * clone () const = 0;
   virtual result_type operator () (first_argument_type a1, second_argument_type a2) = 0;
 };
 
-typedef double (* SearchFunction) (Permutation &, const BeforeCostRef &);
+typedef double (* SearchFunction) (Permutation &, PermutedCost &);
 class SearchFunctionAdapter : public SearchFunctor {
 private:
   SearchFunction fun_;
@@ -23,54 +34,175 @@ public:
   SearchFunctionAdapter (SearchFunction fun) :
     fun_ (fun)
   {}
+  virtual SearchFunctionAdapter * clone () const {
+    return new SearchFunctionAdapter (fun_);
+  }
   virtual result_type operator () (first_argument_type a1, second_argument_type a2) {
     return fun_ (a1, a2);
   }
 };
 
+// Keeps the deltas of block_lsf from one iteration to the next.
 class BlockLSf : public SearchFunctor {
 private:
   int block_width_;
+  BlockWorkspace workspace_;
 public:
   BlockLSf (int block_width) :
     block_width_ (block_width)
   {}
+  virtual BlockLSf * clone () const {
+    return new BlockLSf (block_width_);
+  }
   virtual result_type operator () (first_argument_type a1, second_argument_type a2) {
-    return block_lsf (a1, a2, block_width_);
+    return block_lsf (a1, a2, block_width_, workspace_);
   }
 };
 
+// Returns the user time of the calling thread in seconds, so that restarts
+// running side by side are timed separately.
+double threadUserTime () {
+  struct rusage usage;
+  getrusage (RUSAGE_THREAD, & usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+}
+
+// Shuffles with a generator private to one restart.  Each restart seeds its own
+// generator from its job number, so the starting permutations, and hence the
+// results, do not depend on the number of threads or on which thread runs
+// which restart.
+class RestartRandom {
+private:
+  unsigned state_;
+public:
+  RestartRandom (int job) :
+    state_ (2654435761u * (job + 1))
+  {}
+  int operator () (int n) {
+    return rand_r (& state_) % n;
+  }
+};
+
+// The cost matrix of one LOLIB file, and the best result that any of its
+// restarts has reached so far.
+class Instance {
+public:
+  BeforeCostRef cost;
+  double best;
+  std::vector <size_t> order;
+  Instance (const BeforeCostRef & cost) :
+    cost (cost),
+    best (Core::Type <double>::min),
+    order ()
+  {}
+};
+
+// An improvement of the best score of one iterated local search.
+class Checkpoint {
+public:
+  double score;
+  int iterations;
+  double time;
+  Checkpoint (double score, int iterations, double time) :
+    score (score),
+    iterations (iterations),
+    time (time)
+  {}
+};
+
+// The outcome of one (instance, restart) job.
+class Outcome {
+public:
+  double score;
+  int iterations;
+  double time;
+  std::vector <Checkpoint> checkpoints;
+  bool done;
+  Outcome () :
+    score (0.0),
+    iterations (0),
+    time (0.0),
+    checkpoints (),
+    done (false)
+  {}
+};
+
 // Runs Schiavinotto & Stützle's (2004) local search (LS_f).  Reports the score
 // and the time for each random restart.
+//
+// With --threads, every (instance, restart) pair is a separate job, and the
+// threads of the pool claim jobs one at a time until none remain.  Each job
+// builds its own permutation, cost view and random generator, and only reads
+// the shared cost matrices.  Lines are printed in job order as soon as every
+// earlier job has finished, so the output is the same for any number of
+// threads.
+//
+// The engine_lsf and engine_insert methods run LS_f and greedy insert search
+// on an InsertEngine, which keeps the insert deltas between moves.
+//
+// With --time-limit, each restart instead runs iterated local search for that
+// many seconds of wall-clock time, using LS_f, followed by block_lsf when that
+// is the search method.  Each improvement of a restart's best score is printed
+// in the same format as the other lines, with the number of local searches and
+// the elapsed time so far, so search-quality can read them directly.  A
+// restart keeps its lines until it finishes, so they too are printed in job
+// order.
+//
+// The tabu method instead runs tabu search for --tabu-moves moves, or until
+// --time-limit expires if that comes first, and reports the best permutation
+// it passed through, with the number of moves as the iterations.
 class LocalSearch : public Application {
 private:
   static Core::ParameterBool paramRandom;
   static Core::ParameterBool paramHybrid;
   bool RANDOM, HYBRID;
-  static Core::ParameterInt paramRestart, paramBlockWidth;
-  int RESTART, BLOCK_WIDTH;
+  static Core::ParameterInt paramRestart, paramBlockWidth, paramKickWidth,
+    paramTabuTenure, paramTabuBlockWidth, paramTabuMoves;
+  int RESTART, BLOCK_WIDTH, KICK_WIDTH, TABU_TENURE, TABU_BLOCK_WIDTH, TABU_MOVES;
+  static Core::ParameterFloat paramTimeLimit;
+  double TIME_LIMIT;
+  static Core::Choice perturbationChoice, acceptanceChoice;
+  static Core::ParameterChoice paramPerturbation, paramAcceptance;
+  IteratedLocalSearch::Perturbation PERTURBATION;
+  IteratedLocalSearch::Acceptance ACCEPTANCE;
 
   enum SearchMethod {
     search_method_lsf,
     search_method_insert,
     search_method_adjacent,
-    search_method_block_lsf
+    search_method_block_lsf,
+    search_method_engine_lsf,
+    search_method_engine_insert,
+    search_method_tabu
   };
   static Core::Choice searchMethodChoice;
   static Core::ParameterChoice paramSearchMethod;
   SearchMethod SEARCH_METHOD;
-  
-  Core::Timer timer;
+
+  SearchFunctor * searchFunction_;
+  std::vector <Instance> instances_;
+  std::vector <Outcome> outcomes_;
+  int printed_;
+  pthread_mutex_t mutex_;
 public:
   LocalSearch () :
-    Application ("local-search")
-  {}
+    Application ("local-search"),
+    searchFunction_ (0),
+    printed_ (0)
+  {
+    pthread_mutex_init (& mutex_, 0);
+  }
+
+  ~LocalSearch () {
+    delete searchFunction_;
+    pthread_mutex_destroy (& mutex_);
+  }
 
   SearchFunctor * getSearchFunction () const {
     switch (SEARCH_METHOD) {
-    case search_method_lsf: return new SearchFunctionAdapter (visit);
-    case search_method_insert: return new SearchFunctionAdapter (search_insert);
-    case search_method_adjacent: return new SearchFunctionAdapter (search_adjacent);
+    case search_method_lsf: return new SearchFunctionAdapter (static_cast <SearchFunction> (visit));
+    case search_method_insert: return new SearchFunctionAdapter (static_cast <SearchFunction> (search_insert));
+    case search_method_adjacent: return new SearchFunctionAdapter (static_cast <SearchFunction> (search_adjacent));
     case search_method_block_lsf: return new BlockLSf (BLOCK_WIDTH);
     default: return 0;
     }
@@ -83,6 +215,13 @@ public:
     RESTART = paramRestart (config);
     BLOCK_WIDTH = paramBlockWidth (config);
     SEARCH_METHOD = SearchMethod (paramSearchMethod (config));
+    TIME_LIMIT = paramTimeLimit (config);
+    PERTURBATION = IteratedLocalSearch::Perturbation (paramPerturbation (config));
+    ACCEPTANCE = IteratedLocalSearch::Acceptance (paramAcceptance (config));
+    KICK_WIDTH = paramKickWidth (config);
+    TABU_TENURE = paramTabuTenure (config);
+    TABU_BLOCK_WIDTH = paramTabuBlockWidth (config);
+    TABU_MOVES = paramTabuMoves (config);
   }
 
   virtual void printParameterDescription (std::ostream & out) const {
@@ -91,57 +230,164 @@ public:
     paramRestart.printShortHelp (out);
     paramSearchMethod.printShortHelp (out);
     paramBlockWidth.printShortHelp (out);
+    paramTimeLimit.printShortHelp (out);
+    paramPerturbation.printShortHelp (out);
+    paramAcceptance.printShortHelp (out);
+    paramKickWidth.printShortHelp (out);
+    paramTabuTenure.printShortHelp (out);
+    paramTabuBlockWidth.printShortHelp (out);
+    paramTabuMoves.printShortHelp (out);
   }
 
-  int main (const std::vector <std::string> & args) {
-    this -> getParameters ();
+  // Whether restarts run iterated local search, which reports checkpoints
+  // rather than one line.
+  bool iterated () const {
+    return TIME_LIMIT > 0.0 && SEARCH_METHOD != search_method_tabu;
+  }
 
-    SearchFunctor & search_function = * getSearchFunction ();
+  // Binds restart to the application for use with parallelFor.
+  class Restart {
+  private:
+    LocalSearch & search_;
+  public:
+    Restart (LocalSearch & search) : search_ (search) {}
+    void operator () (int job) const {
+      search_.restart (job);
+    }
+  };
 
-    std::cout << "Name Score Iterations Time" << std::endl;
-    int index = 0;
-    for (std::vector <std::string>::const_iterator it = args.begin (); it != args.end (); ++ it) {
-      this -> LOLIB_FILE = * it;
-      // Reads the LOLIB cost matrix.
-      BeforeCostRef bc (this -> lolib ());
+  // Records the checkpoints of one restart's iterated local search.
+  class Checkpoints : public IteratedLocalSearch {
+  public:
+    std::vector <Checkpoint> checkpoints;
+    Checkpoints (LocalSearch & search, int job, const BeforeCostRef & bc) :
+      IteratedLocalSearch (bc, search.PERTURBATION, search.ACCEPTANCE, search.KICK_WIDTH,
+			   search.SEARCH_METHOD == search_method_block_lsf ? search.BLOCK_WIDTH : 0,
+			   2654435761u * (job + 1) + 1),
+      checkpoints ()
+    {}
+  protected:
+    virtual void checkpoint (double time, double score) {
+      checkpoints.push_back (Checkpoint (score, iterations (), time));
+    }
+  };
 
-      // Constructs the permutation.
-      std::stringstream str;
-      for (int i = 0; i < bc -> size (); ++ i) {
-	str << i << ' ';
-      }
-      Permutation pi;
-      readPermutationWithAlphabet (pi, str);
-
-      for (int i = 0; i < RESTART; ++ i) {
-	timer.start ();
-	if (RANDOM) {
-	  pi.identity ();
-	  pi.randomize ();
-	}
+  // Runs one restart of one instance.  Reads the instance only through a
+  // const reference, since Core::Ref counts are not safe to change from
+  // several threads.
+  void restart (int job) {
+    Instance & instance = instances_ [job / RESTART];
+    const BeforeCostRef & bc = instance.cost;
+    double start = threadUserTime ();
 
+    Permutation pi;
+    integerPermutation (pi, bc -> size ());
+    if (RANDOM) {
+      RestartRandom random (job);
+      std::random_shuffle (pi.begin (), pi.end (), random);
+    }
 #ifndef NDEBUG
-	std::cerr << pi << std::endl;
+    std::cerr << delimit (pi.begin (), pi.end (), " ") << std::endl;
 #endif
-	int iterations = 1;
-	if (HYBRID) {
-	  for (; visit (pi, bc) > 0; ++ iterations);
-	}
-	for (; search_function (pi, bc) > 0; ++ iterations) {
+    int iterations = 1;
+    double score;
+    std::vector <Checkpoint> checkpoints;
+    if (SEARCH_METHOD == search_method_tabu) {
+      TabuSearch search (bc, TABU_TENURE, TABU_BLOCK_WIDTH, 2654435761u * (job + 1) + 1);
+      score = search.run (pi, TABU_MOVES, TIME_LIMIT);
+      iterations = search.moves ();
+    } else if (TIME_LIMIT > 0.0) {
+      Checkpoints search (* this, job, bc);
+      score = search.run (pi, TIME_LIMIT);
+      iterations = search.iterations ();
+      checkpoints.swap (search.checkpoints);
+    } else if (searchFunction_) {
+      std::auto_ptr <SearchFunctor> search (searchFunction_ -> clone ());
+      PermutedCost cost (bc, pi);
+      if (HYBRID) {
+	for (; visit (pi, cost) > 0; ++ iterations);
+      }
+      for (; (* search) (pi, cost) > 0; ++ iterations) {
 #ifndef NDEBUG
-	  std::cerr << pi << std::endl;
+	std::cerr << delimit (pi.begin (), pi.end (), " ") << std::endl;
 #endif
+      }
+      score = cost.score ();
+    } else {
+      InsertEngine engine (pi, bc);
+      if (HYBRID || SEARCH_METHOD == search_method_engine_lsf) {
+	for (; engine.visit () > 0; ++ iterations);
+      }
+      if (SEARCH_METHOD == search_method_engine_insert) {
+	for (; engine.searchInsert () > 0; ++ iterations);
+      }
+      score = engine.score ();
+    }
+    double time = threadUserTime () - start;
+
+    pthread_mutex_lock (& mutex_);
+    Outcome & outcome = outcomes_ [job];
+    outcome.score = score;
+    outcome.iterations = iterations;
+    outcome.time = time;
+    outcome.checkpoints.swap (checkpoints);
+    outcome.done = true;
+    if (score > instance.best) {
+      instance.best = score;
+      instance.order.assign (pi.begin (), pi.end ());
+    }
+    print ();
+    pthread_mutex_unlock (& mutex_);
+  }
+
+  // Prints every finished outcome that follows the last printed one: the
+  // checkpoints of an iterated local search, or else the final score.  Called
+  // with mutex_ held.
+  void print () {
+    for (; printed_ < outcomes_.size () && outcomes_ [printed_].done; ++ printed_) {
+      const Outcome & outcome = outcomes_ [printed_];
+      if (iterated ()) {
+	for (std::vector <Checkpoint>::const_iterator it = outcome.checkpoints.begin ();
+	     it != outcome.checkpoints.end (); ++ it) {
+	  print (printed_, it -> score, it -> iterations, it -> time);
 	}
-	double score = bc -> score (pi);
+      } else {
+	print (printed_, outcome.score, outcome.iterations, outcome.time);
+      }
+    }
+  }
+
+  // Prints one line of output for the given job.
+  void print (int job, double score, int iterations, double time) {
+    std::cout << job << ' '
+	      << '"' << instances_ [job / RESTART].cost -> name () << '"' << ' '
+	      << score << ' '
+	      << iterations << ' '
+	      << time << std::endl;
+  }
+
+  int main (const std::vector <std::string> & args) {
+    this -> getParameters ();
 
-	timer.stop ();
+    searchFunction_ = getSearchFunction ();
 
-	std::cout << index ++ << ' '
-		  << '"' << bc -> name () << '"' << ' '
-		  << score << ' '
-		  << iterations << ' '
-		  << timer.user () << std::endl;
+    // Reads every LOLIB cost matrix up front, on this thread.
+    for (std::vector <std::string>::const_iterator it = args.begin (); it != args.end (); ++ it) {
+      this -> LOLIB_FILE = * it;
+      BeforeCostRef bc (this -> lolib ());
+      if (! bc) {
+	return EXIT_FAILURE;
       }
+      instances_.push_back (Instance (bc));
+    }
+    outcomes_.assign (instances_.size () * RESTART, Outcome ());
+
+    std::cout << "Name Score Iterations Time" << std::endl;
+    parallelFor (this -> threadPool (), 0, outcomes_.size (), Restart (* this), 1);
+
+    for (std::vector <Instance>::const_iterator it = instances_.begin (); it != instances_.end (); ++ it) {
+      std::cerr << "Best \"" << it -> cost -> name () << "\" " << it -> best << " : "
+		<< delimit (it -> order.begin (), it -> order.end (), " ") << std::endl;
     }
 
     return EXIT_SUCCESS;
@@ -152,10 +398,33 @@ Core::ParameterBool LocalSearch::paramRandom ("random", "start at a random permu
 Core::ParameterBool LocalSearch::paramHybrid ("hybrid", "use LS_f before switching to a different method", false);
 Core::ParameterInt LocalSearch::paramRestart ("restart", "the number of restarts", 100, 1);
 Core::ParameterInt LocalSearch::paramBlockWidth ("block-width", "the maximum width to consider during block_lsf", Core::Type <int>::max, 1);
+Core::ParameterInt LocalSearch::paramKickWidth ("kick-width", "the maximum width of a perturbation during iterated local search", 8, 1);
+Core::ParameterInt LocalSearch::paramTabuTenure ("tabu-tenure", "the least number of moves for which a moved element stays tabu", 10, 0);
+Core::ParameterInt LocalSearch::paramTabuBlockWidth ("tabu-block-width", "the maximum width of block moves during tabu search (1 for insert moves only)", 4, 1);
+Core::ParameterInt LocalSearch::paramTabuMoves ("tabu-moves", "the number of tabu search moves for each restart", 100000, 1);
+Core::ParameterFloat LocalSearch::paramTimeLimit ("time-limit", "the wall-clock seconds of iterated local search, or at most of tabu search, for each restart (0 for a single descent)", 0.0, 0.0);
+Core::Choice LocalSearch::perturbationChoice ("block", IteratedLocalSearch::PERTURB_BLOCK,
+					      "double-insert", IteratedLocalSearch::PERTURB_DOUBLE_INSERT,
+					      CHOICE_END);
+Core::ParameterChoice LocalSearch::paramPerturbation ("perturbation",
+						      & LocalSearch::perturbationChoice,
+						      "the perturbation of iterated local search",
+						      IteratedLocalSearch::PERTURB_BLOCK);
+Core::Choice LocalSearch::acceptanceChoice ("better", IteratedLocalSearch::ACCEPT_BETTER,
+					    "equal", IteratedLocalSearch::ACCEPT_EQUAL,
+					    "always", IteratedLocalSearch::ACCEPT_ALWAYS,
+					    CHOICE_END);
+Core::ParameterChoice LocalSearch::paramAcceptance ("acceptance",
+						    & LocalSearch::acceptanceChoice,
+						    "the acceptance criterion of iterated local search",
+						    IteratedLocalSearch::ACCEPT_EQUAL);
 Core::Choice LocalSearch::searchMethodChoice ("lsf", search_method_lsf,
 					      "insert", search_method_insert,
 					      "adjacent", search_method_adjacent,
 					      "block_lsf", search_method_block_lsf,
+					      "engine_lsf", search_method_engine_lsf,
+					      "engine_insert", search_method_engine_insert,
+					      "tabu", search_method_tabu,
 					      CHOICE_END);
 Core::ParameterChoice LocalSearch::paramSearchMethod ("search-method",
 						      & LocalSearch::searchMethodChoice,
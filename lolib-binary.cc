@@ -0,0 +1,42 @@
+#include <fstream>
+
+#include "Application.hh"
+#include "BeforeScorer.hh"
+
+APPLICATION
+
+using namespace Permute;
+
+// Converts each LOLIB matrix file named on the command line to the binary
+// format, which local-search, becker, mcmc, hybrid and the other --lolib-file
+// tools map into memory instead of parsing.  Writes file.bin next to each
+// input file.
+class LOLIBBinary : public Application {
+public:
+  LOLIBBinary () :
+    Application ("lolib-binary")
+  {}
+
+  int main (const std::vector <std::string> & args) {
+    this -> getParameters ();
+
+    for (std::vector <std::string>::const_iterator it = args.begin (); it != args.end (); ++ it) {
+      this -> LOLIB_FILE = * it;
+      BeforeCostRef bc (this -> lolib ());
+      if (! bc) {
+	return EXIT_FAILURE;
+      }
+      std::string file = * it + ".bin";
+      std::ofstream out (file.c_str (), std::ios::binary);
+      if (! writeBinaryLOLIB (out, * bc)) {
+	std::cerr << "Could not write binary LOLIB file: " << file << std::endl;
+	return EXIT_FAILURE;
+      }
+      std::cout << '"' << bc -> name () << '"' << ' '
+		<< bc -> size () << ' '
+		<< file << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+  }
+} app;
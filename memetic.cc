@@ -0,0 +1,96 @@
+#include "Application.hh"
+#include "BeforeScorer.hh"
+#include "Iterator.hh"
+#include "Memetic.hh"
+
+APPLICATION
+
+using namespace Permute;
+
+// Runs the memetic algorithm on each LOLIB matrix named on the command line,
+// --restart times with different seeds.  Prints one line per run in the same
+// format as local-search, so that the two can be compared directly with
+// search-quality, with the number of generations as the iterations.  Since
+// --threads improves the children of each generation in parallel, the time is
+// wall-clock time rather than user time.
+class MemeticSearch : public Application {
+private:
+  static Core::ParameterInt paramRestart, paramPopulation, paramChildren,
+    paramGenerations, paramBlockWidth, paramPatience;
+  int RESTART, POPULATION, CHILDREN, GENERATIONS, BLOCK_WIDTH, PATIENCE;
+  static Core::ParameterFloat paramTimeLimit;
+  double TIME_LIMIT;
+public:
+  MemeticSearch () :
+    Application ("memetic")
+  {}
+
+  virtual void getParameters () {
+    Application::getParameters ();
+    RESTART = paramRestart (config);
+    POPULATION = paramPopulation (config);
+    CHILDREN = paramChildren (config);
+    GENERATIONS = paramGenerations (config);
+    BLOCK_WIDTH = paramBlockWidth (config);
+    PATIENCE = paramPatience (config);
+    TIME_LIMIT = paramTimeLimit (config);
+  }
+
+  virtual void printParameterDescription (std::ostream & out) const {
+    paramRestart.printShortHelp (out);
+    paramPopulation.printShortHelp (out);
+    paramChildren.printShortHelp (out);
+    paramGenerations.printShortHelp (out);
+    paramBlockWidth.printShortHelp (out);
+    paramPatience.printShortHelp (out);
+    paramTimeLimit.printShortHelp (out);
+  }
+
+  int main (const std::vector <std::string> & args) {
+    this -> getParameters ();
+
+    std::cout << "Name Score Iterations Time" << std::endl;
+    int job = 0;
+    for (std::vector <std::string>::const_iterator it = args.begin (); it != args.end (); ++ it) {
+      this -> LOLIB_FILE = * it;
+      BeforeCostRef bc (this -> lolib ());
+      if (! bc) {
+	return EXIT_FAILURE;
+      }
+
+      Permutation pi;
+      integerPermutation (pi, bc -> size ());
+      double best = Core::Type <double>::min;
+      std::vector <size_t> order;
+      for (int r = 0; r < RESTART; ++ r, ++ job) {
+	Memetic memetic (bc, this -> threadPool (), POPULATION, CHILDREN, BLOCK_WIDTH, PATIENCE,
+			 2654435761u * (job + 1));
+	Core::Timer timer;
+	timer.start ();
+	double score = memetic.run (pi, GENERATIONS, TIME_LIMIT);
+	timer.stop ();
+	std::cout << job << ' '
+		  << '"' << bc -> name () << '"' << ' '
+		  << score << ' '
+		  << memetic.generations () << ' '
+		  << timer.elapsed () << std::endl;
+	if (score > best) {
+	  best = score;
+	  order.assign (pi.begin (), pi.end ());
+	}
+      }
+      std::cerr << "Best \"" << bc -> name () << "\" " << best << " : "
+		<< delimit (order.begin (), order.end (), " ") << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+  }
+} app;
+
+Core::ParameterInt MemeticSearch::paramRestart ("restart", "the number of independent runs", 1, 1);
+Core::ParameterInt MemeticSearch::paramPopulation ("population", "the number of individuals", 10, 1);
+Core::ParameterInt MemeticSearch::paramChildren ("children", "the number of children per generation", 10, 1);
+Core::ParameterInt MemeticSearch::paramGenerations ("generations", "the maximum number of generations", 100, 0);
+Core::ParameterInt MemeticSearch::paramBlockWidth ("block-width", "the maximum width to consider during block_lsf (0 for LS_f only)", 0, 0);
+Core::ParameterInt MemeticSearch::paramPatience ("patience", "the number of generations without improvement before a restart", 30, 1);
+Core::ParameterFloat MemeticSearch::paramTimeLimit ("time-limit", "the wall-clock seconds for each run (0 for no limit)", 0.0, 0.0);
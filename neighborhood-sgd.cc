@@ -81,7 +81,7 @@ public:
 	// likelihood of the current target permutation given its neighborhood.
 	SumBeforeCostRef bc (new SumBeforeCost (source.size (), "NeighborhoodSGD"));
 	this -> sumBeforeCost (bc, pv, source, pos, parents, labels);
-	GradientScorer scorer (bc, target);
+	GradientScorer scorer (bc, target, this -> scorerLayout ());
 	GradientChart chart (target);
 	chart.parse (controller, scorer, pv);
 	// Updates the parameters: values holds the current parameters, and
@@ -41,18 +41,14 @@ public:
     }
 
     std::vector <WRef> weights;
-    for (PV::const_iterator phi = pv.begin (); phi != pv.end (); ++ phi) {
-      weights.push_back (phi -> second);
-    }
+    pv.weights (weights);
 
     std::vector <double>
-      weightSum (pv.size (), 0.0),
-      previous (pv.size (), 0.0),
-      current (pv.size (), 0.0);
+      weightSum (weights.size (), 0.0),
+      previous (weights.size (), 0.0),
+      current (weights.size (), 0.0);
     Permute::set (current, weights);
 
-    ChartFactoryRef factory = ChartFactory::create ();
-
     Permutation source, target, pos, labels;
     std::vector <int> parents;
 
@@ -79,11 +75,11 @@ public:
 
 	SumBeforeCostRef bc (new SumBeforeCost (source.size (), "PerceptronPV"));
 	ScorerRef scorer = this -> sumBeforeScorer (bc, pv, source, pos, parents, labels);
-	ChartRef chart = factory -> chart (source);
+	OneBestChartRef chart = this -> oneBestChart (source, lc_fsa);
 
 	double best_score = scorer -> score (source);
 	do {
-	  Chart::permute (chart, controller, scorer);
+	  chart -> permute (controller, scorer);
 	  ConstPathRef bestPath = chart -> getBestPath ();
 	  source.changed (false);
 	  if (bestPath -> getScore () > best_score) {
@@ -94,21 +90,9 @@ public:
 
 	if (source != target) {
 	  // Add the feature counts of target.
-	  for (Permutation::const_iterator i = target.begin (); i != -- target.end (); ++ i) {
-	    for (Permutation::const_iterator j = i + 1; j != target.end (); ++ j) {
-	      if (* i < * j) {
-		(* bc) (* i, * j).add (LEARNING_RATE);
-	      }
-	    }
-	  }
+	  bc -> add (target, LEARNING_RATE);
 	  // Subtract the feature counts of source.
-	  for (Permutation::const_iterator i = source.begin (); i != -- source.end (); ++ i) {
-	    for (Permutation::const_iterator j = i + 1; j != source.end (); ++ j) {
-	      if (* i < * j) {
-		(* bc) (* i, * j).add (- LEARNING_RATE);
-	      }
-	    }
-	  }
+	  bc -> add (source, - LEARNING_RATE);
 	}
 
 	update (weightSum, weights);
@@ -16,7 +16,7 @@ public:
     this -> getParameters ();
 
     PV pv;
-    if (! this -> readPV (pv)) {
+    if (! this -> readPV (pv, true)) {
       return EXIT_FAILURE;
     }
   
@@ -0,0 +1,40 @@
+#include <fstream>
+
+#include "Application.hh"
+#include "PV.hh"
+
+APPLICATION
+
+using namespace Permute;
+
+// Converts each PV file named on the command line to the binary format, which
+// decode-pv, decode-dev and the other decoding tools map into memory instead
+// of parsing.  Writes file.bin next to each input file.  pv-xml converts
+// back.
+class PVBinary : public Application {
+public:
+  PVBinary () :
+    Application ("pv-binary")
+  {}
+
+  int main (const std::vector <std::string> & args) {
+    this -> getParameters ();
+
+    for (std::vector <std::string>::const_iterator it = args.begin (); it != args.end (); ++ it) {
+      PV pv;
+      if (! readFile (pv, * it)) {
+	std::cerr << "Could not read LOP parameter file: " << * it << std::endl;
+	return EXIT_FAILURE;
+      }
+      std::string file = * it + ".bin";
+      std::ofstream out (file.c_str (), std::ios::binary);
+      if (! writeBinary (pv, out)) {
+	std::cerr << "Could not write binary PV file: " << file << std::endl;
+	return EXIT_FAILURE;
+      }
+      std::cout << pv.size () << ' ' << file << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+  }
+} app;
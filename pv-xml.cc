@@ -0,0 +1,42 @@
+#include <Core/CompressedStream.hh>
+
+#include "Application.hh"
+#include "PV.hh"
+
+APPLICATION
+
+using namespace Permute;
+
+// Converts each binary PV file named on the command line back to XML, writing
+// file.xml.gz next to each input file.  Hashed PV files, which store no
+// features, cannot be converted.
+class PVXml : public Application {
+public:
+  PVXml () :
+    Application ("pv-xml")
+  {}
+
+  int main (const std::vector <std::string> & args) {
+    this -> getParameters ();
+
+    for (std::vector <std::string>::const_iterator it = args.begin (); it != args.end (); ++ it) {
+      PV pv;
+      if (! readFile (pv, * it)) {
+	std::cerr << "Could not read LOP parameter file: " << * it << std::endl;
+	return EXIT_FAILURE;
+      } else if (pv.hashed ()) {
+	std::cerr << "Hashed PV files have no XML form: " << * it << std::endl;
+	return EXIT_FAILURE;
+      }
+      std::string file = * it + ".xml.gz";
+      Core::CompressedOutputStream out (file);
+      if (! writeXml (pv, out)) {
+	std::cerr << "Could not write PV file: " << file << std::endl;
+	return EXIT_FAILURE;
+      }
+      std::cout << pv.size () << ' ' << file << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+  }
+} app;
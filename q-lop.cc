@@ -35,9 +35,9 @@ public:
       integerPermutation (p, bcr -> size ());
 
       ParseControllerRef pc = this -> parseController (p);
-      ScorerRef gamma (new BeforeScorer (bcr, p));
+      ScorerRef gamma = this -> costScorer (bcr, p);
 
-      QuadraticNormalLOPChart chart (p, QUADRATIC_WIDTH, QUADRATIC_LEFT > 0);
+      QuadraticNormalLOPChart chart (p, QUADRATIC_WIDTH, QUADRATIC_LEFT > 0, this -> threadPool ());
 
       double best_score = Core::Type <double>::min;
 
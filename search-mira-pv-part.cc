@@ -63,11 +63,9 @@ public:
     }
 
     std::vector <WRef> weights;
-    for (PV::const_iterator it = pv.begin (); it != pv.end (); ++ it) {
-      weights.push_back (it -> second);
-    }
+    pv.weights (weights);
 
-    std::vector <double> weightSum (pv.size (), 0.0);
+    std::vector <double> weightSum (weights.size (), 0.0);
 
     Permutation source, helper, target, pos;
 
@@ -55,14 +55,12 @@ public:
     }
 
     std::vector <WRef> weights;
-    for (PV::const_iterator it = pv.begin (); it != pv.end (); ++ it) {
-      weights.push_back (it -> second);
-    }
+    pv.weights (weights);
 
     std::vector <double>
-      weightSum (pv.size (), 0.0),
-      previous (pv.size (), 0.0),
-      current (pv.size (), 0.0);
+      weightSum (weights.size (), 0.0),
+      previous (weights.size (), 0.0),
+      current (weights.size (), 0.0);
     Permute::set (current, weights);
 
     Permutation source, helper, target, pos;
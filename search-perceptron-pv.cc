@@ -48,18 +48,14 @@ public:
     }
 
     std::vector <WRef> weights;
-    for (PV::const_iterator phi = pv.begin (); phi != pv.end (); ++ phi) {
-      weights.push_back (phi -> second);
-    }
+    pv.weights (weights);
 
     std::vector <double>
-      weightSum (pv.size (), 0.0),
-      previous (pv.size (), 0.0),
-      current (pv.size (), 0.0);
+      weightSum (weights.size (), 0.0),
+      previous (weights.size (), 0.0),
+      current (weights.size (), 0.0);
     Permute::set (current, weights);
 
-    ChartFactoryRef factory = ChartFactory::create ();
-
     Permutation source, helper, target, pos, labels;
     std::vector <int> parents;
 
@@ -91,15 +87,15 @@ public:
 						"SearchPerceptronPV"));
 	ScorerRef scorer = this -> sumBeforeScorer (bc, pv, source, pos, parents, labels);
 	ScorerRef loss = this -> lossScorer (source, target);
-	ChartRef chart = factory -> chart (source);
+	OneBestChartRef chart = this -> oneBestChart (source, lc_fsa);
 
 	double bestScore = scorer -> score (source);
 	do {
-	  Chart::permute (chart, controller, loss);
+	  chart -> permute (controller, loss);
 	  ConstPathRef minLossPath = chart -> getBestPath ();
 	  double minLoss = minLossPath -> getScore ();
 	  
-	  Chart::permute (chart, controller, scorer);
+	  chart -> permute (controller, scorer);
 	  ConstPathRef modelPath = chart -> getBestPath ();
 
 	  target.reorder (minLossPath);
@@ -107,21 +103,9 @@ public:
 
 	  if (helper != target) {
 	    // Add the feature counts of target.
-	    for (Permutation::const_iterator i = target.begin (); i != -- target.end (); ++ i) {
-	      for (Permutation::const_iterator j = i + 1; j != target.end (); ++ j) {
-		if (* i < * j) {
-		  (* bc) (* i, * j).add (LEARNING_RATE);
-		}
-	      }
-	    }
+	    bc -> add (target, LEARNING_RATE);
 	    // Subtract the feature counts of helper.
-	    for (Permutation::const_iterator i = helper.begin (); i != -- helper.end (); ++ i) {
-	      for (Permutation::const_iterator j = i + 1; j != helper.end (); ++ j) {
-		if (* i < * j) {
-		  (* bc) (* i, * j).add (- LEARNING_RATE);
-		}
-	      }
-	    }
+	    bc -> add (helper, - LEARNING_RATE);
 	  }
 
 	  update (weightSum, weights);
@@ -30,7 +30,7 @@ public:
     this -> getParameters ();
 
     PV pv;
-    if (! this -> readPV (pv)) {
+    if (! this -> readPV (pv, true)) {
       return EXIT_FAILURE;
     }
 
@@ -51,12 +51,12 @@ public:
       SumBeforeCostRef bc (new SumBeforeCost (source.size (), "total-loss"));
       ScorerRef scorer = this -> sumBeforeScorer (bc, pv, source, pos);
       ScorerRef loss = this -> lossScorer (source, target);
-      LOPChart chart (source, WINDOW);
+      OneBestChartRef chart = this -> oneBestChart (source);
 
       double best_score = scorer -> score (source);
       do {
-	chart.permute (controller, scorer);
-	ConstPathRef bestPath = chart.getBestPath ();
+	chart -> permute (controller, scorer);
+	ConstPathRef bestPath = chart -> getBestPath ();
 	source.changed (false);
 	if (bestPath -> getScore () > best_score) {
 	  best_score = bestPath -> getScore ();
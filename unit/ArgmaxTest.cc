@@ -0,0 +1,60 @@
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+#include "ArgmaxTest.hh"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ArgmaxTest );
+
+// Compares argmax to a scalar loop on random vectors of every length up to 40,
+// so that each length of the remainder is covered.
+void ArgmaxTest::testScalar () {
+  srand (13);
+  for (int size = 0; size <= 40; ++ size) {
+    std::vector <double> left (size + 1), right (size + 1), score (size + 1);
+    for (int j = 0; j < size; ++ j) {
+      left [j] = rand () / 7.0;
+      right [j] = rand () / 11.0;
+      score [j] = rand () / 13.0 - RAND_MAX / 20.0;
+    }
+    double expected_best = -1e300, actual_best = -1e300;
+    int expected = -1;
+    for (int j = 0; j < size; ++ j) {
+      double sum = left [j] + right [j] + score [j];
+      if (sum > expected_best) {
+	expected_best = sum;
+	expected = j;
+      }
+    }
+    int actual = Permute::argmax (& left [0], & right [0], & score [0], size, actual_best);
+    std::ostringstream out;
+    out << "size " << size;
+    CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (), expected, actual );
+    CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (), expected_best, actual_best );
+  }
+}
+
+// Verifies that the first of several equal maxima wins, wherever the maxima
+// fall among the vector lanes.
+void ArgmaxTest::testTies () {
+  std::vector <double> left (17, 0.0), right (17, 0.0), score (17, 0.0);
+  for (int first = 0; first < 17; ++ first) {
+    for (int second = first + 1; second < 17; ++ second) {
+      score [first] = score [second] = 1.0;
+      double best = -1.0;
+      CPPUNIT_ASSERT_EQUAL( first, Permute::argmax (& left [0], & right [0], & score [0], 17, best) );
+      CPPUNIT_ASSERT_EQUAL( 1.0, best );
+      score [first] = score [second] = 0.0;
+    }
+  }
+}
+
+// Verifies that only sums strictly greater than the given best count.
+void ArgmaxTest::testBest () {
+  std::vector <double> left (9, 1.0), right (9, 1.0), score (9, 1.0);
+  double best = 3.0;
+  CPPUNIT_ASSERT_EQUAL( -1, Permute::argmax (& left [0], & right [0], & score [0], 9, best) );
+  CPPUNIT_ASSERT_EQUAL( 3.0, best );
+  score [6] = 2.0;
+  CPPUNIT_ASSERT_EQUAL( 6, Permute::argmax (& left [0], & right [0], & score [0], 9, best) );
+  CPPUNIT_ASSERT_EQUAL( 4.0, best );
+}
@@ -0,0 +1,20 @@
+#ifndef _PERMUTE_ARGMAX_TEST_HH
+#define _PERMUTE_ARGMAX_TEST_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Argmax.hh>
+
+class ArgmaxTest : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE( ArgmaxTest );
+  CPPUNIT_TEST( testScalar );
+  CPPUNIT_TEST( testTies );
+  CPPUNIT_TEST( testBest );
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testScalar ();
+  void testTies ();
+  void testBest ();
+};
+
+#endif//_PERMUTE_ARGMAX_TEST_HH
@@ -1,6 +1,13 @@
-#include <Core/TextStream.hh>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
 #include <ParseController.hh>
+#include <LinearOrdering.hh>
+#include <ParsePolicy.hh>
 #include "BeforeScorerTest.hh"
+#include "LOLIBFixture.hh"
 
 CPPUNIT_TEST_SUITE_REGISTRATION( BeforeScorerTest );
 
@@ -43,16 +50,9 @@ void BeforeScorerTest::testIndex () {
 // computing them via the alternative method (i,j,k-1) + (i,j-1,k) -
 // (i,j-1,k-1).
 void BeforeScorerTest::testLeftAnchorRecurrence () {
-  Core::TextInputStream input ("be75eec.mat");
-  Permute::BeforeCostRef bc (Permute::readLOLIB (input));
-  CPPUNIT_ASSERT_EQUAL( size_t (50), bc -> size () );
-
-  std::stringstream str;
-  for (int i = 0; i < bc -> size (); ++ i) {
-    str << i << ' ';
-  }
   Permute::Permutation p;
-  Permute::readPermutationWithAlphabet (p, str);
+  Permute::BeforeCostRef bc (readBe75eec (p));
+  CPPUNIT_ASSERT_EQUAL( size_t (50), bc -> size () );
   
   delete scorer;
   scorer = new Permute::BeforeScorer (bc, p);
@@ -89,3 +89,262 @@ void BeforeScorerTest::testLeftAnchorRecurrence () {
     }
   }
 }
+
+// Reads a cost matrix from LOLIB.  Verifies that the summed-area table in
+// PrefixBeforeScorer gives the same scores as the recurrence in BeforeScorer,
+// for both the keep (i < k) and swap (i > k) orientations.
+void BeforeScorerTest::testPrefix () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  delete scorer;
+  scorer = new Permute::BeforeScorer (bc, p);
+  scorer -> compute (Permute::CubicParseController::create ());
+
+  Permute::PrefixBeforeScorer prefix (bc, p);
+  prefix.compute (Permute::CubicParseController::create ());
+
+  for (int i = 0; i < bc -> size (); ++ i) {
+    for (int j = i + 1; j < bc -> size (); ++ j) {
+      for (int k = j + 1; k <= bc -> size (); ++ k) {
+	std::ostringstream out;
+	out << "(" << i << ", " << j << ", " << k << ")";
+	CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( out.str (),
+					      scorer -> score (i, j, k),
+					      prefix.score (i, j, k),
+					      1e-6 );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( out.str (),
+					      scorer -> score (k, j, i),
+					      prefix.score (k, j, i),
+					      1e-6 );
+      }
+    }
+  }
+}
+
+// Reads a cost matrix from LOLIB.  Verifies that the SPARSE layout allocates
+// fewer slots than the DENSE layout under an anchored quadratic controller, and
+// that it gives the same score for every triple.
+void BeforeScorerTest::testSparse () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  Permute::ParseControllerRef controller =
+    Permute::RightAnchorParseController::decorate
+    (Permute::LeftAnchorParseController::decorate
+     (Permute::QuadraticParseController::create (3), 3), p, 3);
+
+  delete scorer;
+  scorer = new Permute::BeforeScorer (bc, p);
+  scorer -> compute (controller);
+
+  Permute::BeforeScorer sparse (bc, p, Permute::BeforeScorer::SPARSE);
+  sparse.compute (controller);
+  CPPUNIT_ASSERT( sparse.slots () < scorer -> slots () );
+
+  for (int i = 0; i < bc -> size (); ++ i) {
+    for (int j = i + 1; j < bc -> size (); ++ j) {
+      for (int k = j + 1; k <= bc -> size (); ++ k) {
+	std::ostringstream out;
+	out << "(" << i << ", " << j << ", " << k << ")";
+	CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (),
+				      scorer -> score (i, j, k),
+				      sparse.score (i, j, k) );
+	CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (),
+				      scorer -> score (k, j, i),
+				      sparse.score (k, j, i) );
+      }
+    }
+  }
+}
+
+// Reads a cost matrix from LOLIB.  Verifies that computing the scores with the
+// AnchoredMidpoints policy gives bitwise the same result as computing them
+// through the virtual ParseController interface.  A bare
+// ParseControllerDecorator has no policy, so it forces the fallback.
+void BeforeScorerTest::testPolicy () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  Permute::ParseControllerRef controller =
+    Permute::RightAnchorParseController::decorate
+    (Permute::LeftAnchorParseController::decorate
+     (Permute::QuadraticParseController::create (3), 3), p, 3);
+  Permute::ParsePolicy policy;
+  CPPUNIT_ASSERT( controller -> policy (policy) );
+  CPPUNIT_ASSERT_EQUAL( Permute::ParsePolicy::ANCHORED, policy.type );
+  Permute::ParseControllerRef fallback (new Permute::ParseControllerDecorator (controller));
+  CPPUNIT_ASSERT( ! fallback -> policy (policy) );
+
+  delete scorer;
+  scorer = new Permute::BeforeScorer (bc, p);
+  scorer -> compute (controller);
+
+  Permute::BeforeScorer virtual_scorer (bc, p);
+  virtual_scorer.compute (fallback);
+
+  for (int i = 0; i < bc -> size (); ++ i) {
+    for (int j = i + 1; j < bc -> size (); ++ j) {
+      for (int k = j + 1; k <= bc -> size (); ++ k) {
+	std::ostringstream out;
+	out << "(" << i << ", " << j << ", " << k << ")";
+	// The right anchor recurrence can read cells of the same width that are
+	// still unset, giving NaN on both paths.
+	double expected = virtual_scorer.score (i, j, k),
+	  actual = scorer -> score (i, j, k);
+	CPPUNIT_ASSERT_MESSAGE( out.str (),
+				expected == actual || (expected != expected && actual != actual) );
+	expected = virtual_scorer.score (k, j, i);
+	actual = scorer -> score (k, j, i);
+	CPPUNIT_ASSERT_MESSAGE( out.str (),
+				expected == actual || (expected != expected && actual != actual) );
+      }
+    }
+  }
+}
+
+// Reads a cost matrix from LOLIB.  Verifies that filling the spans of each
+// width on a thread pool gives bitwise the same scores as filling them
+// serially.
+void BeforeScorerTest::testThreads () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  Permute::ParseControllerRef controller = Permute::CubicParseController::create ();
+
+  delete scorer;
+  scorer = new Permute::BeforeScorer (bc, p);
+  scorer -> compute (controller);
+
+  Permute::BeforeScorer threaded (bc, p);
+  threaded.setThreadPool (Permute::ThreadPoolRef (new Permute::ThreadPool (4)));
+  threaded.compute (controller);
+
+  for (int i = 0; i < bc -> size (); ++ i) {
+    for (int j = i + 1; j < bc -> size (); ++ j) {
+      for (int k = j + 1; k <= bc -> size (); ++ k) {
+	std::ostringstream out;
+	out << "(" << i << ", " << j << ", " << k << ")";
+	CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (),
+				      scorer -> score (i, j, k),
+				      threaded.score (i, j, k) );
+	CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (),
+				      scorer -> score (k, j, i),
+				      threaded.score (k, j, i) );
+      }
+    }
+  }
+}
+
+// Reads a cost matrix from LOLIB.  Verifies that a PermutedCost kept in step
+// with insert and block moves matches one built from scratch on the resulting
+// permutation, and that its score agrees with the cost matrix.
+void BeforeScorerTest::testPermutedCost () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  Permute::PermutedCost cost (bc, p);
+  Permute::insert (p, 3, 40);
+  cost.insert (3, 40);
+  Permute::insert (p, 45, 0);
+  cost.insert (45, 0);
+  Permute::insert (p, 10, 20, 35);
+  cost.insert (10, 20, 35);
+  Permute::insert (p, 30, 42, 5);
+  cost.insert (30, 42, 5);
+
+  Permute::PermutedCost fresh (bc, p);
+  for (int a = 0; a < bc -> size (); ++ a) {
+    for (int b = 0; b < bc -> size (); ++ b) {
+      std::ostringstream out;
+      out << "(" << a << ", " << b << ")";
+      CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (), bc -> cost (p [a], p [b]), cost.before (a, b) );
+      CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (), bc -> cost (p [b], p [a]), cost.after (a, b) );
+      CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (), fresh.before (a, b), cost.before (a, b) );
+    }
+  }
+  CPPUNIT_ASSERT_EQUAL( bc -> score (p), cost.score () );
+}
+
+// Verifies that TauScorer, tauScore and tauDistance agree with a BeforeScorer
+// over the dense tauCost matrix, and with a direct count of discordant pairs,
+// on random targets and permutations.
+void BeforeScorerTest::testTau () {
+  srand (20);
+  for (int trial = 0; trial < 20; ++ trial) {
+    const int n = 1 + rand () % 20;
+    Permute::Permutation p;
+    Permute::integerPermutation (p, n);
+    Permute::Permutation target = p;
+    std::random_shuffle (target.begin (), target.end ());
+    std::random_shuffle (p.begin (), p.end ());
+
+    Permute::BeforeScorer dense (Permute::tauCost (target), p);
+    dense.compute (Permute::CubicParseController::create ());
+    Permute::TauScorer tau (target, p);
+    tau.compute (Permute::CubicParseController::create ());
+
+    CPPUNIT_ASSERT_EQUAL( dense.score (p), tau.score (p) );
+    CPPUNIT_ASSERT_EQUAL( dense.score (p), Permute::tauScore (target, p) );
+
+    long discordant = 0;
+    for (int a = 0; a < n; ++ a) {
+      for (int b = a + 1; b < n; ++ b) {
+	int before = std::find (target.begin (), target.end (), p [a]) - target.begin ();
+	int after = std::find (target.begin (), target.end (), p [b]) - target.begin ();
+	discordant += before > after;
+      }
+    }
+    CPPUNIT_ASSERT_EQUAL( discordant, Permute::tauDistance (p, target) );
+
+    for (int i = 0; i < n; ++ i) {
+      for (int j = i + 1; j < n; ++ j) {
+	for (int k = j + 1; k <= n; ++ k) {
+	  std::ostringstream out;
+	  out << "(" << i << ", " << j << ", " << k << ")";
+	  CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (), dense.score (i, j, k), tau.score (i, j, k) );
+	  CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (), dense.score (k, j, i), tau.score (k, j, i) );
+	}
+      }
+    }
+  }
+}
+
+// Reads a cost matrix from LOLIB and writes it in the binary format.  Verifies
+// that the file is recognized, that its mapping has the same name and costs,
+// and that a truncated copy is rejected.
+void BeforeScorerTest::testBinaryLOLIB () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  const std::string file = "be75eec.bin", truncated = "be75eec-truncated.bin";
+  std::ostringstream bytes;
+  CPPUNIT_ASSERT( Permute::writeBinaryLOLIB (bytes, * bc) );
+  std::ofstream whole (file.c_str (), std::ios::binary),
+    part (truncated.c_str (), std::ios::binary);
+  whole << bytes.str ();
+  part << bytes.str ().substr (0, bytes.str ().size () - sizeof (double));
+  whole.close ();
+  part.close ();
+
+  CPPUNIT_ASSERT( Permute::isBinaryLOLIB (file) );
+  CPPUNIT_ASSERT( ! Permute::isBinaryLOLIB ("be75eec.mat") );
+  {
+    Permute::BeforeCostRef mapped (Permute::mapLOLIB (file));
+    CPPUNIT_ASSERT( mapped );
+    CPPUNIT_ASSERT_EQUAL( bc -> size (), mapped -> size () );
+    CPPUNIT_ASSERT_EQUAL( bc -> name (), mapped -> name () );
+    for (int i = 0; i < bc -> size (); ++ i) {
+      for (int j = 0; j < bc -> size (); ++ j) {
+	std::ostringstream out;
+	out << "(" << i << ", " << j << ")";
+	CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (), bc -> cost (i, j), mapped -> cost (i, j) );
+      }
+    }
+  }
+  CPPUNIT_ASSERT( Permute::isBinaryLOLIB (truncated) );
+  CPPUNIT_ASSERT( ! Permute::BeforeCostRef (Permute::mapLOLIB (truncated)) );
+
+  std::remove (file.c_str ());
+  std::remove (truncated.c_str ());
+}
@@ -10,6 +10,13 @@ class BeforeScorerTest : public CppUnit::TestFixture {
   CPPUNIT_TEST( testBinomial );
   CPPUNIT_TEST( testIndex );
   CPPUNIT_TEST( testLeftAnchorRecurrence );
+  CPPUNIT_TEST( testPrefix );
+  CPPUNIT_TEST( testSparse );
+  CPPUNIT_TEST( testPolicy );
+  CPPUNIT_TEST( testThreads );
+  CPPUNIT_TEST( testPermutedCost );
+  CPPUNIT_TEST( testTau );
+  CPPUNIT_TEST( testBinaryLOLIB );
   CPPUNIT_TEST_SUITE_END();
 private:
   Permute::Permutation pi;
@@ -21,6 +28,13 @@ public:
   void testBinomial ();
   void testIndex ();
   void testLeftAnchorRecurrence ();
+  void testPrefix ();
+  void testSparse ();
+  void testPolicy ();
+  void testThreads ();
+  void testPermutedCost ();
+  void testTau ();
+  void testBinaryLOLIB ();
 };
 
 #endif//_PERMUTE_BEFORE_SCORER_TEST_HH
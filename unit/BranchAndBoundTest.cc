@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cstdlib>
+#include "BranchAndBoundTest.hh"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( BranchAndBoundTest );
+
+namespace {
+  // Draws integer costs in [0, range), so that many orders tie.
+  Permute::BeforeCostRef random (int n, int range, unsigned & state) {
+    Permute::BeforeCost * bc = new Permute::BeforeCost (n, "random");
+    for (int i = 0; i < n; ++ i) {
+      for (int j = 0; j < n; ++ j) {
+	if (i != j) {
+	  bc -> setCost (i, j, rand_r (& state) % range);
+	}
+      }
+    }
+    return Permute::BeforeCostRef (bc);
+  }
+}
+
+// Compares the solver with exhaustive enumeration on small random matrices.
+void BranchAndBoundTest::testEnumeration () {
+  unsigned state = 17;
+  for (int trial = 0; trial < 60; ++ trial) {
+    const int n = 5 + trial % 4;
+    Permute::BeforeCostRef bc (random (n, trial % 2 ? 4 : 1000, state));
+    Permute::Permutation p, q;
+    Permute::integerPermutation (p, n);
+    q = p;
+
+    double best = bc -> score (q);
+    while (std::next_permutation (q.begin (), q.end ())) {
+      best = std::max (best, bc -> score (q));
+    }
+
+    Permute::BranchAndBound bb (bc, Permute::ThreadPoolRef ());
+    double score = bb.solve (p);
+    CPPUNIT_ASSERT( bb.optimal () );
+    CPPUNIT_ASSERT_EQUAL( best, score );
+    CPPUNIT_ASSERT_EQUAL( best, bc -> score (p) );
+  }
+}
+
+// Verifies that the thread pool finds an order with the same score.
+void BranchAndBoundTest::testThreads () {
+  unsigned state = 23;
+  Permute::ThreadPoolRef pool (new Permute::ThreadPool (4));
+  for (int trial = 0; trial < 5; ++ trial) {
+    Permute::BeforeCostRef bc (random (14, 100, state));
+    Permute::Permutation serial, parallel;
+    Permute::integerPermutation (serial, 14);
+    parallel = serial;
+
+    Permute::BranchAndBound one (bc, Permute::ThreadPoolRef ()), four (bc, pool);
+    double score = one.solve (serial);
+    CPPUNIT_ASSERT_EQUAL( score, four.solve (parallel) );
+    CPPUNIT_ASSERT_EQUAL( score, bc -> score (parallel) );
+  }
+}
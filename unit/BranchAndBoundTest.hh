@@ -0,0 +1,18 @@
+#ifndef _PERMUTE_BRANCH_AND_BOUND_TEST_HH
+#define _PERMUTE_BRANCH_AND_BOUND_TEST_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <BranchAndBound.hh>
+
+class BranchAndBoundTest : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE( BranchAndBoundTest );
+  CPPUNIT_TEST( testEnumeration );
+  CPPUNIT_TEST( testThreads );
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testEnumeration ();
+  void testThreads ();
+};
+
+#endif//_PERMUTE_BRANCH_AND_BOUND_TEST_HH
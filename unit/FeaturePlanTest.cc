@@ -0,0 +1,138 @@
+#include <cstdlib>
+#include <sstream>
+#include "FeaturePlanTest.hh"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( FeaturePlanTest );
+
+using namespace Permute;
+
+namespace {
+  // Fills bc the way sumBeforeCost does without an index.
+  void fillStrings (SumBeforeCost & bc, const PV & pv, const InputData & data, bool dependency) {
+    const size_t n = data.source ().size ();
+    for (size_t i = 0; i + 1 < n; ++ i) {
+      for (size_t j = i + 1; j < n; ++ j) {
+	std::vector <std::string> features;
+	if (dependency) {
+	  pv.features (features, data.source (), data.pos (), data.parents (), data.labels (), i, j);
+	} else {
+	  pv.features (features, data.source (), data.pos (), i, j);
+	}
+	for (std::vector <std::string>::const_iterator f = features.begin (); f != features.end (); ++ f) {
+	  PV::const_iterator phi = pv.find (* f);
+	  if (phi != pv.end ()) {
+	    bc (i, j) += phi -> second;
+	  }
+	}
+      }
+    }
+  }
+
+  // Verifies that every cell holds the same weights in the same order.
+  void assertEqual (SumBeforeCost & expected, SumBeforeCost & actual) {
+    for (size_t i = 0; i < expected.size (); ++ i) {
+      for (size_t j = 0; j < expected.size (); ++ j) {
+	const Sum & e = expected (i, j), & a = actual (i, j);
+	CPPUNIT_ASSERT_EQUAL( double (e), double (a) );
+	CPPUNIT_ASSERT_EQUAL( e.end () - e.begin (), a.end () - a.begin () );
+	for (std::vector <WRef>::const_iterator x = e.begin (), y = a.begin (); x != e.end (); ++ x, ++ y) {
+	  CPPUNIT_ASSERT( * x == * y );
+	}
+      }
+    }
+  }
+}
+
+FeaturePlanTest::FeaturePlanTest () :
+  pv_ (),
+  data_ (true)
+{}
+
+// Builds a random sentence with a dependency parse, and a PV holding about
+// half of the features of its pairs.
+void FeaturePlanTest::setUp () {
+  srand (22);
+  const int n = 12;
+  std::ostringstream words, tags, parents, labels, alignment;
+  for (int i = 0; i < n; ++ i) {
+    words << "w" << rand () % 6 << ' ';
+    tags << "T" << rand () % 4 << ' ';
+    parents << rand () % (n + 1) << ' ';
+    labels << "L" << rand () % 3 << ' ';
+    alignment << n - 1 - i << ' ';
+  }
+  std::stringstream in;
+  in << words.str () << '\n' << tags.str () << '\n' << parents.str () << '\n'
+     << labels.str () << '\n' << alignment.str () << '\n';
+  CPPUNIT_ASSERT( in >> data_ );
+
+  pv_.addType ("pos", 10);
+  pv_.addType ("word", 100);
+  pv_.addType ("dist", 5);
+  pv_.addType ("label", 5);
+  const char * pos [] = { "l-pos-1", "l-pos", "l-pos+1", "b-pos", "r-pos-1", "r-pos", "r-pos+1" };
+  for (int f = 0; f < 7; ++ f) {
+    pv_.addFeatureType (pos [f], "pos");
+  }
+  const char * word [] = { "l-word", "r-word", "l-prefix", "r-prefix", "l-suffix", "r-suffix" };
+  for (int f = 0; f < 6; ++ f) {
+    pv_.addFeatureType (word [f], "word");
+  }
+  const char * label [] = { "l-par", "r-par", "l-sib", "r-sib" };
+  for (int f = 0; f < 4; ++ f) {
+    pv_.addFeatureType (label [f], "label");
+  }
+  pv_.addFeatureType ("dist", "dist");
+  pv_.addDistance (ComparisonGreaterThan, 5);
+  pv_.addDistance (ComparisonGreaterThan, 2);
+  pv_.addTemplate ("l-pos r-pos");
+  pv_.addTemplate ("l-word r-word dist");
+  pv_.addTemplate ("l-pos-1 l-pos r-pos r-pos+1");
+  pv_.addTemplate ("l-pos l-pos+1 r-pos-1 r-pos");
+  pv_.addTemplate ("l-prefix r-suffix");
+  pv_.addTemplate ("l-pos b-pos r-pos");
+  pv_.addTemplate ("l-pos b-pos");
+  pv_.addTemplate ("b-pos dist");
+  pv_.addTemplate ("l-par r-pos");
+  pv_.addTemplate ("l-sib r-sib");
+  pv_.addTemplate ("r-par b-pos");
+
+  for (int dependency = 0; dependency < 2; ++ dependency) {
+    for (size_t i = 0; i + 1 < n; ++ i) {
+      for (size_t j = i + 1; j < n; ++ j) {
+	std::vector <std::string> features;
+	if (dependency) {
+	  pv_.features (features, data_.source (), data_.pos (), data_.parents (), data_.labels (), i, j);
+	} else {
+	  pv_.features (features, data_.source (), data_.pos (), i, j);
+	}
+	for (std::vector <std::string>::const_iterator f = features.begin (); f != features.end (); ++ f) {
+	  if (rand () % 2 == 0) {
+	    pv_ [* f] = (rand () % 1000 - 500) / 7.0;
+	  }
+	}
+      }
+    }
+  }
+  CPPUNIT_ASSERT( pv_.index () );
+}
+
+void FeaturePlanTest::tearDown () {
+
+}
+
+void FeaturePlanTest::testFill () {
+  const size_t n = data_.source ().size ();
+  SumBeforeCost expected (n, "FeaturePlanTest::expected"), actual (n, "FeaturePlanTest::actual");
+  fillStrings (expected, pv_, data_, false);
+  FeaturePlan (pv_, data_.source (), data_.pos ()).fill (actual);
+  assertEqual (expected, actual);
+}
+
+void FeaturePlanTest::testFillDependency () {
+  const size_t n = data_.source ().size ();
+  SumBeforeCost expected (n, "FeaturePlanTest::expected"), actual (n, "FeaturePlanTest::actual");
+  fillStrings (expected, pv_, data_, true);
+  FeaturePlan (pv_, data_.source (), data_.pos (), data_.parents (), data_.labels ()).fill (actual);
+  assertEqual (expected, actual);
+}
@@ -0,0 +1,25 @@
+#ifndef _PERMUTE_FEATURE_PLAN_TEST_HH
+#define _PERMUTE_FEATURE_PLAN_TEST_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <FeaturePlan.hh>
+#include <InputData.hh>
+
+class FeaturePlanTest : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE( FeaturePlanTest );
+  CPPUNIT_TEST( testFill );
+  CPPUNIT_TEST( testFillDependency );
+  CPPUNIT_TEST_SUITE_END();
+private:
+  Permute::PV pv_;
+  Permute::InputData data_;
+public:
+  FeaturePlanTest ();
+  void setUp ();
+  void tearDown ();
+  void testFill ();
+  void testFillDependency ();
+};
+
+#endif//_PERMUTE_FEATURE_PLAN_TEST_HH
@@ -68,3 +68,14 @@ void FeatureTypeTest::testUnintern () {
   CPPUNIT_ASSERT_EQUAL( s1, one -> unintern (z1) );
   CPPUNIT_ASSERT_EQUAL( s2, one -> unintern (z2) );
 }
+
+// Ids count values in the order they were first interned, across bytes.
+void FeatureTypeTest::testId () {
+  for (int i = 0; i < 600; ++ i) {
+    std::stringstream str;
+    str << i;
+    CPPUNIT_ASSERT_EQUAL( i, two -> id (str.str ()) );
+    CPPUNIT_ASSERT_EQUAL( i, two -> decode (two -> intern (str.str ())) );
+  }
+  CPPUNIT_ASSERT_EQUAL( 0, two -> id ("0") );
+}
@@ -10,6 +10,7 @@ class FeatureTypeTest : public CppUnit::TestFixture {
   CPPUNIT_TEST( testOneByte );
   CPPUNIT_TEST( testTwoBytes );
   CPPUNIT_TEST( testUnintern );
+  CPPUNIT_TEST( testId );
   CPPUNIT_TEST_SUITE_END();
 private:
   Permute::FeatureType * one, * two;
@@ -20,6 +21,7 @@ public:
   void testOneByte ();
   void testTwoBytes ();
   void testUnintern ();
+  void testId ();
 };
 
 #endif//_PERMUTE_FEATURE_TYPE_TEST_HH
@@ -0,0 +1,116 @@
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+#include "InsertScanTest.hh"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( InsertScanTest );
+
+namespace {
+  // Returns a random n x n matrix with entries in [0, mod), divided by seven so
+  // that they are not all integers.
+  Permute::BeforeCostRef random (int n, int mod) {
+    Permute::BeforeCost * bc = new Permute::BeforeCost (n, "random");
+    for (int i = 0; i < n; ++ i) {
+      for (int j = 0; j < n; ++ j) {
+	bc -> setCost (i, j, (rand () % mod) / 7.0);
+      }
+    }
+    return Permute::BeforeCostRef (bc);
+  }
+
+  // Returns a random permutation of n elements.
+  void shuffle (Permute::Permutation & p, int n) {
+    Permute::integerPermutation (p, n);
+    for (int i = n - 1; i > 0; -- i) {
+      std::swap (p [i], p [rand () % (i + 1)]);
+    }
+  }
+
+  // The inner loops of visit, as they were written before scanInserts.
+  void scan (const Permute::PermutedCost & cost, int y, double & gain, int & target) {
+    const Permute::PermutedCost::Pair * row = cost.row (y);
+    gain = 0.0;
+    target = y;
+    double delta = 0.0;
+    for (int r = y - 1; r >= 0; -- r) {
+      delta -= row [r].after;
+      delta += row [r].before;
+      if (delta > gain) {
+	gain = delta;
+	target = r;
+      }
+    }
+    delta = 0.0;
+    for (int r = y + 1; r < cost.size (); ++ r) {
+      delta -= row [r].before;
+      delta += row [r].after;
+      if (delta > gain) {
+	gain = delta;
+	target = r;
+      }
+    }
+  }
+
+  // Compares scanInserts to scan for every block of rows in the given cost.
+  void compare (const Permute::PermutedCost & cost) {
+    double gain [Permute::INSERT_SCAN_ROWS];
+    int target [Permute::INSERT_SCAN_ROWS];
+    for (int x = 0; x < cost.size (); ++ x) {
+      for (int count = 1; count <= Permute::INSERT_SCAN_ROWS && x + count <= cost.size (); ++ count) {
+	Permute::scanInserts (cost, x, count, gain, target);
+	for (int k = 0; k < count; ++ k) {
+	  double expected_gain;
+	  int expected_target;
+	  scan (cost, x + k, expected_gain, expected_target);
+	  std::ostringstream out;
+	  out << "size " << cost.size () << " row " << x + k << " of " << x << " + " << count;
+	  CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (), expected_target, target [k] );
+	  CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (), expected_gain, gain [k] );
+	}
+      }
+    }
+  }
+}
+
+// Compares scanInserts to the scalar loops on random matrices of every size up
+// to 20, so that each block falls at every offset from the diagonal.
+void InsertScanTest::testScalar () {
+  srand (17);
+  for (int n = 1; n <= 20; ++ n) {
+    Permute::BeforeCostRef bc (random (n, 1000));
+    Permute::Permutation p;
+    shuffle (p, n);
+    compare (Permute::PermutedCost (bc, p));
+  }
+}
+
+// Verifies that the first of equal gains wins in each lane, using matrices
+// with only a few distinct entries.
+void InsertScanTest::testTies () {
+  srand (19);
+  for (int n = 4; n <= 12; ++ n) {
+    for (int m = 0; m < 10; ++ m) {
+      Permute::BeforeCostRef bc (random (n, 3));
+      Permute::Permutation p;
+      shuffle (p, n);
+      compare (Permute::PermutedCost (bc, p));
+    }
+  }
+}
+
+void InsertScanTest::testDifferences () {
+  srand (23);
+  Permute::BeforeCostRef bc (random (11, 1000));
+  Permute::Permutation p;
+  shuffle (p, 11);
+  Permute::PermutedCost cost (bc, p);
+  for (int size = 0; size <= 11; ++ size) {
+    std::vector <double> before (size + 1), after (size + 1);
+    Permute::differences (cost.row (3), size, false, & before [0]);
+    Permute::differences (cost.row (3), size, true, & after [0]);
+    for (int j = 0; j < size; ++ j) {
+      CPPUNIT_ASSERT_EQUAL( cost.row (3) [j].before - cost.row (3) [j].after, before [j] );
+      CPPUNIT_ASSERT_EQUAL( cost.row (3) [j].after - cost.row (3) [j].before, after [j] );
+    }
+  }
+}
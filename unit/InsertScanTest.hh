@@ -0,0 +1,20 @@
+#ifndef _PERMUTE_INSERT_SCAN_TEST_HH
+#define _PERMUTE_INSERT_SCAN_TEST_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <InsertScan.hh>
+
+class InsertScanTest : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE( InsertScanTest );
+  CPPUNIT_TEST( testScalar );
+  CPPUNIT_TEST( testTies );
+  CPPUNIT_TEST( testDifferences );
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testScalar ();
+  void testTies ();
+  void testDifferences ();
+};
+
+#endif//_PERMUTE_INSERT_SCAN_TEST_HH
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include "IteratedLocalSearchTest.hh"
+#include "LOLIBFixture.hh"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IteratedLocalSearchTest );
+
+namespace {
+  // Records every checkpoint.
+  class Recorder : public Permute::IteratedLocalSearch {
+  public:
+    std::vector <double> times, scores;
+    Recorder (const Permute::BeforeCostRef & bc, Perturbation perturbation, Acceptance acceptance) :
+      Permute::IteratedLocalSearch (bc, perturbation, acceptance, 8, 4, 11)
+    {}
+  protected:
+    virtual void checkpoint (double time, double score) {
+      times.push_back (time);
+      scores.push_back (score);
+    }
+  };
+}
+
+// Runs each perturbation and acceptance criterion on a LOLIB matrix for a
+// tenth of a second.  Verifies that the search returns the best checkpoint,
+// that pi holds a permutation with that score, and that it does at least as
+// well as LS_f alone, which is its first descent.
+void IteratedLocalSearchTest::testRun () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  Permute::Permutation lsf = p;
+  while (Permute::visit (lsf, bc) > 0.0);
+
+  for (int perturbation = Permute::IteratedLocalSearch::PERTURB_BLOCK;
+       perturbation <= Permute::IteratedLocalSearch::PERTURB_DOUBLE_INSERT;
+       ++ perturbation) {
+    for (int acceptance = Permute::IteratedLocalSearch::ACCEPT_BETTER;
+	 acceptance <= Permute::IteratedLocalSearch::ACCEPT_ALWAYS;
+	 ++ acceptance) {
+      Permute::Permutation pi = p;
+      Recorder search (bc,
+		       Permute::IteratedLocalSearch::Perturbation (perturbation),
+		       Permute::IteratedLocalSearch::Acceptance (acceptance));
+      double score = search.run (pi, 0.1);
+      CPPUNIT_ASSERT( ! search.scores.empty () );
+      CPPUNIT_ASSERT_EQUAL( search.scores.back (), score );
+      CPPUNIT_ASSERT_EQUAL( bc -> score (pi), score );
+      CPPUNIT_ASSERT( score >= bc -> score (lsf) );
+      for (int i = 1; i < search.scores.size (); ++ i) {
+	CPPUNIT_ASSERT( search.scores [i] > search.scores [i - 1] );
+	CPPUNIT_ASSERT( search.times [i] >= search.times [i - 1] );
+      }
+      std::vector <size_t> sorted (pi.begin (), pi.end ());
+      std::sort (sorted.begin (), sorted.end ());
+      for (int i = 0; i < sorted.size (); ++ i) {
+	CPPUNIT_ASSERT_EQUAL( size_t (i), sorted [i] );
+      }
+    }
+  }
+}
@@ -0,0 +1,16 @@
+#ifndef _PERMUTE_ITERATED_LOCAL_SEARCH_TEST_HH
+#define _PERMUTE_ITERATED_LOCAL_SEARCH_TEST_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <IteratedLocalSearch.hh>
+
+class IteratedLocalSearchTest : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE( IteratedLocalSearchTest );
+  CPPUNIT_TEST( testRun );
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testRun ();
+};
+
+#endif//_PERMUTE_ITERATED_LOCAL_SEARCH_TEST_HH
@@ -0,0 +1,18 @@
+#ifndef _PERMUTE_LOLIB_FIXTURE_HH
+#define _PERMUTE_LOLIB_FIXTURE_HH
+
+#include <Core/TextStream.hh>
+
+#include <BeforeScorer.hh>
+#include <Permutation.hh>
+
+// Reads the LOLIB matrix be75eec.mat that the scorer, chart and search tests
+// share, and sets the given permutation to the identity over its words.
+inline Permute::BeforeCostRef readBe75eec (Permute::Permutation & pi) {
+  Core::TextInputStream input ("be75eec.mat");
+  Permute::BeforeCostRef bc (Permute::readLOLIB (input));
+  Permute::integerPermutation (pi, bc -> size ());
+  return bc;
+}
+
+#endif//_PERMUTE_LOLIB_FIXTURE_HH
@@ -0,0 +1,149 @@
+#include <sstream>
+#include <vector>
+#include <BeforeScorer.hh>
+#include <ParseController.hh>
+#include <ThreadPool.hh>
+#include "LOPChartTest.hh"
+#include "LOLIBFixture.hh"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LOPChartTest );
+
+namespace {
+  // Returns the cubic, quadratic and anchored controllers over p.
+  std::vector <Permute::ParseControllerRef> controllers (const Permute::Permutation & p) {
+    std::vector <Permute::ParseControllerRef> result;
+    result.push_back (Permute::CubicParseController::create ());
+    result.push_back (Permute::QuadraticParseController::create (3));
+    result.push_back (Permute::LeftAnchorParseController::decorate
+		      (Permute::QuadraticParseController::create (3), 3));
+    result.push_back (Permute::RightAnchorParseController::decorate
+		      (Permute::LeftAnchorParseController::decorate
+		       (Permute::QuadraticParseController::create (3), 3), p, 3));
+    return result;
+  }
+
+  // Parses p with a new chart and scorer, reorders it along the best path and
+  // returns the score of that path.
+  template <class Chart>
+  double parse (Permute::Permutation & p, const Permute::BeforeCostRef & bc,
+		const Permute::ParseControllerRef & controller,
+		Permute::BeforeScorer::Layout scorer_layout, int window,
+		Permute::LOPChart::Layout layout, const Permute::ThreadPoolRef & pool) {
+    Permute::ScorerRef scorer (new Permute::BeforeScorer (bc, p, scorer_layout));
+    Chart chart (p, window, pool, layout);
+    chart.permute (controller, scorer);
+    Permute::ConstPathRef path = chart.getBestPath ();
+    p.reorder (path);
+    return path -> getScore ();
+  }
+
+  // Verifies that the FULL and BANDED layouts of one chart type find the same
+  // score and permutation.
+  template <class Chart>
+  void compareLayouts (const char * name, const Permute::Permutation & p,
+		       const Permute::BeforeCostRef & bc,
+		       const Permute::ParseControllerRef & controller,
+		       Permute::BeforeScorer::Layout scorer_layout, int window) {
+    Permute::Permutation full = p, banded = p;
+    std::ostringstream out;
+    out << name << " window " << window << (scorer_layout == Permute::BeforeScorer::SPARSE ? " sparse" : " dense");
+    CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (),
+				  parse <Chart> (full, bc, controller, scorer_layout, window,
+						 Permute::LOPChart::FULL, Permute::ThreadPoolRef ()),
+				  parse <Chart> (banded, bc, controller, scorer_layout, window,
+						 Permute::LOPChart::BANDED, Permute::ThreadPoolRef ()) );
+    CPPUNIT_ASSERT_MESSAGE( out.str (), full == banded );
+  }
+
+  // Verifies that one chart type finds the same score and permutation on one
+  // thread as on the given pool, over three successive parses.
+  template <class Chart>
+  void compareThreads (const char * name, const Permute::Permutation & p,
+		       const Permute::BeforeCostRef & bc,
+		       const Permute::ParseControllerRef & controller, int window,
+		       const Permute::ThreadPoolRef & pool) {
+    Permute::Permutation serial = p, threaded = p;
+    for (int iteration = 0; iteration < 3; ++ iteration) {
+      std::ostringstream out;
+      out << name << " window " << window << " iteration " << iteration;
+      CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (),
+				    parse <Chart> (serial, bc, controller, Permute::BeforeScorer::DENSE,
+						   window, Permute::LOPChart::FULL, Permute::ThreadPoolRef ()),
+				    parse <Chart> (threaded, bc, controller, Permute::BeforeScorer::DENSE,
+						   window, Permute::LOPChart::FULL, pool) );
+      CPPUNIT_ASSERT_MESSAGE( out.str (), serial == threaded );
+    }
+  }
+}
+
+// Verifies that each chart finds the same best score and permutation with the
+// BANDED layout as with the FULL layout, under every controller and scorer
+// layout.  Only the cubic controller bands the chart; the others must parse it
+// in full.
+void LOPChartTest::testBanded () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  std::vector <Permute::ParseControllerRef> controller = controllers (p);
+  for (int c = 0; c < controller.size (); ++ c) {
+    for (int sparse = 0; sparse < 2; ++ sparse) {
+      Permute::BeforeScorer::Layout layout =
+	sparse ? Permute::BeforeScorer::SPARSE : Permute::BeforeScorer::DENSE;
+      for (int window = 2; window <= 8; window += 3) {
+	compareLayouts <Permute::LOPChart> ("LOPChart", p, bc, controller [c], layout, window);
+	compareLayouts <Permute::NormalLOPChart> ("NormalLOPChart", p, bc, controller [c], layout, window);
+	compareLayouts <Permute::BackpointerNormalLOPChart>
+	  ("BackpointerNormalLOPChart", p, bc, controller [c], layout, window);
+      }
+    }
+  }
+}
+
+// Verifies that BackpointerNormalLOPChart finds the same best score and
+// permutation as NormalLOPChart, serially and on a thread pool, with and
+// without a window.  Each parse starts from the permutation that the previous
+// one found, as the trainers do.
+void LOPChartTest::testBackpointer () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  Permute::ThreadPoolRef pool (new Permute::ThreadPool (4));
+  std::vector <Permute::ParseControllerRef> controller = controllers (p);
+  for (int c = 0; c < controller.size (); ++ c) {
+    for (int threads = 0; threads < 2; ++ threads) {
+      for (int window = 0; window <= 5; window += 5) {
+	Permute::Permutation normal = p, backpointer = p;
+	for (int iteration = 0; iteration < 3; ++ iteration) {
+	  std::ostringstream out;
+	  out << "controller " << c << " window " << window
+	      << (threads ? " threaded" : "") << " iteration " << iteration;
+	  CPPUNIT_ASSERT_EQUAL_MESSAGE( out.str (),
+					parse <Permute::NormalLOPChart>
+					(normal, bc, controller [c], Permute::BeforeScorer::DENSE, window,
+					 Permute::LOPChart::FULL, Permute::ThreadPoolRef ()),
+					parse <Permute::BackpointerNormalLOPChart>
+					(backpointer, bc, controller [c], Permute::BeforeScorer::DENSE, window,
+					 Permute::LOPChart::FULL, threads ? pool : Permute::ThreadPoolRef ()) );
+	  CPPUNIT_ASSERT_MESSAGE( out.str (), normal == backpointer );
+	}
+      }
+    }
+  }
+}
+
+// Reads a cost matrix from LOLIB.  Verifies that LOPChart and NormalLOPChart
+// find the same best score and permutation on one thread as on four, under
+// every controller, with and without a window.
+void LOPChartTest::testThreads () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  Permute::ThreadPoolRef pool (new Permute::ThreadPool (4));
+  std::vector <Permute::ParseControllerRef> controller = controllers (p);
+  for (int c = 0; c < controller.size (); ++ c) {
+    for (int window = 0; window <= 5; window += 5) {
+      compareThreads <Permute::LOPChart> ("LOPChart", p, bc, controller [c], window, pool);
+      compareThreads <Permute::NormalLOPChart> ("NormalLOPChart", p, bc, controller [c], window, pool);
+    }
+  }
+}
@@ -0,0 +1,20 @@
+#ifndef _PERMUTE_LOP_CHART_TEST_HH
+#define _PERMUTE_LOP_CHART_TEST_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <LOPChart.hh>
+
+class LOPChartTest : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE( LOPChartTest );
+  CPPUNIT_TEST( testBanded );
+  CPPUNIT_TEST( testBackpointer );
+  CPPUNIT_TEST( testThreads );
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testBanded ();
+  void testBackpointer ();
+  void testThreads ();
+};
+
+#endif//_PERMUTE_LOP_CHART_TEST_HH
@@ -0,0 +1,63 @@
+#include <algorithm>
+#include "LinearOrderingTest.hh"
+#include "LOLIBFixture.hh"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LinearOrderingTest );
+
+// Reads an integer cost matrix from LOLIB.  Verifies that InsertEngine makes
+// the same LS_f and greedy insert moves as visit and search_insert, from the
+// identity and from its reverse.
+void LinearOrderingTest::testInsertEngine () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  for (int start = 0; start < 2; ++ start) {
+    if (start > 0) {
+      std::reverse (p.begin (), p.end ());
+    }
+    Permute::Permutation a = p, b = p;
+    Permute::InsertEngine engine (b, bc);
+    for (;;) {
+      double gain = Permute::visit (a, bc);
+      CPPUNIT_ASSERT_EQUAL( gain, engine.visit () );
+      CPPUNIT_ASSERT( a == b );
+      if (gain <= 0.0) {
+	break;
+      }
+    }
+    std::reverse (a.begin (), a.end ());
+    std::reverse (b.begin (), b.end ());
+    engine.assign ();
+    for (;;) {
+      double gain = Permute::search_insert (a, bc);
+      CPPUNIT_ASSERT_EQUAL( gain, engine.searchInsert () );
+      CPPUNIT_ASSERT( a == b );
+      if (gain <= 0.0) {
+	break;
+      }
+    }
+    CPPUNIT_ASSERT_EQUAL( bc -> score (a), engine.score () );
+  }
+}
+
+// Verifies that block_lsf makes the same moves with one workspace kept across
+// every call, at several widths, as with a new workspace for each call.
+void LinearOrderingTest::testBlockWorkspace () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  Permute::Permutation a = p, b = p;
+  Permute::PermutedCost cost (bc, b);
+  Permute::BlockWorkspace workspace;
+  for (int width = 1; width <= bc -> size (); width *= 3) {
+    for (;;) {
+      double gain = Permute::block_lsf (a, bc, width);
+      CPPUNIT_ASSERT_EQUAL( gain, Permute::block_lsf (b, cost, width, workspace) );
+      CPPUNIT_ASSERT( a == b );
+      if (gain <= 0.0) {
+	break;
+      }
+    }
+  }
+  CPPUNIT_ASSERT_EQUAL( bc -> score (a), cost.score () );
+}
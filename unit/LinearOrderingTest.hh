@@ -0,0 +1,18 @@
+#ifndef _PERMUTE_LINEAR_ORDERING_TEST_HH
+#define _PERMUTE_LINEAR_ORDERING_TEST_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <LinearOrdering.hh>
+
+class LinearOrderingTest : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE( LinearOrderingTest );
+  CPPUNIT_TEST( testInsertEngine );
+  CPPUNIT_TEST( testBlockWorkspace );
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testInsertEngine ();
+  void testBlockWorkspace ();
+};
+
+#endif//_PERMUTE_LINEAR_ORDERING_TEST_HH
@@ -0,0 +1,45 @@
+#include <algorithm>
+#include "MemeticTest.hh"
+#include "LOLIBFixture.hh"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( MemeticTest );
+
+// Verifies that the population stays sorted, distinct and made of local
+// optima, and that run returns its best individual.
+void MemeticTest::testPopulation () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  Permute::Memetic memetic (bc, Permute::ThreadPoolRef (), 8, 8, 0, 3, 5);
+  double score = memetic.run (p, 20);
+  CPPUNIT_ASSERT_EQUAL( 20, memetic.generations () );
+  CPPUNIT_ASSERT_EQUAL( bc -> score (p), score );
+
+  const std::vector <Permute::Memetic::Individual> & population = memetic.population ();
+  CPPUNIT_ASSERT_EQUAL( 8, int (population.size ()) );
+  CPPUNIT_ASSERT_EQUAL( score, population.front ().score );
+  for (int i = 0; i < population.size (); ++ i) {
+    if (i > 0) {
+      CPPUNIT_ASSERT( population [i - 1].score >= population [i].score );
+      CPPUNIT_ASSERT( population [i - 1].order != population [i].order );
+    }
+    Permute::Permutation pi = p;
+    std::copy (population [i].order.begin (), population [i].order.end (), pi.begin ());
+    CPPUNIT_ASSERT_EQUAL( bc -> score (pi), population [i].score );
+    CPPUNIT_ASSERT_EQUAL( 0.0, Permute::visit (pi, bc) );
+  }
+}
+
+// Verifies that the thread pool does not change the search.
+void MemeticTest::testThreads () {
+  Permute::Permutation serial;
+  Permute::BeforeCostRef bc (readBe75eec (serial));
+  Permute::Permutation parallel = serial;
+
+  Permute::ThreadPoolRef pool (new Permute::ThreadPool (4));
+  Permute::Memetic one (bc, Permute::ThreadPoolRef (), 6, 6, 3, 2, 7),
+    four (bc, pool, 6, 6, 3, 2, 7);
+  CPPUNIT_ASSERT_EQUAL( one.run (serial, 10), four.run (parallel, 10) );
+  CPPUNIT_ASSERT( serial == parallel );
+  CPPUNIT_ASSERT_EQUAL( one.restarts (), four.restarts () );
+}
@@ -0,0 +1,18 @@
+#ifndef _PERMUTE_MEMETIC_TEST_HH
+#define _PERMUTE_MEMETIC_TEST_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Memetic.hh>
+
+class MemeticTest : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE( MemeticTest );
+  CPPUNIT_TEST( testPopulation );
+  CPPUNIT_TEST( testThreads );
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testPopulation ();
+  void testThreads ();
+};
+
+#endif//_PERMUTE_MEMETIC_TEST_HH
@@ -1,3 +1,8 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 #include "PVTest.hh"
 #include <Application.hh>
 
@@ -53,3 +58,257 @@ void PVTest::testSuffix () {
   CPPUNIT_ASSERT_EQUAL( std::string ("four"), PV::suffix ("four") );
   CPPUNIT_ASSERT_EQUAL( std::string ("onger"), PV::suffix ("longer") );
 }
+
+// Builds a PV with random features, and verifies that the key of every
+// feature instantiated from a feature map agrees with the key decoded from
+// its compressed string, and that the index finds the same weights as the
+// strings do.
+void PVTest::testKeys () {
+  PV pv;
+  pv.addType ("pos", 40);
+  pv.addType ("word", 5000);
+  pv.addType ("dist", 10);
+  pv.addFeatureType ("l-pos", "pos");
+  pv.addFeatureType ("b-pos", "pos");
+  pv.addFeatureType ("r-pos", "pos");
+  pv.addFeatureType ("l-word", "word");
+  pv.addFeatureType ("r-word", "word");
+  pv.addFeatureType ("dist", "dist");
+  pv.addTemplate ("l-pos r-pos");
+  pv.addTemplate ("l-word r-pos dist");
+  pv.addTemplate ("l-pos b-pos r-pos");
+  pv.addTemplate ("b-pos dist");
+  const TemplateList & tl = pv.templates ();
+  CPPUNIT_ASSERT( tl.keyed () );
+
+  srand (21);
+  std::vector <std::string> features;
+  std::vector <FeatureKey> keys;
+  for (int trial = 0; trial < 200; ++ trial) {
+    FeatureMap fmap;
+    std::ostringstream l, r, lw, rw, d;
+    l << rand () % 40;
+    r << rand () % 40;
+    lw << rand () % 5000;
+    rw << rand () % 5000;
+    d << rand () % 10;
+    fmap.setValue (lPOS, l.str ());
+    fmap.setValue (rPOS, r.str ());
+    fmap.setValue (lWord, lw.str ());
+    fmap.setValue (rWord, rw.str ());
+    fmap.setValue (Dist, d.str ());
+    FeatureMap kmap (fmap);
+    std::vector <int> ids;
+    tl.intern (fmap);
+    tl.featuresWithTemplate (features, fmap, bPOS, 0);
+    tl.ids (ids, kmap);
+    tl.keysWithTemplate (keys, kmap, ids, bPOS, 0);
+    for (int b = 0; b < 3; ++ b) {
+      std::ostringstream pos;
+      pos << rand () % 40;
+      fmap.setValue (bPOS, pos.str ());
+      tl.intern (fmap, bPOS);
+      tl.featuresWithTemplate (features, fmap, bPOS, 1);
+      kmap.setValue (bPOS, pos.str ());
+      tl.ids (ids, kmap, bPOS);
+      tl.keysWithTemplate (keys, kmap, ids, bPOS, 1);
+    }
+  }
+  CPPUNIT_ASSERT_EQUAL( features.size (), keys.size () );
+  for (int f = 0; f < features.size (); ++ f) {
+    FeatureKey key;
+    CPPUNIT_ASSERT( tl.key (key, features [f]) );
+    CPPUNIT_ASSERT_EQUAL( keys [f], key );
+    if (f % 3 == 0) {
+      pv [features [f]] = f;
+    }
+  }
+
+  CPPUNIT_ASSERT( pv.index () );
+  CPPUNIT_ASSERT( pv.indexed () );
+  CPPUNIT_ASSERT_EQUAL( 0, pv.table ().collisions () );
+  for (int f = 0; f < features.size (); ++ f) {
+    PV::const_iterator phi = pv.find (features [f]);
+    const WRef * w = pv.table ().find (keys [f]);
+    CPPUNIT_ASSERT_EQUAL( phi == pv.end (), w == 0 );
+    if (w) {
+      CPPUNIT_ASSERT_EQUAL( double (phi -> second), double (* w) );
+    }
+  }
+
+  // A new feature leaves the index stale.
+  pv.getParameter ("b-pos=new dist=new");
+  CPPUNIT_ASSERT( ! pv.indexed () );
+}
+
+// Writes a PV in the binary format, then reads it back both into a hash
+// table and as a mapping, each of which must hold the same weights under the
+// same keys.
+void PVTest::testBinary () {
+  PV pv;
+  pv.addType ("pos", 40);
+  pv.addType ("dist", 10);
+  pv.addFeatureType ("l-pos", "pos");
+  pv.addFeatureType ("b-pos", "pos");
+  pv.addFeatureType ("r-pos", "pos");
+  pv.addFeatureType ("dist", "dist");
+  pv.addDistance (ComparisonGreaterThan, 5);
+  pv.addTemplate ("l-pos r-pos");
+  pv.addTemplate ("b-pos dist");
+  srand (23);
+  for (int f = 0; f < 500; ++ f) {
+    std::ostringstream feature;
+    if (f % 2) {
+      feature << "l-pos=" << rand () % 40 << " r-pos=" << rand () % 40;
+    } else {
+      feature << "b-pos=" << rand () % 40 << " dist=" << rand () % 10;
+    }
+    pv.getParameter (feature.str ()) = f;
+  }
+
+  const std::string file ("PVTest.bin"), corrupt ("PVTest-corrupt.bin");
+  std::ostringstream bytes;
+  CPPUNIT_ASSERT( writeBinary (pv, bytes) );
+  // The metadata follows the 64-byte header, which holds its size at byte 12,
+  // and ends with the count of distances and the one distance.  Overstates
+  // the count.
+  std::string damaged = bytes.str ();
+  unsigned metadata, count = 1000;
+  std::memcpy (& metadata, damaged.data () + 12, sizeof (metadata));
+  std::memcpy (& damaged [64 + metadata - 3 * sizeof (count)], & count, sizeof (count));
+  {
+    std::ofstream out (file.c_str (), std::ios::binary), bad (corrupt.c_str (), std::ios::binary);
+    out << bytes.str ();
+    bad << damaged;
+  }
+  CPPUNIT_ASSERT( isBinaryPV (file) );
+  PV copy, mapped;
+  // A corrupt file leaves the PV empty, ready to read another.
+  CPPUNIT_ASSERT( ! readBinary (copy, corrupt) );
+  CPPUNIT_ASSERT( copy.empty () );
+  CPPUNIT_ASSERT( copy.templates ().begin () == copy.templates ().end () );
+  CPPUNIT_ASSERT( readFile (copy, file) );
+  CPPUNIT_ASSERT( readBinary (mapped, file, true) );
+  std::remove (file.c_str ());
+  std::remove (corrupt.c_str ());
+
+  CPPUNIT_ASSERT_EQUAL( pv.size (), copy.size () );
+  CPPUNIT_ASSERT( mapped.mapped () );
+  CPPUNIT_ASSERT( mapped.empty () );
+  CPPUNIT_ASSERT_EQUAL( pv.size (), mapped.mapping ().size () );
+  for (PV::const_iterator p = pv.begin (); p != pv.end (); ++ p) {
+    PV::const_iterator q = copy.find (p -> first);
+    CPPUNIT_ASSERT( q != copy.end () );
+    CPPUNIT_ASSERT_EQUAL( double (p -> second), double (q -> second) );
+    FeatureKey key, mappedKey;
+    CPPUNIT_ASSERT( pv.templates ().key (key, p -> first) );
+    CPPUNIT_ASSERT( mapped.templates ().key (mappedKey, p -> first) );
+    CPPUNIT_ASSERT_EQUAL( key, mappedKey );
+    const double * w = mapped.mapping ().find (key);
+    CPPUNIT_ASSERT( w != 0 );
+    CPPUNIT_ASSERT_EQUAL( double (p -> second), * w );
+  }
+}
+
+void PVTest::testHash () {
+  PV pv;
+  pv.addType ("pos", 40);
+  pv.addFeatureType ("l-pos", "pos");
+  pv.addFeatureType ("r-pos", "pos");
+  pv.addTemplate ("l-pos r-pos");
+  srand (24);
+  std::vector <std::pair <FeatureKey, double> > features;
+  for (int f = 0; f < 500; ++ f) {
+    std::ostringstream feature;
+    feature << "l-pos=" << rand () % 40 << " r-pos=" << rand () % 40;
+    FeatureKey key;
+    CPPUNIT_ASSERT( pv.templates ().key (key, pv.templates ().compress (feature.str ())) );
+    pv.getParameter (feature.str ()) += f;
+    features.push_back (std::make_pair (key, double (f)));
+  }
+
+  const int bits = 6;
+  CPPUNIT_ASSERT( pv.hash (bits, true) );
+  CPPUNIT_ASSERT( pv.hashed () );
+  CPPUNIT_ASSERT( pv.empty () );
+  const HashedWeights & hashing = pv.hashing ();
+  CPPUNIT_ASSERT_EQUAL( size_t (1 << bits), hashing.size () );
+  std::vector <double> expected (hashing.size (), 0.0);
+  for (size_t f = 0; f < features.size (); ++ f) {
+    expected [features [f].first & (hashing.size () - 1)] +=
+      hashing.sign (features [f].first) * features [f].second;
+  }
+  for (size_t b = 0; b < hashing.size (); ++ b) {
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( expected [b], double (hashing [b]), 1e-9 );
+  }
+
+  // A negated occurrence moves its bucket against the update.
+  SumBeforeCost bc (2, "PVTest::testHash");
+  Sum sum = bc (0, 1);
+  if (hashing.sign (features [1].first) < 0) {
+    sum -= hashing.find (features [1].first);
+  } else {
+    sum += hashing.find (features [1].first);
+  }
+  const double before = double (hashing.find (features [1].first));
+  sum.add (1.0);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( before + hashing.sign (features [1].first),
+				double (hashing.find (features [1].first)), 1e-9 );
+
+  const std::string file ("PVTest.hash.bin");
+  {
+    std::ofstream out (file.c_str (), std::ios::binary);
+    CPPUNIT_ASSERT( writeBinary (pv, out) );
+  }
+  PV copy;
+  CPPUNIT_ASSERT( readBinary (copy, file, true) );
+  std::remove (file.c_str ());
+
+  CPPUNIT_ASSERT( copy.hashed () );
+  CPPUNIT_ASSERT( ! copy.mapped () );
+  CPPUNIT_ASSERT_EQUAL( bits, copy.hashing ().bits () );
+  CPPUNIT_ASSERT( copy.hashing ().isSigned () );
+  for (size_t b = 0; b < hashing.size (); ++ b) {
+    CPPUNIT_ASSERT_EQUAL( double (hashing [b]), double (copy.hashing () [b]) );
+  }
+}
+
+void PVTest::testSumBeforeCost () {
+  WRef one (1.0), two (2.0), three (3.0);
+  SumBeforeCost bc (3, "PVTest::testSumBeforeCost");
+  bc (0, 1) += one;
+  bc (1, 2) += two;
+  bc (1, 2) -= three;
+  // Out of order: inserted into the middle of the shared array.
+  bc (0, 2) += three;
+  bc (0, 2) += 0.5;
+
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, bc.cost (0, 1), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 3.5, bc.cost (0, 2), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( -1.0, bc.cost (1, 2), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, bc.cost (1, 0), 1e-9 );
+  const Sum sum = bc (1, 2);
+  CPPUNIT_ASSERT_EQUAL( 2, int (sum.end () - sum.begin ()) );
+  CPPUNIT_ASSERT( * sum.begin () == two );
+  CPPUNIT_ASSERT_EQUAL( 1, sum.sign (sum.begin ()) );
+  CPPUNIT_ASSERT_EQUAL( -1, sum.sign (sum.begin () + 1) );
+  CPPUNIT_ASSERT( * bc (0, 2).begin () == three );
+  CPPUNIT_ASSERT( bc (1, 0).begin () == bc (1, 0).end () );
+
+  // 2 precedes 0 precedes 1, so only (0,1) is updated.
+  Permutation pi;
+  integerPermutation (pi, 3);
+  pi [0] = 2;
+  pi [1] = 0;
+  pi [2] = 1;
+  bc.add (pi, 0.25);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.25, double (one), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.25, bc.cost (0, 1), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 3.5, bc.cost (0, 2), 1e-9 );
+
+  // A subtracted weight moves against the update, but the sum still grows.
+  bc (1, 2).add (1.0);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 3.0, double (two), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 2.0, double (three), 1e-9 );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, bc.cost (1, 2), 1e-9 );
+}
@@ -12,6 +12,10 @@ class PVTest : public CppUnit::TestFixture {
   CPPUNIT_TEST( testCopy );
   CPPUNIT_TEST( testPrefix );
   CPPUNIT_TEST( testSuffix );
+  CPPUNIT_TEST( testKeys );
+  CPPUNIT_TEST( testBinary );
+  CPPUNIT_TEST( testHash );
+  CPPUNIT_TEST( testSumBeforeCost );
   CPPUNIT_TEST_SUITE_END();
 private:
   Permute::PV pv_;
@@ -23,6 +27,10 @@ public:
   void testCopy ();
   void testPrefix ();
   void testSuffix ();
+  void testKeys ();
+  void testBinary ();
+  void testHash ();
+  void testSumBeforeCost ();
 };
 
 #endif//_PERMUTE_PV_TEST_HH
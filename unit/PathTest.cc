@@ -1,7 +1,43 @@
+#include <algorithm>
+#include <pthread.h>
+#include <vector>
+#include <ThreadPool.hh>
 #include "PathTest.hh"
 
 CPPUNIT_TEST_SUITE_REGISTRATION( PathTest );
 
+namespace {
+  // Connects a chain of arcs, records its score, and frees it.
+  class Chain {
+  private:
+    std::vector <double> & scores_;
+  public:
+    Chain (std::vector <double> & scores) : scores_ (scores) {}
+    void operator () (int job) const {
+      Permute::ConstPathRef path = Permute::Path::arc (0, 0, 1, 0.5);
+      for (int i = 1; i <= job; ++ i) {
+	path = Permute::Path::connect (path, Permute::Path::arc (i, i, i + 1, 0.5), 1.0, false);
+      }
+      scores_ [job] = path -> getScore ();
+    }
+  };
+
+  // Connects two arcs on a new thread and records the addresses of the three
+  // nodes, which the thread frees before it exits.
+  void * connectArcs (void * addresses) {
+    Permute::ConstPathRef left = Permute::Path::arc (0, 0, 1, 0.5),
+      right = Permute::Path::arc (1, 1, 2, 0.5),
+      path = Permute::Path::connect (left, right, 1.0, false);
+    std::vector <const Permute::Path *> & result =
+      * static_cast <std::vector <const Permute::Path *> *> (addresses);
+    result.push_back (left.get ());
+    result.push_back (right.get ());
+    result.push_back (path.get ());
+    std::sort (result.begin (), result.end ());
+    return 0;
+  }
+}
+
 void PathTest::setUp () {
   null = Permute::Path::nullPath ();
   lower = Permute::Path::lowerBound (9);
@@ -110,3 +146,36 @@ void PathTest::testRLessThan () {
   CPPUNIT_ASSERT( rlt (arc1, epsilon) );
   CPPUNIT_ASSERT( ! rlt (epsilon, arc1) );
 }
+
+// Verifies that the memory of a released node is reused by the next node of
+// the same size, and that the new node is fully constructed.
+void PathTest::testRecycle () {
+  const Permute::Path * address = connect.get ();
+  connect = Permute::ConstPathRef ();
+  connect = Permute::Path::connect (arc2, arc1, 0.3, false);
+  CPPUNIT_ASSERT( address == connect.get () );
+  CPPUNIT_ASSERT_EQUAL( Fsa::StateId (10), connect -> getStart () );
+  CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.4, connect -> getScore (), 1e-9 );
+}
+
+// Builds and frees paths on the workers of two thread pools in turn.  Then
+// verifies that a thread reuses the nodes that an exited thread freed, which
+// would otherwise be lost with its free lists.
+void PathTest::testThreads () {
+  for (int round = 0; round < 2; ++ round) {
+    Permute::ThreadPoolRef pool (new Permute::ThreadPool (4));
+    std::vector <double> scores (200);
+    Permute::parallelFor (pool, 0, scores.size (), Chain (scores), 1);
+    for (int job = 0; job < scores.size (); ++ job) {
+      CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.5 * job + 0.5, scores [job], 1e-9 );
+    }
+  }
+
+  std::vector <const Permute::Path *> first, second;
+  pthread_t thread;
+  pthread_create (& thread, 0, connectArcs, & first);
+  pthread_join (thread, 0);
+  pthread_create (& thread, 0, connectArcs, & second);
+  pthread_join (thread, 0);
+  CPPUNIT_ASSERT( first == second );
+}
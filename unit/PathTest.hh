@@ -13,6 +13,8 @@ class PathTest : public CppUnit::TestFixture {
   CPPUNIT_TEST( testNormal );
   CPPUNIT_TEST( testLessThan );
   CPPUNIT_TEST( testRLessThan );
+  CPPUNIT_TEST( testRecycle );
+  CPPUNIT_TEST( testThreads );
   CPPUNIT_TEST_SUITE_END();
 private:
   Permute::ConstPathRef null, lower, rlower, upper, rupper, forsearch,
@@ -27,6 +29,8 @@ public:
   void testNormal ();
   void testLessThan ();
   void testRLessThan ();
+  void testRecycle ();
+  void testThreads ();
 };
 
 #endif//_PERMUTE_PATH_TEST_HH
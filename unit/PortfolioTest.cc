@@ -0,0 +1,42 @@
+#include "PortfolioTest.hh"
+#include "LOLIBFixture.hh"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( PortfolioTest );
+
+// Verifies that a run ends at a local optimum of LS_f and block_lsf, and that
+// only the enabled neighborhoods run.
+void PortfolioTest::testLocalOptimum () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  Permute::Portfolio portfolio (bc, Permute::ThreadPoolRef (), false, 4);
+  portfolio.enable (Permute::Portfolio::CUBIC, false);
+  for (int restart = 0; restart < 3; ++ restart) {
+    p.randomize ();
+    double start = bc -> score (p);
+    double score = portfolio.run (p);
+    CPPUNIT_ASSERT( score >= start );
+    CPPUNIT_ASSERT_EQUAL( bc -> score (p), score );
+    CPPUNIT_ASSERT_EQUAL( 0.0, Permute::visit (p, bc) );
+    CPPUNIT_ASSERT_EQUAL( 0.0, Permute::block_lsf (p, bc, 4) );
+    CPPUNIT_ASSERT( portfolio.record (Permute::Portfolio::LSF).steps > 0 );
+    CPPUNIT_ASSERT( portfolio.record (Permute::Portfolio::BLOCK_LSF).steps > 0 );
+    CPPUNIT_ASSERT( portfolio.record (Permute::Portfolio::QUADRATIC).steps > 0 );
+    CPPUNIT_ASSERT_EQUAL( 0, portfolio.record (Permute::Portfolio::CUBIC).steps );
+  }
+}
+
+// Verifies that neighborhoods running side by side agree on the result.
+void PortfolioTest::testConcurrent () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  Permute::ThreadPoolRef pool (new Permute::ThreadPool (4));
+  Permute::Portfolio portfolio (bc, pool, true, 4);
+  p.randomize ();
+  double score = portfolio.run (p);
+  CPPUNIT_ASSERT_EQUAL( bc -> score (p), score );
+  CPPUNIT_ASSERT_EQUAL( 0.0, Permute::visit (p, bc) );
+  CPPUNIT_ASSERT_EQUAL( 0.0, Permute::block_lsf (p, bc, 4) );
+  CPPUNIT_ASSERT( portfolio.record (Permute::Portfolio::CUBIC).steps > 0 );
+}
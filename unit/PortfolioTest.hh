@@ -0,0 +1,19 @@
+#ifndef _PERMUTE_PORTFOLIO_TEST_HH
+#define _PERMUTE_PORTFOLIO_TEST_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <LinearOrdering.hh>
+#include <Portfolio.hh>
+
+class PortfolioTest : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE( PortfolioTest );
+  CPPUNIT_TEST( testLocalOptimum );
+  CPPUNIT_TEST( testConcurrent );
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testLocalOptimum ();
+  void testConcurrent ();
+};
+
+#endif//_PERMUTE_PORTFOLIO_TEST_HH
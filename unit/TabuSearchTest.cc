@@ -0,0 +1,36 @@
+#include "TabuSearchTest.hh"
+#include "LOLIBFixture.hh"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TabuSearchTest );
+
+// Verifies that the best permutation of a run is a local optimum of insert
+// and block moves, since any improving move from it would beat the best
+// score and so be admissible.
+void TabuSearchTest::testRun () {
+  Permute::Permutation p;
+  Permute::BeforeCostRef bc (readBe75eec (p));
+
+  for (int width = 1; width <= 4; width += 3) {
+    Permute::Permutation pi = p;
+    Permute::TabuSearch search (bc, 7, width, 3);
+    double score = search.run (pi, 2000);
+    CPPUNIT_ASSERT_EQUAL( 2000L, search.moves () );
+    CPPUNIT_ASSERT_EQUAL( bc -> score (pi), score );
+    CPPUNIT_ASSERT( score >= bc -> score (p) );
+    CPPUNIT_ASSERT_EQUAL( 0.0, Permute::visit (pi, bc) );
+    if (width > 1) {
+      CPPUNIT_ASSERT_EQUAL( 0.0, Permute::block_lsf (pi, bc, width) );
+    }
+  }
+}
+
+// Verifies that a seed determines the run.
+void TabuSearchTest::testSeed () {
+  Permute::Permutation a;
+  Permute::BeforeCostRef bc (readBe75eec (a));
+  Permute::Permutation b = a;
+
+  Permute::TabuSearch one (bc, 5, 2, 9), two (bc, 5, 2, 9);
+  CPPUNIT_ASSERT_EQUAL( one.run (a, 500), two.run (b, 500) );
+  CPPUNIT_ASSERT( a == b );
+}
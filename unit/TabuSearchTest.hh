@@ -0,0 +1,19 @@
+#ifndef _PERMUTE_TABU_SEARCH_TEST_HH
+#define _PERMUTE_TABU_SEARCH_TEST_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <LinearOrdering.hh>
+#include <TabuSearch.hh>
+
+class TabuSearchTest : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE( TabuSearchTest );
+  CPPUNIT_TEST( testRun );
+  CPPUNIT_TEST( testSeed );
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testRun ();
+  void testSeed ();
+};
+
+#endif//_PERMUTE_TABU_SEARCH_TEST_HH